@@ -0,0 +1,35 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("bits.h");
+});
+
+/// Builtin bit scans against the portable software fallbacks.
+pub fn run() !void {
+    var values: [4096]u32 = undefined;
+    var rng = std.Random.DefaultPrng.init(0x5ca9);
+    for (&values) |*value| {
+        value.* = (rng.random().int(u32) >> rng.random().uintLessThan(u5, 31)) | 1;
+    }
+
+    const rounds: usize = 2000;
+    var sink: u32 = 0;
+    var timer = try std.time.Timer.start();
+    var round: usize = 0;
+    while (round < rounds) : (round += 1) {
+        for (values) |value| sink +%= c.Clz32(value) +% c.Ctz32(value);
+    }
+    const builtin_ns = timer.lap();
+
+    round = 0;
+    while (round < rounds) : (round += 1) {
+        for (values) |value| sink +%= c.SoftwareClz32(value) +% c.SoftwareCtz32(value);
+    }
+    const software_ns = timer.read();
+    std.mem.doNotOptimizeAway(sink);
+
+    const scans: f64 = @floatFromInt(rounds * values.len * 2);
+    std.debug.print("Bit scans: builtin {d:.2} ns/op, software {d:.2} ns/op\n", .{
+        @as(f64, @floatFromInt(builtin_ns)) / scans,
+        @as(f64, @floatFromInt(software_ns)) / scans,
+    });
+}
@@ -0,0 +1,85 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/cpu/concurrency.h");
+});
+
+var mutex: c.Mutex = undefined;
+var spin_flag = false;
+
+const Worker = struct {
+    rounds: u32,
+    hold: u32, // Yields while holding the lock
+    held: u32 = 0,
+};
+
+// Leaves the section; true once the worker is done
+fn leaveSection(worker: *Worker) bool {
+    worker.held = 0;
+    worker.rounds -= 1;
+    return worker.rounds == 0;
+}
+
+fn mutexWorker(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const worker: *Worker = @ptrCast(@alignCast(task.*.context));
+    if (task.*.resume_point == 0) {
+        task.*.resume_point = 1;
+        if (c.MutexLock(&mutex, task) == 0) return c.TASK_BLOCKED;
+    }
+    if (worker.held < worker.hold) {
+        worker.held += 1;
+        return c.TASK_YIELDED;
+    }
+    c.MutexUnlock(&mutex);
+    task.*.resume_point = 0;
+    if (leaveSection(worker)) return c.TASK_EXITED;
+    return c.TASK_YIELDED;
+}
+
+fn spinWorker(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const worker: *Worker = @ptrCast(@alignCast(task.*.context));
+    if (task.*.resume_point == 0) {
+        // Polls a flag until it clears
+        if (spin_flag) return c.TASK_WAITING;
+        spin_flag = true;
+        task.*.resume_point = 1;
+    }
+    if (worker.held < worker.hold) {
+        worker.held += 1;
+        return c.TASK_YIELDED;
+    }
+    spin_flag = false;
+    task.*.resume_point = 0;
+    if (leaveSection(worker)) return c.TASK_EXITED;
+    return c.TASK_YIELDED;
+}
+
+/// Eight tasks contending for one lock: the mutex against a polled flag.
+pub fn run() !void {
+    const task_count = 8;
+    const rounds: u32 = 2_000;
+    const hold: u32 = 4;
+
+    var results: [2]struct { dispatches: usize, ns: u64 } = undefined;
+    for ([_]c.TaskFunction{ &mutexWorker, &spinWorker }, 0..) |function, i| {
+        c.TaskReset();
+        c.MutexInit(&mutex, 0);
+        spin_flag = false;
+        var workers: [task_count]Worker = undefined;
+        for (&workers) |*worker| {
+            worker.* = .{ .rounds = rounds, .hold = hold };
+            _ = c.TaskSpawn(function, worker) orelse return error.SpawnFailed;
+        }
+
+        var timer = try std.time.Timer.start();
+        const dispatches = c.TaskRun();
+        results[i] = .{ .dispatches = dispatches, .ns = timer.read() };
+    }
+
+    const sections: f64 = @floatFromInt(task_count * rounds);
+    std.debug.print("Contended lock: mutex {d:.1} dispatches/section ({d:.0} ns), spin flag {d:.1} dispatches/section ({d:.0} ns)\n", .{
+        @as(f64, @floatFromInt(results[0].dispatches)) / sections,
+        @as(f64, @floatFromInt(results[0].ns)) / sections,
+        @as(f64, @floatFromInt(results[1].dispatches)) / sections,
+        @as(f64, @floatFromInt(results[1].ns)) / sections,
+    });
+}
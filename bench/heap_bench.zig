@@ -0,0 +1,494 @@
+//! Allocator benchmark, built and run once per allocator backend by
+//! `zig build bench`.
+//!
+//! Every workload starts from a freshly initialized heap and times each
+//! malloc/realloc/free on its own, reporting throughput, latency percentiles
+//! and the worst fragmentation seen while it ran.
+//!
+//! Allocation traces are replayed too: the recorded request handler in
+//! `traces/` always, plus any given as arguments
+//! (`zig build bench -- a.trace b.trace`). Traces hold one operation per
+//! line:
+//!
+//!     a <slot> <size>   malloc(size) into slot
+//!     r <slot> <size>   realloc the block in slot
+//!     f <slot>          free the block in slot
+//!
+//! Slots are small integers naming live blocks; blocks still live at the end
+//! of a trace are freed without being timed.
+//!
+//! Binary captures written by `HeapTraceDump` in HEAP_TRACE builds are
+//! accepted as well and converted to slots first, so a capture taken on one
+//! backend can be replayed against every other. Frees of blocks allocated
+//! before the capture started and failed allocations are dropped.
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+    @cInclude("virtualization/memory/arena.h");
+});
+
+const allocator_name = if (@hasDecl(c, "USE_LIST_ALLOCATOR"))
+    (if (@hasDecl(c, "HEAP_THREAD_SAFE")) "list-mt" else "list")
+else if (@hasDecl(c, "USE_TLSF_ALLOCATOR"))
+    "tlsf"
+else if (@hasDecl(c, "USE_ZIG_ALLOCATOR"))
+    "zig"
+else
+    "clang";
+
+var heap_memory: [8 * 1024 * 1024]u8 align(64) = undefined;
+
+const max_operations: usize = 400_000;
+const max_slots: usize = 4096;
+const stats_interval: usize = 1024;
+const max_threads: usize = 8;
+
+/// Times single heap operations and keeps every latency for the percentiles.
+const Recorder = struct {
+    latencies: []u32,
+    count: usize = 0,
+    timer: std.time.Timer,
+    timer_overhead: u64,
+    peak_fragmentation: ?u32 = null,
+
+    fn init(latencies: []u32) !Recorder {
+        var timer = try std.time.Timer.start();
+
+        // Back-to-back reads measure what every sample pays for the clock
+        var overhead: u64 = std.math.maxInt(u64);
+        var i: usize = 0;
+        while (i < 1000) : (i += 1) {
+            const start = timer.read();
+            overhead = @min(overhead, timer.read() - start);
+        }
+        return .{ .latencies = latencies, .timer = timer, .timer_overhead = overhead };
+    }
+
+    fn record(self: *Recorder, start: u64) void {
+        const elapsed = (self.timer.read() - start) -| self.timer_overhead;
+        if (self.count < self.latencies.len) {
+            self.latencies[self.count] = @intCast(@min(elapsed, std.math.maxInt(u32)));
+            self.count += 1;
+        }
+
+        if (self.count % stats_interval == 0) {
+            var stats: c.HeapStats = undefined;
+            if (c.AllocatorGetStats(&stats, 0) != 0) {
+                self.peak_fragmentation = @max(self.peak_fragmentation orelse 0, stats.fragmentation_permille);
+            }
+        }
+    }
+
+    fn malloc(self: *Recorder, size: usize) ?*anyopaque {
+        const start = self.timer.read();
+        const ptr = c.malloc(size);
+        self.record(start);
+        return ptr;
+    }
+
+    fn realloc(self: *Recorder, ptr: ?*anyopaque, size: usize) ?*anyopaque {
+        const start = self.timer.read();
+        const new_ptr = c.realloc(ptr, size);
+        self.record(start);
+        return new_ptr;
+    }
+
+    fn free(self: *Recorder, ptr: ?*anyopaque) void {
+        const start = self.timer.read();
+        c.free(ptr);
+        self.record(start);
+    }
+
+    fn report(self: *Recorder, workload: []const u8) void {
+        if (self.count == 0) return;
+        const samples = self.latencies[0..self.count];
+
+        var total_ns: u64 = 0;
+        for (samples) |sample| total_ns += sample;
+        std.mem.sort(u32, samples, {}, std.sort.asc(u32));
+
+        const ops_per_sec = @as(f64, @floatFromInt(self.count)) * std.time.ns_per_s /
+            @as(f64, @floatFromInt(@max(total_ns, 1)));
+        std.debug.print("{s:<8} {s:<16} {d:>12.0} ops/s  p50 {d:>5} ns  p99 {d:>6} ns  max {d:>8} ns  peak frag ", .{
+            allocator_name,
+            workload,
+            ops_per_sec,
+            samples[samples.len / 2],
+            samples[(samples.len * 99) / 100],
+            samples[samples.len - 1],
+        });
+        if (self.peak_fragmentation) |permille| {
+            std.debug.print("{d}.{d}%\n", .{ permille / 10, permille % 10 });
+        } else {
+            std.debug.print("n/a\n", .{});
+        }
+    }
+};
+
+/// Random malloc/free of 16-128 byte objects.
+fn uniformSmall(recorder: *Recorder, random: std.Random) !void {
+    var slots = [_]?*anyopaque{null} ** 1024;
+    defer {
+        for (slots) |ptr| c.free(ptr);
+    }
+
+    var i: usize = 0;
+    while (i < 200_000) : (i += 1) {
+        const slot = random.uintLessThan(usize, slots.len);
+        if (slots[slot]) |ptr| {
+            recorder.free(ptr);
+            slots[slot] = null;
+        } else {
+            slots[slot] = recorder.malloc(16 + random.uintAtMost(usize, 112)) orelse return error.OutOfMemory;
+        }
+    }
+}
+
+/// Random malloc/free of 40-200 byte objects, the sizes that dominate our
+/// workloads.
+fn smallObjects(recorder: *Recorder, random: std.Random) !void {
+    var slots = [_]?*anyopaque{null} ** 512;
+    defer {
+        for (slots) |ptr| c.free(ptr);
+    }
+
+    var i: usize = 0;
+    while (i < 200_000) : (i += 1) {
+        const slot = random.uintLessThan(usize, slots.len);
+        if (slots[slot]) |ptr| {
+            recorder.free(ptr);
+            slots[slot] = null;
+        } else {
+            slots[slot] = recorder.malloc(40 + random.uintAtMost(usize, 160)) orelse return error.OutOfMemory;
+        }
+    }
+}
+
+/// Mostly small objects with a tail of medium and large buffers.
+fn mixedSize(recorder: *Recorder, random: std.Random) !void {
+    var slots = [_]?*anyopaque{null} ** 1024;
+    defer {
+        for (slots) |ptr| c.free(ptr);
+    }
+
+    var i: usize = 0;
+    while (i < 200_000) : (i += 1) {
+        const slot = random.uintLessThan(usize, slots.len);
+        if (slots[slot]) |ptr| {
+            recorder.free(ptr);
+            slots[slot] = null;
+        } else {
+            const bucket = random.uintLessThan(u8, 100);
+            const size = if (bucket < 70)
+                16 + random.uintAtMost(usize, 240)
+            else if (bucket < 95)
+                256 + random.uintAtMost(usize, 3840)
+            else
+                4096 + random.uintAtMost(usize, 28672);
+            slots[slot] = recorder.malloc(size) orelse return error.OutOfMemory;
+        }
+    }
+}
+
+/// Messages are freed in the order they were allocated, as with a queue
+/// between a producer and a consumer.
+fn producerConsumer(recorder: *Recorder, random: std.Random) !void {
+    var queue = [_]?*anyopaque{null} ** 256;
+    var head: usize = 0;
+    var tail: usize = 0;
+    defer {
+        while (tail != head) : (tail += 1) c.free(queue[tail % queue.len]);
+    }
+
+    var i: usize = 0;
+    while (i < 200_000) : (i += 1) {
+        const in_flight = head - tail;
+        const produce = in_flight == 0 or (in_flight < queue.len and random.uintLessThan(u8, 100) < 55);
+        if (produce) {
+            queue[head % queue.len] = recorder.malloc(32 + random.uintAtMost(usize, 480)) orelse return error.OutOfMemory;
+            head += 1;
+        } else {
+            recorder.free(queue[tail % queue.len]);
+            tail += 1;
+        }
+    }
+}
+
+/// Buffers grown by 1.5x from 16 bytes up to 16 KiB, then dropped.
+fn reallocGrowth(recorder: *Recorder, random: std.Random) !void {
+    var buffers = [_]?*anyopaque{null} ** 64;
+    var sizes = [_]usize{0} ** buffers.len;
+    defer {
+        for (buffers) |ptr| c.free(ptr);
+    }
+
+    var i: usize = 0;
+    while (i < 100_000) : (i += 1) {
+        const index = random.uintLessThan(usize, buffers.len);
+        if (sizes[index] >= 16 * 1024) {
+            recorder.free(buffers[index]);
+            buffers[index] = null;
+            sizes[index] = 0;
+        } else {
+            const size = if (sizes[index] == 0) 16 else sizes[index] + sizes[index] / 2;
+            buffers[index] = recorder.realloc(buffers[index], size) orelse return error.OutOfMemory;
+            sizes[index] = size;
+        }
+    }
+}
+
+/// The unit tests' stress loop: a block of 8-256 bytes is allocated,
+/// reallocated to another such size and freed straight away.
+fn mallocReallocFree(recorder: *Recorder, random: std.Random) !void {
+    const min_size: usize = @sizeOf(usize);
+    const max_size: usize = 256;
+
+    var i: usize = 0;
+    while (i < 100_000) : (i += 1) {
+        const ptr = recorder.malloc(min_size + random.uintAtMost(usize, max_size - min_size)) orelse return error.OutOfMemory;
+        const new_size = min_size + random.uintAtMost(usize, max_size - min_size);
+        recorder.free(recorder.realloc(ptr, new_size) orelse return error.OutOfMemory);
+    }
+}
+
+/// One thread's share of `threadScaling`: random malloc/free of 16-256 byte
+/// objects it never hands to another thread.
+fn threadChurn(seed: u64, operations: usize) void {
+    var slots = [_]?*anyopaque{null} ** 128;
+    defer {
+        for (slots) |ptr| c.free(ptr);
+    }
+
+    var rng = std.Random.DefaultPrng.init(seed);
+    const random = rng.random();
+    var i: usize = 0;
+    while (i < operations) : (i += 1) {
+        const slot = random.uintLessThan(usize, slots.len);
+        if (slots[slot]) |ptr| {
+            c.free(ptr);
+            slots[slot] = null;
+        } else {
+            slots[slot] = c.malloc(16 + random.uintAtMost(usize, 240));
+        }
+    }
+}
+
+/// Aggregate throughput of 1 to `max_threads` threads churning at once.
+fn threadScaling() !void {
+    const operations_per_thread: usize = 200_000;
+    var thread_count: usize = 1;
+    while (thread_count <= max_threads) : (thread_count *= 2) {
+        if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) return error.HeapInitFailed;
+        defer c.AllocatorDeinit();
+
+        var threads: [max_threads]std.Thread = undefined;
+        var timer = try std.time.Timer.start();
+        for (threads[0..thread_count], 0..) |*thread, index| {
+            thread.* = try std.Thread.spawn(.{}, threadChurn, .{ @as(u64, index), operations_per_thread });
+        }
+        for (threads[0..thread_count]) |thread| thread.join();
+        const elapsed_ns = timer.read();
+
+        const operations = @as(f64, @floatFromInt(thread_count * operations_per_thread));
+        std.debug.print("{s:<8} {d} threads {d:>17.0} ops/s\n", .{
+            allocator_name,
+            thread_count,
+            operations * std.time.ns_per_s / @as(f64, @floatFromInt(@max(elapsed_ns, 1))),
+        });
+    }
+}
+
+/// Frames of a few dozen temporaries that all die together, from the heap
+/// and from an arena rewound to a mark at the end of each frame.
+fn temporaries() !void {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) return error.HeapInitFailed;
+    defer c.AllocatorDeinit();
+
+    const arena = c.ArenaCreate(16 * 1024);
+    if (arena == null) return error.ArenaCreateFailed;
+    defer c.ArenaDestroy(arena);
+
+    const frames: usize = 5_000;
+    var pointers: [48]?*anyopaque = undefined;
+    var timer = try std.time.Timer.start();
+    var frame: usize = 0;
+    while (frame < frames) : (frame += 1) {
+        for (&pointers, 0..) |*ptr, i| {
+            ptr.* = c.malloc(40 + (i % 8) * 20) orelse return error.OutOfMemory;
+        }
+        for (pointers) |ptr| c.free(ptr);
+    }
+    const heap_ns = timer.lap();
+
+    frame = 0;
+    while (frame < frames) : (frame += 1) {
+        const mark = c.ArenaGetMark(arena);
+        for (&pointers, 0..) |*ptr, i| {
+            ptr.* = c.ArenaAlloc(arena, 40 + (i % 8) * 20) orelse return error.OutOfMemory;
+        }
+        c.ArenaRewind(arena, mark);
+    }
+    const arena_ns = timer.read();
+
+    const operations = frames * pointers.len;
+    std.debug.print("{s:<8} temporaries      heap {d} ns/op, arena {d} ns/op\n", .{
+        allocator_name,
+        heap_ns / operations,
+        arena_ns / operations,
+    });
+}
+
+fn runWorkload(latencies: []u32, name: []const u8, comptime workload: anytype) !void {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) return error.HeapInitFailed;
+    defer c.AllocatorDeinit();
+
+    var rng = std.Random.DefaultPrng.init(0x5eed);
+    var recorder = try Recorder.init(latencies);
+    try workload(&recorder, rng.random());
+    recorder.report(name);
+}
+
+fn replayTrace(latencies: []u32, name: []const u8, trace: []const u8) !void {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) return error.HeapInitFailed;
+    defer c.AllocatorDeinit();
+
+    var slots = [_]?*anyopaque{null} ** max_slots;
+    defer {
+        for (slots) |ptr| c.free(ptr);
+    }
+
+    var recorder = try Recorder.init(latencies);
+    var lines = std.mem.tokenizeScalar(u8, trace, '\n');
+    while (lines.next()) |line| {
+        var fields = std.mem.tokenizeScalar(u8, line, ' ');
+        const op = fields.next() orelse continue;
+        const slot = try std.fmt.parseInt(usize, fields.next() orelse return error.InvalidTrace, 10);
+        if (slot >= max_slots) return error.InvalidTrace;
+
+        switch (op[0]) {
+            'a', 'r' => {
+                const size = try std.fmt.parseInt(usize, fields.next() orelse return error.InvalidTrace, 10);
+                const ptr = if (op[0] == 'a') recorder.malloc(size) else recorder.realloc(slots[slot], size);
+                // A failed realloc leaves the old block in place
+                if (ptr != null or size == 0) slots[slot] = ptr;
+            },
+            'f' => {
+                recorder.free(slots[slot]);
+                slots[slot] = null;
+            },
+            else => return error.InvalidTrace,
+        }
+    }
+    recorder.report(name);
+}
+
+const capture_magic = "HTRC";
+const capture_header_size = 16;
+// HEAP_TRACE_REALLOC and HEAP_TRACE_FREE; the bench itself is not a HEAP_TRACE build
+const capture_realloc = 4;
+const capture_free = 5;
+const native_endian = @import("builtin").cpu.arch.endian();
+
+/// Rewrites a binary `HeapTraceDump` capture in the text trace format,
+/// naming each live address by a slot.
+fn captureToText(allocator: std.mem.Allocator, capture: []const u8) ![]u8 {
+    if (capture.len < capture_header_size) return error.InvalidTrace;
+    const record_size = std.mem.readInt(u32, capture[8..12], native_endian);
+    const count = std.mem.readInt(u32, capture[12..16], native_endian);
+    if (record_size < 40 or capture.len < capture_header_size + @as(usize, count) * record_size) {
+        return error.InvalidTrace;
+    }
+
+    var text = std.ArrayList(u8).init(allocator);
+    errdefer text.deinit();
+    var live = std.AutoHashMap(u64, usize).init(allocator);
+    defer live.deinit();
+    var spare_slots = std.ArrayList(usize).init(allocator);
+    defer spare_slots.deinit();
+    var next_slot: usize = 0;
+
+    var offset: usize = capture_header_size;
+    var i: usize = 0;
+    while (i < count) : ({
+        i += 1;
+        offset += record_size;
+    }) {
+        const record = capture[offset..][0..40];
+        const op = std.mem.readInt(u32, record[0..4], native_endian);
+        const size = std.mem.readInt(u64, record[8..16], native_endian);
+        const address = std.mem.readInt(u64, record[16..24], native_endian);
+        const previous = std.mem.readInt(u64, record[24..32], native_endian);
+
+        switch (op) {
+            capture_free => if (live.fetchRemove(address)) |entry| {
+                try text.writer().print("f {d}\n", .{entry.value});
+                try spare_slots.append(entry.value);
+            },
+            capture_realloc => {
+                // A failed realloc leaves the old block where it was
+                if (address == 0 and size != 0) continue;
+                if (previous == 0) {
+                    if (address != 0) try allocate(&text, &live, &spare_slots, &next_slot, address, size);
+                } else if (live.fetchRemove(previous)) |entry| {
+                    try text.writer().print("r {d} {d}\n", .{ entry.value, size });
+                    if (address != 0) {
+                        try live.put(address, entry.value);
+                    } else {
+                        try spare_slots.append(entry.value);
+                    }
+                } else if (address != 0) {
+                    // Allocated before the capture started: replay as a fresh block
+                    try allocate(&text, &live, &spare_slots, &next_slot, address, size);
+                }
+            },
+            else => if (address != 0) {
+                try allocate(&text, &live, &spare_slots, &next_slot, address, size);
+            },
+        }
+    }
+    return text.toOwnedSlice();
+}
+
+fn allocate(
+    text: *std.ArrayList(u8),
+    live: *std.AutoHashMap(u64, usize),
+    spare_slots: *std.ArrayList(usize),
+    next_slot: *usize,
+    address: u64,
+    size: u64,
+) !void {
+    const slot = spare_slots.popOrNull() orelse blk: {
+        if (next_slot.* == max_slots) return error.TooManyLiveBlocks;
+        next_slot.* += 1;
+        break :blk next_slot.* - 1;
+    };
+    try live.put(address, slot);
+    try text.writer().print("a {d} {d}\n", .{ slot, size });
+}
+
+pub fn main() !void {
+    const latencies = try std.heap.page_allocator.alloc(u32, max_operations);
+    defer std.heap.page_allocator.free(latencies);
+
+    try runWorkload(latencies, "uniform-small", uniformSmall);
+    try runWorkload(latencies, "small-objects", smallObjects);
+    try runWorkload(latencies, "mixed-size", mixedSize);
+    try runWorkload(latencies, "producer-consumer", producerConsumer);
+    try runWorkload(latencies, "realloc-growth", reallocGrowth);
+    try runWorkload(latencies, "malloc-realloc-free", mallocReallocFree);
+    try temporaries();
+    if (@hasDecl(c, "HEAP_THREAD_SAFE")) try threadScaling();
+
+    const args = try std.process.argsAlloc(std.heap.page_allocator);
+    defer std.process.argsFree(std.heap.page_allocator, args);
+    try replayTrace(latencies, "request-trace", @embedFile("traces/request_handler.trace"));
+    for (args[1..]) |path| {
+        const file = try std.fs.cwd().readFileAlloc(std.heap.page_allocator, path, 64 * 1024 * 1024);
+        defer std.heap.page_allocator.free(file);
+
+        const is_capture = std.mem.startsWith(u8, file, capture_magic);
+        const trace = if (is_capture) try captureToText(std.heap.page_allocator, file) else file;
+        defer if (is_capture) std.heap.page_allocator.free(trace);
+        try replayTrace(latencies, std.fs.path.basename(path), trace);
+    }
+}
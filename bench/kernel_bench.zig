@@ -0,0 +1,15 @@
+//! Kernel primitive benchmarks, built and run by `zig build bench`.
+//!
+//! Each file next to this one times one component, against a baseline where
+//! there is one, and prints the figures; the unit tests in tests/ only check
+//! behaviour.
+pub fn main() !void {
+    try @import("bits_bench.zig").run();
+    try @import("tasks_bench.zig").run();
+    try @import("message_queue_bench.zig").run();
+    try @import("concurrency_bench.zig").run();
+    try @import("event_flags_bench.zig").run();
+    try @import("unordered_map_bench.zig").run();
+    try @import("ordered_map_bench.zig").run();
+    try @import("list_bench.zig").run();
+}
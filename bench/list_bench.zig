@@ -0,0 +1,74 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+    @cInclude("std/list.h");
+});
+
+var heap_memory: [std.mem.page_size * 16]u8 align(16) = undefined;
+
+const Timer = extern struct {
+    expiry: u32,
+    link: c.ListNode,
+};
+
+fn timerOf(node: [*c]const c.ListNode) *const Timer {
+    const link: *const c.ListNode = node;
+    return @fieldParentPtr("link", link);
+}
+
+// Baseline: a queue that allocates a heap node for every enqueue
+const QueueNode = extern struct {
+    timer: *Timer,
+    next: ?*QueueNode,
+};
+
+/// Enqueue and dequeue through intrusive nodes against a queue that
+/// allocates a node per entry.
+pub fn run() !void {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    const count = 1024;
+    const rounds = 64;
+    var timers: [count]Timer = undefined;
+    for (&timers, 0..) |*timer, i| timer.expiry = @intCast(i);
+
+    var sum: u64 = 0;
+    var timer = try std.time.Timer.start();
+    var list: c.List = .{ .head = null, .tail = null };
+    var round: usize = 0;
+    while (round < rounds) : (round += 1) {
+        for (&timers) |*t| c.ListPushBack(&list, &t.link);
+        var node = c.ListPopFront(&list);
+        while (node != null) : (node = c.ListPopFront(&list)) sum += timerOf(node).expiry;
+    }
+    const intrusive_ns = timer.lap();
+
+    var head: ?*QueueNode = null;
+    var tail: ?*QueueNode = null;
+    round = 0;
+    while (round < rounds) : (round += 1) {
+        for (&timers) |*t| {
+            const node: *QueueNode = @ptrCast(@alignCast(c.malloc(@sizeOf(QueueNode)) orelse return error.OutOfMemory));
+            node.* = .{ .timer = t, .next = null };
+            if (tail) |last| last.next = node else head = node;
+            tail = node;
+        }
+        while (head) |node| {
+            head = node.next;
+            sum -= node.timer.expiry;
+            c.free(node);
+        }
+        tail = null;
+    }
+    const allocating_ns = timer.lap();
+    if (sum != 0) return error.EntryLost;
+
+    const operations: f64 = @floatFromInt(count * rounds);
+    std.debug.print("Enqueue and dequeue: intrusive {d:.1} ns, allocating {d:.1} ns\n", .{
+        @as(f64, @floatFromInt(intrusive_ns)) / operations,
+        @as(f64, @floatFromInt(allocating_ns)) / operations,
+    });
+}
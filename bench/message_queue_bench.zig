@@ -0,0 +1,50 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/cpu/concurrency.h");
+});
+
+const Message = extern struct {
+    producer: u32,
+    sequence: u32,
+};
+
+var storage: [4096]u64 = undefined;
+
+fn produce(queue: *c.MessageQueue, count: u32) void {
+    var sequence: u32 = 0;
+    while (sequence < count) {
+        if (c.MessageQueueSend(queue, &Message{ .producer = 0, .sequence = sequence }) != 0) {
+            sequence += 1;
+        } else {
+            std.Thread.yield() catch {};
+        }
+    }
+}
+
+/// SPSC throughput with the producer and the consumer on their own threads.
+pub fn run() !void {
+    var queue: c.MessageQueue = undefined;
+    if (c.MessageQueueInit(&queue, &storage, @sizeOf(@TypeOf(storage)), 256, @sizeOf(Message), c.MESSAGE_QUEUE_SPSC) == 0) {
+        return error.QueueInitFailed;
+    }
+
+    const count: u32 = 1_000_000;
+    var timer = try std.time.Timer.start();
+    const producer = try std.Thread.spawn(.{}, produce, .{ &queue, count });
+
+    var received: u32 = 0;
+    while (received < count) {
+        var message: Message = undefined;
+        if (c.MessageQueueReceive(&queue, &message) == 0) {
+            std.Thread.yield() catch {};
+            continue;
+        }
+        received += 1;
+    }
+    producer.join();
+    const elapsed = timer.read();
+
+    std.debug.print("SPSC queue: {d:.1} ns/message\n", .{
+        @as(f64, @floatFromInt(elapsed)) / @as(f64, @floatFromInt(count)),
+    });
+}
@@ -0,0 +1,82 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+    @cInclude("std/ordered_map.h");
+});
+
+var heap_memory: [std.mem.page_size * 256]u8 align(16) = undefined;
+
+// Baseline: a perfectly balanced binary search tree, one heap node per key
+const TreeNode = extern struct {
+    key: u32,
+    value: u32,
+    left: ?*TreeNode,
+    right: ?*TreeNode,
+};
+
+fn buildTree(keys: []const u32) error{OutOfMemory}!?*TreeNode {
+    if (keys.len == 0) return null;
+    const middle = keys.len / 2;
+    const node: *TreeNode = @ptrCast(@alignCast(c.MemoryResourceAllocate(null, @sizeOf(TreeNode)) orelse return error.OutOfMemory));
+    node.* = .{ .key = keys[middle], .value = @intCast(middle), .left = null, .right = null };
+    node.left = try buildTree(keys[0..middle]);
+    node.right = try buildTree(keys[middle + 1 ..]);
+    return node;
+}
+
+fn findInTree(root: ?*TreeNode, key: u32) ?*TreeNode {
+    var node = root;
+    while (node) |n| {
+        if (key == n.key) return n;
+        node = if (key < n.key) n.left else n.right;
+    }
+    return null;
+}
+
+fn releaseTree(node: ?*TreeNode) void {
+    const n = node orelse return;
+    releaseTree(n.left);
+    releaseTree(n.right);
+    c.MemoryResourceRelease(null, n, @sizeOf(TreeNode));
+}
+
+/// B+-tree lookups against a balanced binary search tree.
+pub fn run() !void {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    const count = 8192;
+    var keys: [count]u32 = undefined;
+    for (&keys, 0..) |*key, i| key.* = @intCast(i * 7);
+
+    var map: c.OrderedMap = undefined;
+    c.OrderedMapInit(&map, @sizeOf(u32), 0, null, null);
+    defer c.OrderedMapDestroy(&map);
+    if (c.OrderedMapBulkLoad(&map, &keys, null, count) == 0) return error.OutOfMemory;
+    const tree = try buildTree(&keys);
+    defer releaseTree(tree);
+
+    // Look up in a scattered order so neither structure stays in cache
+    var order: [count]u32 = undefined;
+    for (&order, 0..) |*key, i| key.* = keys[(i * 4099) % count];
+
+    var found: usize = 0;
+    var timer = try std.time.Timer.start();
+    for (order) |key| {
+        if (c.OrderedMapFind(&map, &key) != null) found += 1;
+    }
+    const btree_ns = timer.lap();
+    for (order) |key| {
+        if (findInTree(tree, key) != null) found += 1;
+    }
+    const binary_ns = timer.lap();
+    if (found != 2 * count) return error.KeyLost;
+
+    std.debug.print("Find per key: B+-tree {d:.1} ns (depth {d}), binary tree {d:.1} ns\n", .{
+        @as(f64, @floatFromInt(btree_ns)) / count,
+        map.depth,
+        @as(f64, @floatFromInt(binary_ns)) / count,
+    });
+}
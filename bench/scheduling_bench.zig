@@ -0,0 +1,210 @@
+//! Scheduler benchmarks, built and run by `zig build bench` once per
+//! scheduling policy that has something to measure.
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/cpu/scheduling.h");
+});
+
+const Decisions = struct { mean_ns: f64, worst_ns: u64 };
+
+// Decision latency with the scheduler driven directly, so the ready set can
+// be far larger than TASK_MAX
+fn measureDecisions(ready: []c.Task, rounds: usize) !Decisions {
+    c.SchedulerInit();
+    for (ready, 0..) |*task, i| {
+        task.* = std.mem.zeroes(c.Task);
+        task.state = c.TASK_STATE_READY;
+        task.priority = @intCast(i % c.SCHEDULER_PRIORITIES);
+        c.SchedulerReady(task);
+    }
+
+    var worst: u64 = 0;
+    var timer = try std.time.Timer.start();
+    const start = timer.read();
+    var round: usize = 0;
+    while (round < rounds) : (round += 1) {
+        const before = timer.read();
+        const task = c.SchedulerNext();
+        c.SchedulerReady(task);
+        worst = @max(worst, timer.read() - before);
+    }
+    const total = timer.read() - start;
+    c.SchedulerInit();
+    return .{
+        .mean_ns = @as(f64, @floatFromInt(total)) / @as(f64, @floatFromInt(rounds)),
+        .worst_ns = worst,
+    };
+}
+
+/// Priority dispatch with a few and with many tasks ready.
+fn priorityDecisions() !void {
+    var tasks: [1024]c.Task = undefined;
+    const few = try measureDecisions(tasks[0..2], 200_000);
+    const many = try measureDecisions(tasks[0..], 200_000);
+    std.debug.print("Priority dispatch: 2 ready {d:.1} ns (worst {} ns), 1024 ready {d:.1} ns (worst {} ns)\n", .{
+        few.mean_ns,
+        few.worst_ns,
+        many.mean_ns,
+        many.worst_ns,
+    });
+}
+
+/// EDF dispatch with every control block ready, each job moving its
+/// deadline a pseudo-random distance ahead before it is queued again.
+fn deadlineDecisions() !void {
+    var tasks: [c.TASK_MAX]c.Task = undefined;
+    var rng = std.Random.DefaultPrng.init(0xedf);
+    c.SchedulerInit();
+    for (&tasks) |*task| {
+        task.* = std.mem.zeroes(c.Task);
+        task.state = c.TASK_STATE_READY;
+        task.has_deadline = 1;
+        task.deadline = rng.random().uintLessThan(u32, 1000);
+        c.SchedulerReady(task);
+    }
+
+    const rounds: usize = 200_000;
+    var worst: u64 = 0;
+    var timer = try std.time.Timer.start();
+    const start = timer.read();
+    var round: usize = 0;
+    while (round < rounds) : (round += 1) {
+        const before = timer.read();
+        const task = c.SchedulerNext();
+        task.*.deadline +%= 1 + rng.random().uintLessThan(u32, 1000);
+        c.SchedulerReady(task);
+        worst = @max(worst, timer.read() - before);
+    }
+    const total = timer.read() - start;
+    c.SchedulerInit();
+    std.debug.print("EDF dispatch: {} ready {d:.1} ns (worst {} ns)\n", .{
+        tasks.len,
+        @as(f64, @floatFromInt(total)) / @as(f64, @floatFromInt(rounds)),
+        worst,
+    });
+}
+
+const edf_build = @hasDecl(c, "EARLIEST_DEADLINE_FIRST_SCHEDULING");
+
+// Simulated time: every unit of work a task does advances the clock a tick
+var sim_now: u32 = 0;
+
+fn simClock() callconv(.C) u32 {
+    return sim_now;
+}
+
+comptime {
+    if (edf_build) @export(simClock, .{ .name = "SchedulerClock" });
+}
+
+const Periodic = struct {
+    cost: u32,
+    period: u32,
+    release: u32 = 0,
+    remaining: u32 = 0,
+    wait_list: c.TaskWaitList = .{ .head = null, .tail = null },
+};
+
+fn periodicTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const job: *Periodic = @ptrCast(@alignCast(task.*.context));
+    sim_now += 1;
+    job.remaining -= 1;
+    if (job.remaining > 0) return c.TASK_YIELDED;
+
+    // Implicit deadlines: each job is due when the next one is released
+    c.SchedulerJobDone(task, task.*.deadline +% job.period);
+    c.TaskBlock(task, &job.wait_list);
+    return c.TASK_BLOCKED;
+}
+
+const SimulationResult = struct {
+    utilization: f64,
+    busy: f64,
+    misses: u32,
+    worst_dispatch_ns: u64,
+};
+
+// Runs the set through TaskRunOnce until `horizon`, timing every dispatch
+fn simulate(set: []Periodic, horizon: u32) !SimulationResult {
+    c.TaskReset();
+    sim_now = 0;
+
+    var tasks: [8][*c]c.Task = undefined;
+    var utilization: f64 = 0;
+    for (set, 0..) |*job, i| {
+        job.remaining = job.cost;
+        job.release = job.period;
+        job.wait_list = .{ .head = null, .tail = null };
+        tasks[i] = c.TaskSpawnDeadline(&periodicTask, job, job.period) orelse return error.SpawnFailed;
+        utilization += @as(f64, @floatFromInt(job.cost)) / @as(f64, @floatFromInt(job.period));
+    }
+
+    var busy: u32 = 0;
+    var worst: u64 = 0;
+    var timer = try std.time.Timer.start();
+    while (sim_now < horizon) {
+        for (set) |*job| {
+            while (job.release <= sim_now) : (job.release += job.period) {
+                // An unfinished job carries over into the next period
+                if (job.remaining == 0) {
+                    job.remaining = job.cost;
+                    _ = c.TaskWakeOne(&job.wait_list);
+                } else {
+                    job.remaining += job.cost;
+                }
+            }
+        }
+
+        const before = timer.read();
+        const ran = c.TaskRunOnce();
+        worst = @max(worst, timer.read() - before);
+        if (ran != 0) {
+            busy += 1;
+        } else {
+            sim_now += 1;
+        }
+    }
+
+    var misses: u32 = 0;
+    for (tasks[0..set.len]) |task| misses += task.*.deadline_misses;
+    c.TaskReset();
+    return .{
+        .utilization = utilization,
+        .busy = @as(f64, @floatFromInt(busy)) / @as(f64, @floatFromInt(horizon)),
+        .misses = misses,
+        .worst_dispatch_ns = worst,
+    };
+}
+
+/// Periodic task sets below and above full utilization, run for 60k ticks.
+fn periodicSets() !void {
+    // U = 0.92, above the rate-monotonic bound for four tasks (0.76)
+    var feasible = [_]Periodic{
+        .{ .cost = 1, .period = 4 },
+        .{ .cost = 2, .period = 6 },
+        .{ .cost = 3, .period = 10 },
+        .{ .cost = 1, .period = 25 },
+    };
+    var overloaded = [_]Periodic{
+        .{ .cost = 2, .period = 4 },
+        .{ .cost = 2, .period = 6 },
+        .{ .cost = 3, .period = 10 },
+    };
+    for ([_][]Periodic{ &feasible, &overloaded }) |set| {
+        const result = try simulate(set, 60_000);
+        std.debug.print("EDF periodic set: utilization {d:.3}, busy {d:.3}, {} misses, worst dispatch {} ns\n", .{
+            result.utilization,
+            result.busy,
+            result.misses,
+            result.worst_dispatch_ns,
+        });
+    }
+}
+
+pub fn main() !void {
+    if (@hasDecl(c, "PRIORITY_BASED_SCHEDULING")) try priorityDecisions();
+    if (edf_build) {
+        try deadlineDecisions();
+        try periodicSets();
+    }
+}
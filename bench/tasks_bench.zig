@@ -0,0 +1,44 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/cpu/tasks.h");
+});
+
+const switch_rounds: u32 = 200_000;
+
+fn pingTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const remaining: *u32 = @ptrCast(@alignCast(task.*.context));
+    remaining.* -= 1;
+    if (remaining.* == 0) return c.TASK_EXITED;
+    return c.TASK_YIELDED;
+}
+
+/// Task switches through the scheduler against calling the same body
+/// directly, which is the floor a stackless switch can get to.
+pub fn run() !void {
+    c.TaskReset();
+    var ping: u32 = switch_rounds;
+    var pong: u32 = switch_rounds;
+    _ = c.TaskSpawn(&pingTask, &ping) orelse return error.SpawnFailed;
+    _ = c.TaskSpawn(&pingTask, &pong) orelse return error.SpawnFailed;
+
+    var timer = try std.time.Timer.start();
+    const dispatches = c.TaskRun();
+    const dispatch_ns = timer.read();
+
+    // The same body through a function pointer the optimizer cannot see through
+    var remaining: u32 = 2 * switch_rounds;
+    var task = std.mem.zeroes(c.Task);
+    task.context = &remaining;
+    var function: c.TaskFunction = &pingTask;
+    std.mem.doNotOptimizeAway(&function);
+    timer.reset();
+    var calls: usize = 0;
+    while (function.?(&task) != c.TASK_EXITED) calls += 1;
+    const call_ns = timer.read();
+
+    std.debug.print("Task switch: {} bytes/task, {d:.1} ns/switch, direct call {d:.1} ns\n", .{
+        @sizeOf(c.Task),
+        @as(f64, @floatFromInt(dispatch_ns)) / @as(f64, @floatFromInt(dispatches)),
+        @as(f64, @floatFromInt(call_ns)) / @as(f64, @floatFromInt(calls + 1)),
+    });
+}
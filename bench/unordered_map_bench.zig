@@ -0,0 +1,95 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+    @cInclude("std/unordered_map.h");
+});
+
+var heap_memory: [std.mem.page_size * 256]u8 align(16) = undefined;
+
+// Baseline: one heap node per entry, chained from a bucket array
+const Node = extern struct {
+    key: u32,
+    value: u32,
+    next: ?*Node,
+};
+
+const ChainedMap = struct {
+    buckets: []?*Node,
+
+    fn put(self: *ChainedMap, key: u32, value: u32) !void {
+        const node: *Node = @ptrCast(@alignCast(c.MemoryResourceAllocate(null, @sizeOf(Node)) orelse return error.OutOfMemory));
+        const bucket = &self.buckets[c.HashBytes(&key, @sizeOf(u32)) & (self.buckets.len - 1)];
+        node.* = .{ .key = key, .value = value, .next = bucket.* };
+        bucket.* = node;
+    }
+
+    fn find(self: *const ChainedMap, key: u32) ?*Node {
+        var node = self.buckets[c.HashBytes(&key, @sizeOf(u32)) & (self.buckets.len - 1)];
+        while (node) |n| : (node = n.next) {
+            if (n.key == key) return n;
+        }
+        return null;
+    }
+
+    fn deinit(self: *ChainedMap) void {
+        for (self.buckets) |head| {
+            var node = head;
+            while (node) |n| {
+                node = n.next;
+                c.MemoryResourceRelease(null, n, @sizeOf(Node));
+            }
+        }
+    }
+};
+
+fn nanosPer(timer: *std.time.Timer, count: usize) f64 {
+    return @as(f64, @floatFromInt(timer.lap())) / @as(f64, @floatFromInt(count));
+}
+
+/// Flat map inserts and lookups against a chained map with a heap node per
+/// entry.
+pub fn run() !void {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    const count = 8192;
+    var keys: [count]u32 = undefined;
+    var prng = std.rand.DefaultPrng.init(11);
+    for (&keys) |*key| key.* = prng.random().int(u32);
+
+    var timer = try std.time.Timer.start();
+    var map: c.HashMap = undefined;
+    c.HashMapInit(&map, @sizeOf(u32), @sizeOf(u32), null, null, null);
+    defer c.HashMapDestroy(&map);
+    for (&keys, 0..) |*key, i| {
+        const value: u32 = @intCast(i);
+        if (c.HashMapPut(&map, key, &value) == 0) return error.OutOfMemory;
+    }
+    const flat_insert = nanosPer(&timer, count);
+    var sum: u64 = 0;
+    for (&keys) |*key| {
+        sum += @as(*u32, @ptrCast(@alignCast(c.HashMapFind(&map, key) orelse return error.KeyLost))).*;
+    }
+    const flat_find = nanosPer(&timer, count);
+
+    var buckets = [_]?*Node{null} ** count;
+    var chained = ChainedMap{ .buckets = &buckets };
+    defer chained.deinit();
+    _ = timer.lap();
+    for (keys, 0..) |key, i| try chained.put(key, @intCast(i));
+    const chained_insert = nanosPer(&timer, count);
+    for (keys) |key| {
+        sum -= (chained.find(key) orelse return error.KeyLost).value;
+    }
+    const chained_find = nanosPer(&timer, count);
+    if (sum != 0) return error.KeyLost;
+
+    std.debug.print("Insert/find per key: flat {d:.1}/{d:.1} ns, chained {d:.1}/{d:.1} ns\n", .{
+        flat_insert,
+        flat_find,
+        chained_insert,
+        chained_find,
+    });
+}
@@ -8,14 +8,59 @@ fn root() []const u8 {
 }
 const build_root = root();
 
+const allocator_options = [_][]const u8{
+    "USE_LIST_ALLOCATOR",
+    "USE_TLSF_ALLOCATOR",
+    "USE_ZIG_ALLOCATOR",
+    "USE_CLANG_ALLOCATOR",
+};
+
+const SchedulingPolicy = enum {
+    round_robin,
+    priority,
+    earliest_deadline,
+
+    fn define(self: SchedulingPolicy) ?[]const u8 {
+        return switch (self) {
+            .round_robin => null,
+            .priority => "PRIORITY_BASED_SCHEDULING",
+            .earliest_deadline => "EARLIEST_DEADLINE_FIRST_SCHEDULING",
+        };
+    }
+};
+
 pub fn build(build_ctx: *std.Build) !void {
     const target_options = build_ctx.standardTargetOptions(.{});
     const optimize = build_ctx.standardOptimizeOption(.{});
     const is_test = build_ctx.option(bool, "test", "Run test suite") orelse false;
 
+    // Benchmarks, declared before the library below so that it stays the
+    // one OSBuilder hands to AddFirmware
+    const bench_step = build_ctx.step("bench", "Benchmark every allocator backend and the kernel primitives");
+    inline for (allocator_options) |allocator| {
+        try addBenchScenario(build_ctx, bench_step, target_options, "heap", allocator, &.{});
+    }
+    try addBenchScenario(build_ctx, bench_step, target_options, "heap", "USE_LIST_ALLOCATOR", &.{"HEAP_THREAD_SAFE"});
+
+    // Kernel primitives and containers, on the list allocator
+    try addBenchScenario(build_ctx, bench_step, target_options, "kernel", "USE_LIST_ALLOCATOR", &.{});
+
+    // Scheduler decisions, per policy
+    try addBenchScenario(build_ctx, bench_step, target_options, "scheduling", "USE_LIST_ALLOCATOR", &.{"PRIORITY_BASED_SCHEDULING"});
+    try addBenchScenario(build_ctx, bench_step, target_options, "scheduling", "USE_LIST_ALLOCATOR", &.{"EARLIEST_DEADLINE_FIRST_SCHEDULING"});
+
     if (!is_test) { // Normal Library build
         const compile_target = build_ctx.option([]const u8, "Compile_Target", "Target to compile for") orelse "testing";
         const library_type = build_ctx.option([]const u8, "Library_Type", "Type of library to build (Static/Shared)") orelse "Static";
+        const thread_safe_heap = build_ctx.option(bool, "Thread_Safe_Heap", "Lock the heap and add per-thread caches (testing target only)") orelse false;
+        const heap_trace = build_ctx.option(bool, "Heap_Trace", "Record heap calls into a ring buffer for later replay") orelse false;
+        const heap_debug = build_ctx.option(bool, "Heap_Debug", "Guard list heap blocks and report double and invalid frees") orelse false;
+        const scheduling = build_ctx.option(SchedulingPolicy, "Scheduling", "Task scheduling policy") orelse .round_robin;
+        var defines = std.ArrayList([]const u8).init(build_ctx.allocator);
+        if (thread_safe_heap) try defines.append("HEAP_THREAD_SAFE");
+        if (heap_trace) try defines.append("HEAP_TRACE");
+        if (heap_debug) try defines.append("HEAP_DEBUG");
+        if (scheduling.define()) |define| try defines.append(define);
 
         const library = try OSBuilder.init(
             build_ctx,
@@ -23,6 +68,7 @@ pub fn build(build_ctx: *std.Build) !void {
                 .optimize = optimize,
                 .target = compile_target,
                 .lib_type = library_type,
+                .defines = defines.items,
             },
             "",
         );
@@ -37,54 +83,157 @@ pub fn build(build_ctx: *std.Build) !void {
         size_step.step.dependOn(&library.step);
         size_step_option.dependOn(&size_step.step);
 
+        // Exposed to dependents as b.dependency("CompOS", ...).module("TaskGraph")
+        const task_graph = taskGraphModule(build_ctx, defines.items);
+        try build_ctx.modules.put(build_ctx.dupe("TaskGraph"), task_graph);
+
         // Compile Commands for Intellisense
         OSBuilder.AddCompileCommandStep(build_ctx, library);
     } else {
         // Test scenarios
         const test_step = build_ctx.step("test", "Run all test scenarios");
 
-        const allocator_options = [_][]const u8{
-            // "USE_LIST_ALLOCATOR",
-            "USE_ZIG_ALLOCATOR",
-            "USE_CLANG_ALLOCATOR",
-        };
-
         // Build test scenarios
         inline for (allocator_options) |allocator| {
-            const test_name = build_ctx.fmt("test_scenario_{s}", .{allocator});
-
-            // Build the library
-            const lib = try OSBuilder.init(
-                build_ctx,
-                .{
-                    .optimize = .Debug,
-                    .target = "testing",
-                    .lib_type = "Static",
-                },
-                allocator, // Add -D prefix
-            );
-
-            // Create test runner
-            const run_test = build_ctx.addTest(.{
-                .name = test_name,
-                .root_source_file = .{ .cwd_relative = "tests/main_test.zig" },
-                .optimize = .Debug,
-                .target = target_options,
-                .link_libc = true,
-            });
-
-            // Link with the library and add include paths
-            run_test.linkLibrary(lib);
-            run_test.addIncludePath(.{ .cwd_relative = build_root ++ "/inc" });
-            run_test.addIncludePath(.{ .cwd_relative = build_root ++ "/src" });
-
-            run_test.defineCMacro("TESTING_MODE", "1");
-            run_test.defineCMacro(allocator, "1");
-
-            // Create run step for this test
-            const run_test_step = build_ctx.addRunArtifact(run_test);
-            run_test_step.step.dependOn(&lib.step);
-            test_step.dependOn(&run_test_step.step);
+            try addTestScenario(build_ctx, test_step, target_options, allocator, &.{});
         }
+
+        // Concurrent heap: list allocator behind per-thread caches
+        try addTestScenario(build_ctx, test_step, target_options, "USE_LIST_ALLOCATOR", &.{"HEAP_THREAD_SAFE"});
+
+        // Allocation tracing on top of the list allocator
+        try addTestScenario(build_ctx, test_step, target_options, "USE_LIST_ALLOCATOR", &.{"HEAP_TRACE"});
+
+        // Guarded list allocator
+        try addTestScenario(build_ctx, test_step, target_options, "USE_LIST_ALLOCATOR", &.{"HEAP_DEBUG"});
+
+        // Fixed-priority task scheduler
+        try addTestScenario(build_ctx, test_step, target_options, "USE_LIST_ALLOCATOR", &.{"PRIORITY_BASED_SCHEDULING"});
+
+        // Earliest-deadline-first task scheduler
+        try addTestScenario(build_ctx, test_step, target_options, "USE_LIST_ALLOCATOR", &.{"EARLIEST_DEADLINE_FIRST_SCHEDULING"});
+    }
+}
+
+fn addTestScenario(
+    build_ctx: *std.Build,
+    test_step: *std.Build.Step,
+    target_options: std.Build.ResolvedTarget,
+    allocator: []const u8,
+    defines: []const []const u8,
+) !void {
+    var test_name = build_ctx.fmt("test_scenario_{s}", .{allocator});
+    for (defines) |define| {
+        test_name = build_ctx.fmt("{s}_{s}", .{ test_name, define });
+    }
+
+    // Build the library
+    const lib = try OSBuilder.init(
+        build_ctx,
+        .{
+            .optimize = .Debug,
+            .target = "testing",
+            .lib_type = "Static",
+            .defines = defines,
+        },
+        allocator, // Add -D prefix
+    );
+
+    // Create test runner
+    const run_test = build_ctx.addTest(.{
+        .name = test_name,
+        .root_source_file = .{ .cwd_relative = "tests/main_test.zig" },
+        .optimize = .Debug,
+        .target = target_options,
+        .link_libc = true,
+    });
+
+    // Link with the library and add include paths
+    run_test.linkLibrary(lib);
+    run_test.addIncludePath(.{ .cwd_relative = build_root ++ "/inc" });
+    run_test.addIncludePath(.{ .cwd_relative = build_root ++ "/src" });
+    run_test.root_module.addImport("TaskGraph", taskGraphModule(build_ctx, defines));
+
+    // Task bodies written with the C-only TASK_* macros
+    run_test.addCSourceFile(.{ .file = .{ .cwd_relative = build_root ++ "/tests/task_macros.c" } });
+
+    run_test.defineCMacro("TESTING_MODE", "1");
+    run_test.defineCMacro(allocator, "1");
+    for (defines) |define| {
+        run_test.defineCMacro(define, "1");
+    }
+
+    // Create run step for this test
+    const run_test_step = build_ctx.addRunArtifact(run_test);
+    run_test_step.step.dependOn(&lib.step);
+    test_step.dependOn(&run_test_step.step);
+}
+
+/// Compile-time task graphs, built with the same feature macros as the
+/// library so the task control block layout matches
+fn taskGraphModule(build_ctx: *std.Build, defines: []const []const u8) *std.Build.Module {
+    const module = build_ctx.createModule(.{
+        .root_source_file = .{ .cwd_relative = build_root ++ "/src/virtualization/cpu/TaskGraph.zig" },
+    });
+    module.addIncludePath(.{ .cwd_relative = build_root ++ "/inc" });
+    for (defines) |define| {
+        module.addCMacro(define, "1");
+    }
+    return module;
+}
+
+fn addBenchScenario(
+    build_ctx: *std.Build,
+    bench_step: *std.Build.Step,
+    target_options: std.Build.ResolvedTarget,
+    suite: []const u8,
+    allocator: []const u8,
+    defines: []const []const u8,
+) !void {
+    var bench_name = build_ctx.fmt("bench_{s}_{s}", .{ suite, allocator });
+    for (defines) |define| {
+        bench_name = build_ctx.fmt("{s}_{s}", .{ bench_name, define });
+    }
+
+    // Build the library
+    const lib = try OSBuilder.init(
+        build_ctx,
+        .{
+            .optimize = .ReleaseFast,
+            .target = "testing",
+            .lib_type = "Static",
+            .defines = defines,
+        },
+        allocator,
+    );
+
+    const bench = build_ctx.addExecutable(.{
+        .name = bench_name,
+        .root_source_file = .{ .cwd_relative = build_ctx.fmt("{s}/bench/{s}_bench.zig", .{ build_root, suite }) },
+        .optimize = .ReleaseFast,
+        .target = target_options,
+        .link_libc = true,
+    });
+
+    // Link with the library and add include paths
+    bench.linkLibrary(lib);
+    bench.addIncludePath(.{ .cwd_relative = build_root ++ "/inc" });
+
+    bench.defineCMacro("TESTING_MODE", "1");
+    bench.defineCMacro(allocator, "1");
+    for (defines) |define| {
+        bench.defineCMacro(define, "1");
+    }
+
+    // Benchmarks run one after another so they do not compete for the CPU,
+    // and the heap ones get trace files: zig build bench -- a.trace b.trace
+    const run_bench = build_ctx.addRunArtifact(bench);
+    if (build_ctx.args) |args| {
+        if (std.mem.eql(u8, suite, "heap")) run_bench.addArgs(args);
+    }
+    run_bench.has_side_effects = true;
+    if (bench_step.dependencies.items.len > 0) {
+        run_bench.step.dependOn(bench_step.dependencies.items[bench_step.dependencies.items.len - 1]);
     }
+    bench_step.dependOn(&run_bench.step);
 }
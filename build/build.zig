@@ -9,6 +9,8 @@ pub const InitOptions = struct {
     optimize: std.builtin.OptimizeMode,
     target: []const u8,
     lib_type: []const u8,
+    /// Extra feature macros, each defined as 1 (e.g. HEAP_THREAD_SAFE)
+    defines: []const []const u8 = &.{},
 };
 
 var library: *std.Build.Step.Compile = undefined;
@@ -123,8 +125,22 @@ pub fn init(b: *std.Build, options: InitOptions, extraflags: []const u8) !*std.B
         .files = source_slice,
         .flags = cflags,
     });
+
+    // C++ sources (the std containers) take the same flags in C++ mode;
+    // they export a C ABI and use no exceptions, RTTI or runtime library
+    const cpp_source_slice = try OSBuilder.make.GlobFiles(b, "src/", ".cpp");
+    const cppflags = b.allocator.dupe([]const u8, cflags) catch unreachable;
+    defer b.allocator.free(cppflags);
+    cppflags[0] = "-std=c++17";
+    lib.addCSourceFiles(.{
+        .files = cpp_source_slice,
+        .flags = cppflags,
+    });
     lib.defineCMacro("TESTING_MODE", "1");
     lib.defineCMacro(extraflags, "1");
+    for (options.defines) |define| {
+        lib.defineCMacro(define, "1");
+    }
     //std.debug.print("Received sources: {s}\n", .{source_slice});
     lib.addIncludePath(.{ .cwd_relative = build_root ++ "/../inc" });
 
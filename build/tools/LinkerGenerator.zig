@@ -127,6 +127,15 @@ pub fn GenerateLinkerFile(target: Targets.TargetType, output_path: []const u8, e
         \\ }
     );
 
+    // Expose the bounds of every RAM region, so extra heaps can be created
+    // over them with HeapCreate
+    try writer.writeAll("\n");
+    for (0..ram_counter) |index| {
+        try writer.print(" _ram{d}_start = ORIGIN(ram{d});\n _ram{d}_end = ORIGIN(ram{d}) + LENGTH(ram{d});\n", .{
+            index, index, index, index, index,
+        });
+    }
+
     // Add memory overflow assertions
     try writer.writeAll(
         \\ ASSERT(SIZEOF(.text) + SIZEOF(.data) < LENGTH(flash0), "Flash memory overflow");
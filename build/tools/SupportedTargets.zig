@@ -81,7 +81,10 @@ pub const Targets = struct {
         .mcu_sub_family = "STM32H743",
         .memory_regions = &[_]MemoryRegion{
             MemoryRegion{ .kind = .flash, .offset = 0x08000000, .length = 0x00200000 }, // 2MB flash
-            MemoryRegion{ .kind = .ram, .offset = 0x24000000, .length = 0x00080000 }, // 512KB RAM
+            MemoryRegion{ .kind = .ram, .offset = 0x24000000, .length = 0x00080000 }, // 512KB AXI SRAM
+            MemoryRegion{ .kind = .ram, .offset = 0x20000000, .length = 0x00020000 }, // 128KB DTCM
+            MemoryRegion{ .kind = .ram, .offset = 0x30000000, .length = 0x00048000 }, // 288KB SRAM1-3 (D2)
+            MemoryRegion{ .kind = .ram, .offset = 0x38000000, .length = 0x00010000 }, // 64KB SRAM4 (D3)
         },
         .memory_alignment = 32, // 32-byte alignment for high-performance MCU
         .cpu_model = &std.Target.arm.cpu.cortex_m7,
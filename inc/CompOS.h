@@ -2,8 +2,11 @@
 #define COMPOS_UTILITY_H_
 
 #include "assert.h"
+#include "bits.h"
 #include "math.h"
 #include "virtualization/cpu/scheduling.h"
+#include "virtualization/memory/arena.h"
 #include "virtualization/memory/heap.h"
+#include "virtualization/memory/pool.h"
 
 #endif // COMPOS_UTILITY_H
@@ -0,0 +1,138 @@
+#ifndef COMPOS_BITS_H_
+#define COMPOS_BITS_H_
+
+#include "types.h"
+
+/*
+ * Bit scans for allocators, schedulers and bitmaps.
+ *
+ * The compiler builtins lower to a single instruction where there is one
+ * (CLZ and RBIT on Cortex-M3 and up, LZCNT/TZCNT or BSR/BSF on x86). ARMv6-M
+ * cores such as the Cortex-M0 have no CLZ, and there the builtins become
+ * libgcc/compiler-rt calls; a branch-light binary search is used instead.
+ * Define BITS_SOFTWARE_SCAN to force the fallback on any target.
+ *
+ * Unless noted otherwise, results are undefined for a zero argument.
+ */
+
+#if defined(__arm__) && !defined(__ARM_FEATURE_CLZ) &&                         \
+    !defined(BITS_SOFTWARE_SCAN)
+#define BITS_SOFTWARE_SCAN
+#endif
+
+/** @brief Leading zeros of a 32-bit value; 32 for zero. Any target. */
+static inline uint_fast8_t SoftwareClz32(uint32_t x) {
+  uint_fast8_t n = 0;
+  if (x == 0U) {
+    return 32U;
+  }
+  if ((x & 0xFFFF0000U) == 0U) {
+    n += 16U;
+    x <<= 16U;
+  }
+  if ((x & 0xFF000000U) == 0U) {
+    n += 8U;
+    x <<= 8U;
+  }
+  if ((x & 0xF0000000U) == 0U) {
+    n += 4U;
+    x <<= 4U;
+  }
+  if ((x & 0xC0000000U) == 0U) {
+    n += 2U;
+    x <<= 2U;
+  }
+  if ((x & 0x80000000U) == 0U) {
+    n += 1U;
+  }
+  return n;
+}
+
+/** @brief Trailing zeros of a 32-bit value; 32 for zero. Any target. */
+static inline uint_fast8_t SoftwareCtz32(const uint32_t x) {
+  // Isolate the lowest set bit, then its position is 31 - clz
+  return (x == 0U) ? 32U : (uint_fast8_t)(31U - SoftwareClz32(x & (~x + 1U)));
+}
+
+/** @brief Count of leading zero bits in a 32-bit value. */
+static inline uint_fast8_t Clz32(const uint32_t x) {
+#ifdef BITS_SOFTWARE_SCAN
+  return SoftwareClz32(x);
+#elif __SIZEOF_INT__ >= 4
+  return (uint_fast8_t)__builtin_clz(x);
+#else
+  return (uint_fast8_t)__builtin_clzl(x);
+#endif
+}
+
+/** @brief Count of trailing zero bits in a 32-bit value. */
+static inline uint_fast8_t Ctz32(const uint32_t x) {
+#ifdef BITS_SOFTWARE_SCAN
+  return SoftwareCtz32(x);
+#elif __SIZEOF_INT__ >= 4
+  return (uint_fast8_t)__builtin_ctz(x);
+#else
+  return (uint_fast8_t)__builtin_ctzl(x);
+#endif
+}
+
+/** @brief Count of leading zero bits in a 64-bit value. */
+static inline uint_fast8_t Clz64(const uint64_t x) {
+#ifdef BITS_SOFTWARE_SCAN
+  const uint32_t high = (uint32_t)(x >> 32U);
+  return (high != 0U) ? SoftwareClz32(high)
+                      : (uint_fast8_t)(32U + SoftwareClz32((uint32_t)x));
+#else
+  return (uint_fast8_t)__builtin_clzll(x);
+#endif
+}
+
+/** @brief Count of trailing zero bits in a 64-bit value. */
+static inline uint_fast8_t Ctz64(const uint64_t x) {
+#ifdef BITS_SOFTWARE_SCAN
+  const uint32_t low = (uint32_t)x;
+  return (low != 0U) ? SoftwareCtz32(low)
+                     : (uint_fast8_t)(32U + SoftwareCtz32((uint32_t)(x >> 32U)));
+#else
+  return (uint_fast8_t)__builtin_ctzll(x);
+#endif
+}
+
+/** @brief Number of set bits in a 32-bit value. */
+static inline uint_fast8_t PopCount32(uint32_t x) {
+#ifdef BITS_SOFTWARE_SCAN
+  x = x - ((x >> 1U) & 0x55555555U);
+  x = (x & 0x33333333U) + ((x >> 2U) & 0x33333333U);
+  x = (x + (x >> 4U)) & 0x0F0F0F0FU;
+  return (uint_fast8_t)((x * 0x01010101U) >> 24U);
+#elif __SIZEOF_INT__ >= 4
+  return (uint_fast8_t)__builtin_popcount(x);
+#else
+  return (uint_fast8_t)__builtin_popcountl(x);
+#endif
+}
+
+/*
+ * size_t variants, for allocator size classes and word-sized bitmaps.
+ */
+#if ARCH_BITS == 64
+#define SIZE_BITS 64U
+#define ClzSize(x) Clz64((uint64_t)(x))
+#define CtzSize(x) Ctz64((uint64_t)(x))
+#else
+#define SIZE_BITS 32U
+#define ClzSize(x) Clz32((uint32_t)(x))
+#define CtzSize(x) Ctz32((uint32_t)(x))
+#endif
+
+/** @brief Index of the highest set bit, i.e. floor(log2(x)). */
+static inline uint_fast8_t Log2Floor(const size_t x) {
+  return (uint_fast8_t)((SIZE_BITS - 1U) - ClzSize(x));
+}
+
+/** @brief ceil(log2(x)); 0 for x <= 1. */
+static inline uint_fast8_t Log2Ceil(const size_t x) {
+  return (x <= 1U) ? 0U : (uint_fast8_t)(SIZE_BITS - ClzSize(x - 1U));
+}
+
+#endif
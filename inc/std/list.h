@@ -1,3 +1,28 @@
+/**
+ * @file list.h
+ * @brief Intrusive doubly linked list.
+ *
+ * The `ListNode` is embedded in the object it links, so putting an object on
+ * a list never allocates and every operation except walking is O(1): the
+ * object is its own list entry. `LIST_ENTRY` gets from a node back to the
+ * object around it.
+ *
+ * @code
+ * typedef struct Timer { uint32_t expiry; ListNode link; } Timer;
+ *
+ * List timers;
+ * ListInit(&timers);
+ * ListPushBack(&timers, &timer.link);
+ * Timer *first = LIST_ENTRY(timers.head, Timer, link);
+ * @endcode
+ *
+ * A list is `NULL`-terminated at both ends, so a zeroed `List` is empty and
+ * static lists need no initialization. An object may sit on as many lists
+ * at once as it has nodes, but each node on at most one.
+ *
+ * The node-level `ListLinkAfter` and `ListUnlink` also maintain chains that
+ * have no `List` at all, such as blocks linked in address order.
+ */
 #ifndef COMPOS_STD_LIST_H
 #define COMPOS_STD_LIST_H
 
@@ -7,6 +32,168 @@
 extern "C" {
 #endif
 
+typedef struct ListNode {
+  struct ListNode *next; /**< `NULL` at the tail. */
+  struct ListNode *prev; /**< `NULL` at the head. */
+} ListNode;
+
+typedef struct List {
+  ListNode *head;
+  ListNode *tail;
+} List;
+
+/**
+ * @brief The object of type `type` whose member `member` is `node`; `node`
+ * must not be `NULL`.
+ */
+#define LIST_ENTRY(node, type, member)                                         \
+  ((type *)(void *)((char *)(node) - __builtin_offsetof(type, member)))
+
+/**
+ * @brief Orders two nodes for `ListInsertSorted`: negative, zero or positive
+ * as `a` belongs before, level with or after `b`.
+ */
+typedef int (*ListCompare)(const ListNode *a, const ListNode *b);
+
+static inline void ListInit(List *list) {
+  list->head = (ListNode *)NULL;
+  list->tail = (ListNode *)NULL;
+}
+
+static inline uint8_t ListEmpty(const List *list) {
+  return list->head == NULL;
+}
+
+/**
+ * @brief Links `node` in right after `position` in a chain without a `List`.
+ */
+static inline void ListLinkAfter(ListNode *position, ListNode *node) {
+  node->prev = position;
+  node->next = position->next;
+  if (position->next != NULL) {
+    position->next->prev = node;
+  }
+  position->next = node;
+}
+
+/**
+ * @brief Takes `node` out of a chain without a `List`. Its own links are
+ * left as they were.
+ */
+static inline void ListUnlink(ListNode *node) {
+  if (node->prev != NULL) {
+    node->prev->next = node->next;
+  }
+  if (node->next != NULL) {
+    node->next->prev = node->prev;
+  }
+}
+
+static inline void ListPushBack(List *list, ListNode *node) {
+  node->next = (ListNode *)NULL;
+  node->prev = list->tail;
+  if (list->tail != NULL) {
+    list->tail->next = node;
+  } else {
+    list->head = node;
+  }
+  list->tail = node;
+}
+
+static inline void ListPushFront(List *list, ListNode *node) {
+  node->prev = (ListNode *)NULL;
+  node->next = list->head;
+  if (list->head != NULL) {
+    list->head->prev = node;
+  } else {
+    list->tail = node;
+  }
+  list->head = node;
+}
+
+/**
+ * @brief Inserts `node` after `position`, which must be on `list`.
+ */
+static inline void ListInsertAfter(List *list, ListNode *position,
+                                   ListNode *node) {
+  ListLinkAfter(position, node);
+  if (list->tail == position) {
+    list->tail = node;
+  }
+}
+
+/**
+ * @brief Inserts `node` before `position`, which must be on `list`.
+ */
+static inline void ListInsertBefore(List *list, ListNode *position,
+                                    ListNode *node) {
+  if (position->prev != NULL) {
+    ListLinkAfter(position->prev, node);
+  } else {
+    ListPushFront(list, node);
+  }
+}
+
+/**
+ * @brief Removes `node`, which must be on `list`.
+ */
+static inline void ListRemove(List *list, ListNode *node) {
+  if (list->head == node) {
+    list->head = node->next;
+  }
+  if (list->tail == node) {
+    list->tail = node->prev;
+  }
+  ListUnlink(node);
+}
+
+/**
+ * @brief Removes and returns the first node, or `NULL` if the list is empty.
+ */
+static inline ListNode *ListPopFront(List *list) {
+  ListNode *const node = list->head;
+  if (node != NULL) {
+    list->head = node->next;
+    if (node->next != NULL) {
+      node->next->prev = (ListNode *)NULL;
+    } else {
+      list->tail = (ListNode *)NULL;
+    }
+  }
+  return node;
+}
+
+/**
+ * @brief Moves every node of `other` to the end of `list`, leaving `other`
+ * empty.
+ */
+static inline void ListSplice(List *list, List *other) {
+  if (other->head == NULL) {
+    return;
+  }
+  if (list->tail != NULL) {
+    list->tail->next = other->head;
+    other->head->prev = list->tail;
+  } else {
+    list->head = other->head;
+  }
+  list->tail = other->tail;
+  ListInit(other);
+}
+
+/**
+ * @brief Number of nodes; walks the whole list.
+ */
+extern size_t ListCount(const List *list);
+
+/**
+ * @brief Inserts `node` after every node that does not order after it, so
+ * nodes that compare equal stay in insertion order.
+ *
+ * Searches from the tail, which makes appending in order, as with timer
+ * expiries or deadlines that mostly grow, O(1).
+ */
+extern void ListInsertSorted(List *list, ListNode *node, ListCompare compare);
 
 #ifdef __cplusplus
 }
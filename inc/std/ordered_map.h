@@ -1,12 +1,307 @@
+/**
+ * @file ordered_map.h
+ * @brief Ordered map on a B+-tree with fixed-size nodes.
+ *
+ * Every node is one block of `node_size` bytes, ORDERED_MAP_NODE_SIZE unless
+ * the keys are too large for that, so a Pool of that object size can serve
+ * all of a map's allocations. A node keeps its keys contiguous at the front:
+ * a search within it is a binary search over a few cache lines instead of
+ * one cache miss per level of a binary tree.
+ *
+ * Entries live in the leaves, which are chained in key order; branches only
+ * route. Iterators are a leaf and an index, so `OrderedMapLowerBound` plus
+ * `OrderedMapNext` walks any range without going back up the tree. Any
+ * insert or remove invalidates iterators and pointers into the map.
+ *
+ * Keys are ordered by a compare function, or, when it is `NULL`, as unsigned
+ * integers if they are 1, 2, 4 or 8 bytes and as byte strings otherwise.
+ * Nodes come from a MemoryResource, `NULL` for the default heap.
+ */
 #ifndef COMPOS_ORDERED_MAP_H_
 #define COMPOS_ORDERED_MAP_H_
 #include "types.h"
+#include "virtualization/memory/resource.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Bytes per node: 4 cache lines on most cores, 8 on a Cortex-M7,
+ * which with word-sized keys gives about 30 entries per node.
+ */
+#ifndef ORDERED_MAP_NODE_SIZE
+#define ORDERED_MAP_NODE_SIZE 256U
+#endif
+
+/**
+ * @brief Deepest tree supported; far beyond what fits in memory, as each
+ * level multiplies the entries by at least 3.
+ */
+#define ORDERED_MAP_MAX_DEPTH 24U
+
+/**
+ * @brief Orders two keys: negative, zero or positive as `a` is below, equal
+ * to or above `b`.
+ */
+typedef int (*OrderedCompare)(const void *a, const void *b, size_t key_size);
+
+typedef struct OrderedMapNode {
+  struct OrderedMapNode *next; /**< Next leaf in key order; leaves only. */
+  uint16_t count;              /**< Entries of a leaf, keys of a branch. */
+  uint8_t leaf;
+} OrderedMapNode;
+
+typedef struct OrderedMap {
+  OrderedMapNode *root;
+  OrderedMapNode *first; /**< Leftmost leaf, where iteration starts. */
+  size_t size;
+  size_t key_size;
+  size_t value_size;
+  size_t node_size;       /**< Bytes of every node. */
+  size_t leaf_capacity;   /**< Entries per leaf. */
+  size_t branch_capacity; /**< Keys per branch; it has one child more. */
+  size_t value_offset;    /**< Values' position within a leaf. */
+  size_t child_offset;    /**< Children's position within a branch. */
+  size_t depth;           /**< Levels, leaves included; 0 when empty. */
+  OrderedCompare compare; /**< `NULL` for the default order. */
+  const MemoryResource *resource;
+} OrderedMap;
+
+/**
+ * @brief Position of an entry; `leaf == NULL` past the end.
+ */
+typedef struct OrderedMapIterator {
+  const OrderedMapNode *leaf;
+  size_t index;
+} OrderedMapIterator;
+
+/**
+ * @brief Sets up an empty map; nothing is allocated until the first insert.
+ */
+extern void OrderedMapInit(OrderedMap *map, size_t key_size, size_t value_size,
+                           OrderedCompare compare,
+                           const MemoryResource *resource);
+
+/**
+ * @brief Frees every node, leaving an empty map that can be reused.
+ */
+extern void OrderedMapDestroy(OrderedMap *map);
+
+/**
+ * @brief Fills an empty map from `count` keys in strictly ascending order
+ * and their values (`NULL` to zero them), building full nodes bottom-up
+ * without a single search or split.
+ *
+ * @return `1` on success, `0` if the map is not empty, the keys are not
+ * strictly ascending or out of memory; the map is then left empty.
+ */
+extern uint8_t OrderedMapBulkLoad(OrderedMap *map, const void *keys,
+                                  const void *values, size_t count);
+
+/**
+ * @brief Looks up `key`.
+ *
+ * @return Its value, or `NULL` if absent.
+ */
+extern void *OrderedMapFind(const OrderedMap *map, const void *key);
+
+/**
+ * @brief Finds or adds `key`.
+ *
+ * @param inserted Set to `1` if the entry is new, its value then being
+ * uninitialized; may be `NULL`.
+ * @return The value, or `NULL` if out of memory; the map is then unchanged.
+ */
+extern void *OrderedMapInsert(OrderedMap *map, const void *key,
+                              uint8_t *inserted);
+
+/**
+ * @brief Adds or overwrites the entry for `key`.
+ *
+ * @return `1` on success, `0` if out of memory.
+ */
+extern uint8_t OrderedMapPut(OrderedMap *map, const void *key,
+                             const void *value);
+
+/**
+ * @brief Removes `key`, merging nodes that fall below half full.
+ *
+ * @return `1` if it was present.
+ */
+extern uint8_t OrderedMapRemove(OrderedMap *map, const void *key);
+
+/**
+ * @brief Positions `iterator` at the smallest entry.
+ */
+extern void OrderedMapFirst(const OrderedMap *map,
+                            OrderedMapIterator *iterator);
+
+/**
+ * @brief Positions `iterator` at the first entry not below `key`.
+ */
+extern void OrderedMapLowerBound(const OrderedMap *map, const void *key,
+                                 OrderedMapIterator *iterator);
+
+/**
+ * @brief Positions `iterator` at the first entry above `key`.
+ */
+extern void OrderedMapUpperBound(const OrderedMap *map, const void *key,
+                                 OrderedMapIterator *iterator);
+
+/**
+ * @brief Returns the entry at `iterator` and advances it.
+ *
+ * Fills `key` and `value`, either of which may be `NULL`.
+ *
+ * @return `1` if an entry was returned, `0` at the end.
+ */
+extern uint8_t OrderedMapNext(const OrderedMap *map,
+                              OrderedMapIterator *iterator, void **key,
+                              void **value);
+
 #ifdef __cplusplus
 }
-#endif
+
+namespace compos {
+
+/**
+ * @brief Default order for `OrderedMap`/`OrderedSet`: `operator<`.
+ */
+template <typename K> struct Less {
+  bool operator()(const K &a, const K &b) const { return a < b; }
+};
+
+/**
+ * @brief Whether the C side's default order is the same as `Less<K>`, so
+ * that no compare callback is needed.
+ */
+template <typename K> struct NativeOrder {
+  static const bool value = false;
+};
+template <> struct NativeOrder<unsigned char> {
+  static const bool value = true;
+};
+template <> struct NativeOrder<unsigned short> {
+  static const bool value = true;
+};
+template <> struct NativeOrder<unsigned int> {
+  static const bool value = true;
+};
+template <> struct NativeOrder<unsigned long> {
+  static const bool value = true;
+};
+template <> struct NativeOrder<unsigned long long> {
+  static const bool value = true;
+};
+
+/**
+ * @brief Compare callback for typed trees.
+ */
+template <typename K, typename Compare> struct OrderedTraits {
+  static int compare(const void *a, const void *b, size_t) {
+    const K &x = *static_cast<const K *>(a);
+    const K &y = *static_cast<const K *>(b);
+    return Compare()(x, y) ? -1 : (Compare()(y, x) ? 1 : 0);
+  }
+
+  static OrderedCompare compareFunction() {
+    return (NativeOrder<K>::value && __is_same(Compare, Less<K>)) ? nullptr
+                                                                   : &compare;
+  }
+};
+
+/**
+ * @brief Typed map over the C interface. Keys and values are moved as bytes,
+ * so both must be trivially copyable.
+ */
+template <typename K, typename V, typename Compare = Less<K>>
+class OrderedMap {
+  static_assert(__is_trivially_copyable(K) && __is_trivially_copyable(V),
+                "entries are relocated as bytes");
+
+public:
+  explicit OrderedMap(const MemoryResource *resource = nullptr) {
+    OrderedMapInit(&map_, sizeof(K), sizeof(V), Traits::compareFunction(),
+                   resource);
+  }
+
+  OrderedMap(const OrderedMap &) = delete;
+  OrderedMap &operator=(const OrderedMap &) = delete;
+  ~OrderedMap() { OrderedMapDestroy(&map_); }
+
+  size_t size() const { return map_.size; }
+  bool empty() const { return map_.size == 0; }
+  void clear() { OrderedMapDestroy(&map_); }
+
+  /** Fills an empty map from keys in strictly ascending order. */
+  bool bulk_load(const K *keys, const V *values, size_t count) {
+    return OrderedMapBulkLoad(&map_, keys, values, count);
+  }
+
+  V *find(const K &key) {
+    return static_cast<V *>(OrderedMapFind(&map_, &key));
+  }
+  const V *find(const K &key) const {
+    return static_cast<const V *>(OrderedMapFind(&map_, &key));
+  }
+  bool contains(const K &key) const { return find(key) != nullptr; }
+
+  /** Adds or overwrites; `false` if out of memory. */
+  bool insert(const K &key, const V &value) {
+    return OrderedMapPut(&map_, &key, &value);
+  }
+
+  /** The value for `key`, value-initialized if new; `nullptr` if out of
+   * memory. */
+  V *try_emplace(const K &key) {
+    uint8_t inserted = 0;
+    V *const value =
+        static_cast<V *>(OrderedMapInsert(&map_, &key, &inserted));
+    if (value != nullptr && inserted) {
+      *value = V();
+    }
+    return value;
+  }
+
+  bool erase(const K &key) { return OrderedMapRemove(&map_, &key); }
+
+  /** Calls `function(key, value)` for every entry in key order. */
+  template <typename F> void for_each(F function) {
+    OrderedMapIterator iterator;
+    OrderedMapFirst(&map_, &iterator);
+    visit(&iterator, nullptr, function);
+  }
+
+  /** Calls `function(key, value)` for every entry in `[from, to)`. */
+  template <typename F>
+  void for_each_range(const K &from, const K &to, F function) {
+    OrderedMapIterator iterator;
+    OrderedMapLowerBound(&map_, &from, &iterator);
+    visit(&iterator, &to, function);
+  }
+
+  ::OrderedMap *c_map() { return &map_; }
+
+private:
+  typedef OrderedTraits<K, Compare> Traits;
+
+  template <typename F>
+  void visit(OrderedMapIterator *iterator, const K *to, F &function) {
+    void *key = nullptr;
+    void *value = nullptr;
+    while (OrderedMapNext(&map_, iterator, &key, &value)) {
+      const K &current = *static_cast<const K *>(key);
+      if (to != nullptr && !Compare()(current, *to)) {
+        return;
+      }
+      function(current, *static_cast<V *>(value));
+    }
+  }
+
+  ::OrderedMap map_;
+};
+
+} // namespace compos
+#endif // __cplusplus
 #endif // COMPOS_ORDERED_MAP_H_
@@ -1,12 +1,137 @@
+/**
+ * @file ordered_set.h
+ * @brief Ordered set on a B+-tree.
+ *
+ * A set is an OrderedMap without values and shares its nodes, order and
+ * iterators; see ordered_map.h. `OrderedMapFirst`, `OrderedMapLowerBound`
+ * and `OrderedMapUpperBound` position iterators on a set as well.
+ */
 #ifndef COMPOS_ORDERED_SET_H_
 #define COMPOS_ORDERED_SET_H_
 #include "types.h"
+#include "std/ordered_map.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef OrderedMap OrderedSet;
+
+/**
+ * @brief Sets up an empty set; nothing is allocated until the first add.
+ */
+extern void OrderedSetInit(OrderedSet *set, size_t key_size,
+                           OrderedCompare compare,
+                           const MemoryResource *resource);
+
+/**
+ * @brief Frees every node, leaving an empty set that can be reused.
+ */
+extern void OrderedSetDestroy(OrderedSet *set);
+
+/**
+ * @brief Fills an empty set from `count` keys in strictly ascending order.
+ *
+ * @return `1` on success, `0` under the same conditions as
+ * `OrderedMapBulkLoad`.
+ */
+extern uint8_t OrderedSetBulkLoad(OrderedSet *set, const void *keys,
+                                  size_t count);
+
+/**
+ * @brief Adds `key` if it is not in the set yet.
+ *
+ * @return `1` if `key` is now in the set, `0` if out of memory.
+ */
+extern uint8_t OrderedSetAdd(OrderedSet *set, const void *key);
+
+/**
+ * @brief Whether `key` is in the set.
+ */
+extern uint8_t OrderedSetContains(const OrderedSet *set, const void *key);
+
+/**
+ * @brief Removes `key`.
+ *
+ * @return `1` if it was present.
+ */
+extern uint8_t OrderedSetRemove(OrderedSet *set, const void *key);
+
+/**
+ * @brief Returns the key at `iterator` and advances it, as `OrderedMapNext`.
+ */
+extern uint8_t OrderedSetNext(const OrderedSet *set,
+                              OrderedMapIterator *iterator, void **key);
+
 #ifdef __cplusplus
 }
-#endif
+
+namespace compos {
+
+/**
+ * @brief Typed set over the C interface; keys must be trivially copyable.
+ */
+template <typename K, typename Compare = Less<K>> class OrderedSet {
+  static_assert(__is_trivially_copyable(K), "keys are relocated as bytes");
+
+public:
+  explicit OrderedSet(const MemoryResource *resource = nullptr) {
+    OrderedSetInit(&set_, sizeof(K), Traits::compareFunction(), resource);
+  }
+
+  OrderedSet(const OrderedSet &) = delete;
+  OrderedSet &operator=(const OrderedSet &) = delete;
+  ~OrderedSet() { OrderedSetDestroy(&set_); }
+
+  size_t size() const { return set_.size; }
+  bool empty() const { return set_.size == 0; }
+  void clear() { OrderedSetDestroy(&set_); }
+
+  /** Fills an empty set from keys in strictly ascending order. */
+  bool bulk_load(const K *keys, size_t count) {
+    return OrderedSetBulkLoad(&set_, keys, count);
+  }
+
+  bool contains(const K &key) const { return OrderedSetContains(&set_, &key); }
+  /** `false` only if out of memory. */
+  bool insert(const K &key) { return OrderedSetAdd(&set_, &key); }
+  bool erase(const K &key) { return OrderedSetRemove(&set_, &key); }
+
+  /** Calls `function(key)` for every key in order. */
+  template <typename F> void for_each(F function) const {
+    OrderedMapIterator iterator;
+    OrderedMapFirst(&set_, &iterator);
+    visit(&iterator, nullptr, function);
+  }
+
+  /** Calls `function(key)` for every key in `[from, to)`. */
+  template <typename F>
+  void for_each_range(const K &from, const K &to, F function) const {
+    OrderedMapIterator iterator;
+    OrderedMapLowerBound(&set_, &from, &iterator);
+    visit(&iterator, &to, function);
+  }
+
+  ::OrderedSet *c_set() { return &set_; }
+
+private:
+  typedef OrderedTraits<K, Compare> Traits;
+
+  template <typename F>
+  void visit(OrderedMapIterator *iterator, const K *to, F &function) const {
+    void *key = nullptr;
+    while (OrderedSetNext(&set_, iterator, &key)) {
+      const K &current = *static_cast<const K *>(key);
+      if (to != nullptr && !Compare()(current, *to)) {
+        return;
+      }
+      function(current);
+    }
+  }
+
+  ::OrderedSet set_;
+};
+
+} // namespace compos
+#endif // __cplusplus
 #endif // COMPOS_ORDERED_SET_H_
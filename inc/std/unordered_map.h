@@ -1,12 +1,266 @@
+/**
+ * @file unordered_map.h
+ * @brief Flat open-addressing hash map with group-probed control bytes.
+ *
+ * Entries live inline in one slot array, next to an array of one control
+ * byte per slot: 0x80 for an empty slot, or 7 bits of the key's hash for a
+ * full one. A lookup loads a whole group of control bytes at once (16 with
+ * SSE2, otherwise 8 in a 64-bit word) and compares them all against the
+ * key's hash bits, so it touches the keys of likely matches only.
+ *
+ * Probing is linear from the slot the hash picks, and removal shifts the
+ * following entries of the run back instead of leaving tombstones, so
+ * lookups never slow down with churn and the table never needs a cleanup
+ * rehash.
+ *
+ * Keys are compared as bytes unless an equality function is given, so keys
+ * with padding or pointers to data need their own hash and equality. Entries
+ * move when the table grows or an entry is removed; pointers into the table
+ * are only valid until the next insert or remove.
+ *
+ * Tables allocate from a MemoryResource (`NULL` for the default heap), or
+ * live entirely in caller storage with `HashMapInitFixed`, sized by
+ * HASH_MAP_STORAGE_SIZE, and then never allocate.
+ */
 #ifndef COMPOS_UNORDERED_MAP_H_
 #define COMPOS_UNORDERED_MAP_H_
 #include "types.h"
+#include "virtualization/memory/resource.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Control bytes compared per probe step.
+ */
+#if defined(__SSE2__) && !defined(HASH_MAP_SWAR)
+#define HASH_MAP_GROUP_WIDTH 16U
+#else
+#define HASH_MAP_GROUP_WIDTH 8U
+#endif
+
+/**
+ * @brief Most entries per slot before the table grows (or, when fixed,
+ * refuses inserts), as a fraction.
+ */
+#define HASH_MAP_MAX_LOAD_NUMERATOR 3U
+#define HASH_MAP_MAX_LOAD_DENOMINATOR 4U
+
+/**
+ * @brief Storage that `HashMapInitFixed` needs for `capacity` slots, a
+ * power of two of at least HASH_MAP_GROUP_WIDTH. To be 8-byte aligned.
+ */
+#define HASH_MAP_STORAGE_SIZE(capacity, key_size, value_size)                  \
+  ((((size_t)(capacity) + 16U + 7U) & ~(size_t)7U) +                           \
+   (size_t)(capacity) * ((((size_t)(key_size) + 7U) & ~(size_t)7U) +           \
+                         (((size_t)(value_size) + 7U) & ~(size_t)7U)))
+
+typedef uint32_t (*HashFunction)(const void *key, size_t key_size);
+typedef uint8_t (*HashEquals)(const void *a, const void *b, size_t key_size);
+
+typedef struct HashMap {
+  uint8_t *control; /**< One byte per slot, plus a copy of the first group. */
+  uint8_t *slots;
+  size_t capacity; /**< Slots; a power of two, or 0 before the first insert. */
+  size_t size;
+  size_t key_size;
+  size_t value_size;
+  size_t value_offset; /**< Value position within a slot. */
+  size_t slot_size;
+  HashFunction hash;   /**< `NULL` hashes the key bytes. */
+  HashEquals equals;   /**< `NULL` compares the key bytes. */
+  const MemoryResource *resource;
+  uint8_t fixed; /**< Caller storage: never grows or frees. */
+} HashMap;
+
+/**
+ * @brief Hashes `key_size` bytes; the default `HashFunction`.
+ */
+extern uint32_t HashBytes(const void *key, size_t key_size);
+
+/**
+ * @brief Sets up an empty map; nothing is allocated until the first insert.
+ */
+extern void HashMapInit(HashMap *map, size_t key_size, size_t value_size,
+                        HashFunction hash, HashEquals equals,
+                        const MemoryResource *resource);
+
+/**
+ * @brief Sets up an empty map of `capacity` slots in caller storage.
+ *
+ * @return `1` on success, `0` if `capacity` is not a power of two of at
+ * least HASH_MAP_GROUP_WIDTH or `storage` is too small.
+ */
+extern uint8_t HashMapInitFixed(HashMap *map, size_t key_size,
+                                size_t value_size, HashFunction hash,
+                                HashEquals equals, void *storage,
+                                size_t storage_size, size_t capacity);
+
+/**
+ * @brief Frees the table's storage, leaving an empty map.
+ */
+extern void HashMapDestroy(HashMap *map);
+
+/**
+ * @brief Makes room for `count` entries without growing again.
+ *
+ * @return `1` on success, `0` if out of memory or the map is fixed and
+ * too small.
+ */
+extern uint8_t HashMapReserve(HashMap *map, size_t count);
+
+/**
+ * @brief Looks up `key`.
+ *
+ * @return Its value, or `NULL` if absent.
+ */
+extern void *HashMapFind(const HashMap *map, const void *key);
+
+/**
+ * @brief Finds or adds `key`.
+ *
+ * @param inserted Set to `1` if the entry is new, its value then being
+ * uninitialized; may be `NULL`.
+ * @return The value, or `NULL` if the table is full.
+ */
+extern void *HashMapInsert(HashMap *map, const void *key, uint8_t *inserted);
+
+/**
+ * @brief Adds or overwrites the entry for `key`.
+ *
+ * @return `1` on success, `0` if the table is full.
+ */
+extern uint8_t HashMapPut(HashMap *map, const void *key, const void *value);
+
+/**
+ * @brief Removes `key`.
+ *
+ * @return `1` if it was present.
+ */
+extern uint8_t HashMapRemove(HashMap *map, const void *key);
+
+/**
+ * @brief Removes every entry, keeping the storage.
+ */
+extern void HashMapClear(HashMap *map);
+
+/**
+ * @brief Steps through the entries in slot order.
+ *
+ * Start with `*position == 0`; each call fills `key` and `value` (either
+ * may be `NULL`) and advances `position`.
+ *
+ * @return `1` if an entry was returned, `0` at the end.
+ */
+extern uint8_t HashMapNext(const HashMap *map, size_t *position, void **key,
+                           void **value);
+
 #ifdef __cplusplus
 }
-#endif
+
+namespace compos {
+
+/**
+ * @brief Default hash for `UnorderedMap`/`UnorderedSet`: the key's bytes.
+ */
+template <typename K> struct BytesHash {
+  uint32_t operator()(const K &key) const { return HashBytes(&key, sizeof(K)); }
+};
+
+/**
+ * @brief Hash and equality callbacks for typed tables; `nullptr` where the
+ * C side can hash or compare the key bytes itself, without indirect calls.
+ */
+template <typename K, typename Hash> struct HashTraits {
+  static uint32_t hash(const void *key, size_t) {
+    return Hash()(*static_cast<const K *>(key));
+  }
+
+  static uint8_t equals(const void *a, const void *b, size_t) {
+    return *static_cast<const K *>(a) == *static_cast<const K *>(b);
+  }
+
+  static HashFunction hashFunction() {
+    return __is_same(Hash, BytesHash<K>) ? nullptr : &hash;
+  }
+
+  static HashEquals equalsFunction() {
+    // Scalar keys compare equal exactly when their bytes do
+    return (__is_class(K) || __is_union(K)) ? &equals : nullptr;
+  }
+};
+
+/**
+ * @brief Typed map over the C interface. Keys and values are moved as bytes,
+ * so both must be trivially copyable.
+ */
+template <typename K, typename V, typename Hash = BytesHash<K>>
+class UnorderedMap {
+  static_assert(__is_trivially_copyable(K) && __is_trivially_copyable(V),
+                "entries are relocated as bytes");
+
+public:
+  explicit UnorderedMap(const MemoryResource *resource = nullptr) {
+    HashMapInit(&map_, sizeof(K), sizeof(V), Traits::hashFunction(),
+                Traits::equalsFunction(), resource);
+  }
+
+  UnorderedMap(void *storage, size_t storage_size, size_t capacity) {
+    HashMapInitFixed(&map_, sizeof(K), sizeof(V), Traits::hashFunction(),
+                     Traits::equalsFunction(), storage, storage_size,
+                     capacity);
+  }
+
+  UnorderedMap(const UnorderedMap &) = delete;
+  UnorderedMap &operator=(const UnorderedMap &) = delete;
+  ~UnorderedMap() { HashMapDestroy(&map_); }
+
+  size_t size() const { return map_.size; }
+  bool empty() const { return map_.size == 0; }
+  bool reserve(size_t count) { return HashMapReserve(&map_, count); }
+  void clear() { HashMapClear(&map_); }
+
+  V *find(const K &key) { return static_cast<V *>(HashMapFind(&map_, &key)); }
+  const V *find(const K &key) const {
+    return static_cast<const V *>(HashMapFind(&map_, &key));
+  }
+  bool contains(const K &key) const { return find(key) != nullptr; }
+
+  /** Adds or overwrites; `false` if the table is full. */
+  bool insert(const K &key, const V &value) {
+    return HashMapPut(&map_, &key, &value);
+  }
+
+  /** The value for `key`, value-initialized if new; `nullptr` if full. */
+  V *try_emplace(const K &key) {
+    uint8_t inserted = 0;
+    V *const value = static_cast<V *>(HashMapInsert(&map_, &key, &inserted));
+    if (value != nullptr && inserted) {
+      *value = V();
+    }
+    return value;
+  }
+
+  bool erase(const K &key) { return HashMapRemove(&map_, &key); }
+
+  /** Calls `function(key, value)` for every entry. */
+  template <typename F> void for_each(F function) {
+    size_t position = 0;
+    void *key = nullptr;
+    void *value = nullptr;
+    while (HashMapNext(&map_, &position, &key, &value)) {
+      function(*static_cast<const K *>(key), *static_cast<V *>(value));
+    }
+  }
+
+  ::HashMap *c_map() { return &map_; }
+
+private:
+  typedef HashTraits<K, Hash> Traits;
+  ::HashMap map_;
+};
+
+} // namespace compos
+#endif // __cplusplus
 #endif // COMPOS_UNORDERED_MAP_H_
@@ -1,12 +1,126 @@
+/**
+ * @file unordered_set.h
+ * @brief Flat open-addressing hash set.
+ *
+ * A set is a HashMap without values and shares its layout and probing; see
+ * unordered_map.h.
+ */
 #ifndef COMPOS_UNORDERED_SET_H_
 #define COMPOS_UNORDERED_SET_H_
 #include "types.h"
+#include "std/unordered_map.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef HashMap HashSet;
+
+/**
+ * @brief Storage that `HashSetInitFixed` needs for `capacity` slots.
+ */
+#define HASH_SET_STORAGE_SIZE(capacity, key_size)                              \
+  HASH_MAP_STORAGE_SIZE((capacity), (key_size), 0U)
+
+/**
+ * @brief Sets up an empty set; nothing is allocated until the first add.
+ */
+extern void HashSetInit(HashSet *set, size_t key_size, HashFunction hash,
+                        HashEquals equals, const MemoryResource *resource);
+
+/**
+ * @brief Sets up an empty set of `capacity` slots in caller storage.
+ *
+ * @return `1` on success, `0` under the same conditions as
+ * `HashMapInitFixed`.
+ */
+extern uint8_t HashSetInitFixed(HashSet *set, size_t key_size,
+                                HashFunction hash, HashEquals equals,
+                                void *storage, size_t storage_size,
+                                size_t capacity);
+
+/**
+ * @brief Frees the set's storage, leaving an empty set.
+ */
+extern void HashSetDestroy(HashSet *set);
+
+/**
+ * @brief Adds `key` if it is not in the set yet.
+ *
+ * @return `1` if `key` is now in the set, `0` if the table is full.
+ */
+extern uint8_t HashSetAdd(HashSet *set, const void *key);
+
+/**
+ * @brief Whether `key` is in the set.
+ */
+extern uint8_t HashSetContains(const HashSet *set, const void *key);
+
+/**
+ * @brief Removes `key`.
+ *
+ * @return `1` if it was present.
+ */
+extern uint8_t HashSetRemove(HashSet *set, const void *key);
+
+/**
+ * @brief Steps through the keys, as `HashMapNext`.
+ */
+extern uint8_t HashSetNext(const HashSet *set, size_t *position, void **key);
+
 #ifdef __cplusplus
 }
-#endif
+
+namespace compos {
+
+/**
+ * @brief Typed set over the C interface; keys must be trivially copyable.
+ */
+template <typename K, typename Hash = BytesHash<K>> class UnorderedSet {
+  static_assert(__is_trivially_copyable(K), "keys are relocated as bytes");
+
+public:
+  explicit UnorderedSet(const MemoryResource *resource = nullptr) {
+    HashSetInit(&set_, sizeof(K), Traits::hashFunction(),
+                Traits::equalsFunction(), resource);
+  }
+
+  UnorderedSet(void *storage, size_t storage_size, size_t capacity) {
+    HashSetInitFixed(&set_, sizeof(K), Traits::hashFunction(),
+                     Traits::equalsFunction(), storage, storage_size,
+                     capacity);
+  }
+
+  UnorderedSet(const UnorderedSet &) = delete;
+  UnorderedSet &operator=(const UnorderedSet &) = delete;
+  ~UnorderedSet() { HashSetDestroy(&set_); }
+
+  size_t size() const { return set_.size; }
+  bool empty() const { return set_.size == 0; }
+  bool reserve(size_t count) { return HashMapReserve(&set_, count); }
+  void clear() { HashMapClear(&set_); }
+
+  bool contains(const K &key) const { return HashSetContains(&set_, &key); }
+  /** `false` only if the table is full. */
+  bool insert(const K &key) { return HashSetAdd(&set_, &key); }
+  bool erase(const K &key) { return HashSetRemove(&set_, &key); }
+
+  /** Calls `function(key)` for every key. */
+  template <typename F> void for_each(F function) const {
+    size_t position = 0;
+    void *key = nullptr;
+    while (HashSetNext(&set_, &position, &key)) {
+      function(*static_cast<const K *>(key));
+    }
+  }
+
+  ::HashSet *c_set() { return &set_; }
+
+private:
+  typedef HashTraits<K, Hash> Traits;
+  ::HashSet set_;
+};
+
+} // namespace compos
+#endif // __cplusplus
 #endif // COMPOS_UNORDERED_SET_H_
@@ -1,12 +1,311 @@
+/**
+ * @file vector.h
+ * @brief Growable array with inline storage and pluggable allocators.
+ *
+ * The C interface works on elements as opaque bytes of `element_size` each.
+ * Storage comes from a MemoryResource (`NULL` for the default heap), grows
+ * by a configurable factor, and is moved with the resource's reallocate, so
+ * the heap can often extend the block in place instead of copying.
+ *
+ * A vector can start in a caller-provided inline buffer: it only touches
+ * the allocator once it outgrows that buffer, and `VectorShrinkToFit` moves
+ * it back when it fits again.
+ *
+ * C++ code uses `compos::Vector<T, N>`, which keeps `N` elements inline,
+ * runs constructors and destructors, and only falls back to element-wise
+ * moves for types that are not trivially copyable.
+ */
 #ifndef COMPOS_VECTOR_H_
 #define COMPOS_VECTOR_H_
 #include "types.h"
+#include "virtualization/memory/resource.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Growth factor in percent of the current capacity.
+ */
+#define VECTOR_GROWTH_DEFAULT 150U
+#define VECTOR_GROWTH_MIN 110U
+
+/**
+ * @brief Capacity of the first heap block of a vector without inline storage.
+ */
+#define VECTOR_CAPACITY_MIN 4U
+
+/**
+ * @brief Moves `count` elements to uninitialized storage, leaving the
+ * source ready to be released.
+ */
+typedef void (*VectorRelocate)(void *destination, void *source, size_t count);
+
+typedef struct Vector {
+  uint8_t *data;
+  size_t size;     /**< Elements in use. */
+  size_t capacity; /**< Elements `data` can hold. */
+  size_t element_size;
+  const MemoryResource *resource; /**< `NULL` for the default heap. */
+  uint8_t *inline_data;           /**< Caller's inline buffer, or `NULL`. */
+  size_t inline_capacity;
+  VectorRelocate relocate; /**< `NULL` moves elements as plain bytes. */
+  uint16_t growth;         /**< Percent, see VECTOR_GROWTH_DEFAULT. */
+} Vector;
+
+/**
+ * @brief Typed access to the elements.
+ */
+#define VECTOR_DATA(vector, type) ((type *)(void *)(vector)->data)
+
+/**
+ * @brief Sets up an empty vector; nothing is allocated until the first push.
+ */
+extern void VectorInit(Vector *vector, size_t element_size,
+                       const MemoryResource *resource);
+
+/**
+ * @brief Sets up an empty vector that keeps up to `capacity` elements in
+ * `buffer`, which must stay valid and be aligned for the element type.
+ */
+extern void VectorInitInline(Vector *vector, size_t element_size,
+                             void *buffer, size_t capacity,
+                             const MemoryResource *resource);
+
+/**
+ * @brief Releases the vector's heap storage. The vector is left empty and
+ * can be reused.
+ */
+extern void VectorDestroy(Vector *vector);
+
+/**
+ * @brief Sets how much the capacity grows when it runs out, in percent,
+ * clamped to at least VECTOR_GROWTH_MIN.
+ */
+extern void VectorSetGrowth(Vector *vector, uint16_t percent);
+
+/**
+ * @brief Makes room for at least `capacity` elements.
+ *
+ * @return `1` on success, `0` if out of memory; the vector is unchanged.
+ */
+extern uint8_t VectorReserve(Vector *vector, size_t capacity);
+
+/**
+ * @brief Shrinks the storage to the size, moving back into the inline
+ * buffer if the elements fit there.
+ *
+ * @return `1` on success, `0` if the allocator could not shrink the block.
+ */
+extern uint8_t VectorShrinkToFit(Vector *vector);
+
+/**
+ * @brief Changes the number of elements; new ones are zeroed.
+ *
+ * @return `1` on success, `0` if out of memory.
+ */
+extern uint8_t VectorResize(Vector *vector, size_t size);
+
+/**
+ * @brief Appends a copy of `element`, or an uninitialized slot if `element`
+ * is `NULL`.
+ *
+ * @return The new element, or `NULL` if out of memory.
+ */
+extern void *VectorPush(Vector *vector, const void *element);
+
+/**
+ * @brief Appends `count` elements with a single capacity check.
+ *
+ * @return `1` on success, `0` if out of memory.
+ */
+extern uint8_t VectorAppend(Vector *vector, const void *elements,
+                            size_t count);
+
+/**
+ * @brief Removes the last element, copying it to `element` unless `NULL`.
+ *
+ * @return `1` if an element was removed, `0` if the vector is empty.
+ */
+extern uint8_t VectorPop(Vector *vector, void *element);
+
+/**
+ * @brief Removes the element at `index`, shifting the rest down as bytes.
+ *
+ * @return `1` if removed, `0` if `index` is out of range.
+ */
+extern uint8_t VectorErase(Vector *vector, size_t index);
+
+/**
+ * @brief The element at `index`, or `NULL` if out of range.
+ */
+extern void *VectorAt(const Vector *vector, size_t index);
+
+/**
+ * @brief Drops all elements, keeping the storage.
+ */
+extern void VectorClear(Vector *vector);
+
 #ifdef __cplusplus
 }
+
+#if defined(__has_include)
+#if __has_include(<new>)
+#include <new>
+#define COMPOS_HAS_PLACEMENT_NEW_ 1
+#endif
+#endif
+#ifndef COMPOS_HAS_PLACEMENT_NEW_
+inline void *operator new(size_t, void *place) noexcept { return place; }
 #endif
+
+namespace compos {
+
+/**
+ * @brief Typed vector over the C interface, with `InlineCapacity` elements
+ * stored in the object itself.
+ *
+ * Operations that can run out of memory report it through their return
+ * value instead of throwing.
+ */
+template <typename T, size_t InlineCapacity = 0> class Vector {
+public:
+  explicit Vector(const MemoryResource *resource = nullptr) {
+    if (InlineCapacity > 0) {
+      VectorInitInline(&vector_, sizeof(T), inline_, InlineCapacity,
+                       resource);
+    } else {
+      VectorInit(&vector_, sizeof(T), resource);
+    }
+    if (!__is_trivially_copyable(T)) {
+      vector_.relocate = &relocate;
+    }
+  }
+
+  Vector(const Vector &) = delete;
+  Vector &operator=(const Vector &) = delete;
+
+  Vector(Vector &&other) noexcept : Vector(other.vector_.resource) {
+    take(other);
+  }
+
+  Vector &operator=(Vector &&other) noexcept {
+    if (this != &other) {
+      clear();
+      VectorDestroy(&vector_);
+      vector_.resource = other.vector_.resource;
+      take(other);
+    }
+    return *this;
+  }
+
+  ~Vector() {
+    clear();
+    VectorDestroy(&vector_);
+  }
+
+  T *data() { return VECTOR_DATA(&vector_, T); }
+  const T *data() const { return VECTOR_DATA(&vector_, const T); }
+  size_t size() const { return vector_.size; }
+  size_t capacity() const { return vector_.capacity; }
+  bool empty() const { return vector_.size == 0; }
+
+  T &operator[](size_t index) { return data()[index]; }
+  const T &operator[](size_t index) const { return data()[index]; }
+  T &back() { return data()[vector_.size - 1U]; }
+
+  T *begin() { return data(); }
+  T *end() { return data() + vector_.size; }
+  const T *begin() const { return data(); }
+  const T *end() const { return data() + vector_.size; }
+
+  void set_growth(uint16_t percent) { VectorSetGrowth(&vector_, percent); }
+  bool reserve(size_t capacity) { return VectorReserve(&vector_, capacity); }
+  bool shrink_to_fit() { return VectorShrinkToFit(&vector_); }
+
+  bool push_back(const T &value) {
+    // The element may live in the storage the push is about to move
+    if (&value >= begin() && &value < end()) {
+      T copy(value);
+      return emplace_back(static_cast<T &&>(copy));
+    }
+    return emplace_back(value);
+  }
+  bool push_back(T &&value) { return emplace_back(static_cast<T &&>(value)); }
+
+  template <typename... Args> bool emplace_back(Args &&...args) {
+    void *const slot = VectorPush(&vector_, nullptr);
+    if (slot == nullptr) {
+      return false;
+    }
+    ::new (slot) T(static_cast<Args &&>(args)...);
+    return true;
+  }
+
+  void pop_back() {
+    back().~T();
+    VectorPop(&vector_, nullptr);
+  }
+
+  /**
+   * Removes the element at `index`, keeping the order of the rest; `false`
+   * if `index` is out of range.
+   */
+  bool erase(size_t index) {
+    if (index >= vector_.size) {
+      return false;
+    }
+    T *const elements = data();
+    for (size_t i = index; i + 1U < vector_.size; i++) {
+      elements[i] = static_cast<T &&>(elements[i + 1U]);
+    }
+    pop_back();
+    return true;
+  }
+
+  void clear() {
+    for (T &element : *this) {
+      element.~T();
+    }
+    VectorClear(&vector_);
+  }
+
+  /** The underlying C vector, e.g. to pass to C code. */
+  ::Vector *c_vector() { return &vector_; }
+
+private:
+  static void relocate(void *destination, void *source, size_t count) {
+    T *const to = static_cast<T *>(destination);
+    T *const from = static_cast<T *>(source);
+    for (size_t i = 0; i < count; i++) {
+      ::new (static_cast<void *>(to + i)) T(static_cast<T &&>(from[i]));
+      from[i].~T();
+    }
+  }
+
+  // Steals `other`'s heap block, or moves its elements if they are inline
+  void take(Vector &other) {
+    if (other.vector_.data != other.vector_.inline_data) {
+      vector_.data = other.vector_.data;
+      vector_.size = other.vector_.size;
+      vector_.capacity = other.vector_.capacity;
+      vector_.growth = other.vector_.growth;
+      other.vector_.data = other.vector_.inline_data;
+      other.vector_.size = 0;
+      other.vector_.capacity = other.vector_.inline_capacity;
+      return;
+    }
+    relocate(vector_.data, other.vector_.data, other.vector_.size);
+    vector_.size = other.vector_.size;
+    vector_.growth = other.vector_.growth;
+    other.vector_.size = 0;
+  }
+
+  ::Vector vector_;
+  alignas(T) uint8_t inline_[InlineCapacity > 0 ? InlineCapacity * sizeof(T)
+                                                : 1U];
+};
+
+} // namespace compos
+#endif // __cplusplus
 #endif // COMPOS_VECTOR_H_
@@ -2,18 +2,340 @@
 #define COMPOS_CONCURRENCY_H_
 
 #include "types.h"
+#include "virtualization/cpu/tasks.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Mutexes and semaphores for tasks.
+ *
+ * Taking a free mutex or an available semaphore unit is one compare-and-swap
+ * with no scheduler involvement. Only under contention does the task park
+ * on the object's wait list, and the release hands ownership (or the unit)
+ * straight to the longest waiter, which resumes already holding it. Tasks
+ * wait with TASK_LOCK/TASK_TAKE, which return to the scheduler instead of
+ * spinning.
+ *
+ * Wait lists are only touched from task context. From an interrupt, use
+ * MutexTryLock with MutexUnlockFromIsr, SemaphoreTryTake,
+ * EventFlagsSetFromIsr, or signal a task through a MessageQueue.
+ */
+
+/** @brief Mutex option: boost the owner to its most urgent waiter's priority. */
+#define MUTEX_PRIORITY_INHERITANCE 1U
 
 typedef struct Mutex {
-    int locked;
+    uint32_t state; /**< Free, locked, or locked with waiters. */
+    uint8_t options;
+    Task* owner;
+    TaskWaitList waiters;
+    struct Mutex* pending_next; /**< Queued for MutexDispatchPending. */
 } Mutex;
 
 typedef struct Semaphore {
-    int count;
+    int32_t count;
+    TaskWaitList waiters;
 } Semaphore;
 
+/**
+ * @brief Sets up an unlocked mutex.
+ *
+ * @param options `0` or MUTEX_PRIORITY_INHERITANCE. Inheritance takes effect
+ * with PRIORITY_BASED_SCHEDULING and is ignored otherwise.
+ */
+extern void MutexInit(Mutex* mutex, uint8_t options);
+
+/**
+ * @brief Locks the mutex if it is free, without waiting.
+ *
+ * Safe from interrupts, which release it with MutexUnlockFromIsr. The
+ * mutex is held without an owner, so waiters do not lend their priority to
+ * the caller; tasks that want inheritance lock with TASK_LOCK.
+ *
+ * @return `1` if locked, `0` if it is held.
+ */
+extern uint8_t MutexTryLock(Mutex* mutex);
+
+/**
+ * @brief Locks the mutex for `task`, or parks `task` until it is handed over.
+ * Used by TASK_LOCK.
+ *
+ * @return `1` if locked now, `0` if `task` was parked and must return
+ * TASK_BLOCKED.
+ */
+extern uint8_t MutexLock(Mutex* mutex, Task* task);
+
+/**
+ * @brief Unlocks the mutex, passing it to the longest waiter if there is one.
+ * Task context only.
+ */
+extern void MutexUnlock(Mutex* mutex);
+
+/**
+ * @brief Unlocks a mutex an interrupt took with MutexTryLock.
+ *
+ * Frees it at once if nobody waits. Otherwise the mutex stays locked and is
+ * queued, and the next TaskRunOnce hands it to the longest waiter.
+ */
+extern void MutexUnlockFromIsr(Mutex* mutex);
+
+/**
+ * @brief Hands over mutexes unlocked from interrupts. Called by
+ * TaskRunOnce; costs one load when nothing is pending.
+ */
+extern void MutexDispatchPending(void);
+
+/**
+ * @brief Sets up a semaphore holding `count` units.
+ */
+extern void SemaphoreInit(Semaphore* semaphore, int32_t count);
+
+/**
+ * @brief Takes a unit if one is available, without waiting.
+ *
+ * @return `1` if taken, `0` otherwise.
+ */
+extern uint8_t SemaphoreTryTake(Semaphore* semaphore);
+
+/**
+ * @brief Takes a unit for `task`, or parks `task` until one is given.
+ * Used by TASK_TAKE.
+ *
+ * @return `1` if taken now, `0` if `task` was parked and must return
+ * TASK_BLOCKED.
+ */
+extern uint8_t SemaphoreTake(Semaphore* semaphore, Task* task);
+
+/**
+ * @brief Returns a unit, handing it to the longest waiter if there is one.
+ */
+extern void SemaphoreGive(Semaphore* semaphore);
+
+/**
+ * @brief Continues once the task holds `mutex`.
+ */
+#define TASK_LOCK(task, mutex) TASK_LOCK_AT_((task), (mutex), __COUNTER__ + 1U)
+#define TASK_LOCK_AT_(task, mutex, point)                                       \
+    do {                                                                        \
+        (task)->resume_point = (point);                                         \
+        if (!MutexLock((mutex), (task))) {                                      \
+            return TASK_BLOCKED;                                                \
+        }                                                                       \
+        __attribute__((fallthrough));                                           \
+    case (point):;                                                              \
+    } while (0)
+
+/**
+ * @brief Continues once the task has taken a unit of `semaphore`.
+ */
+#define TASK_TAKE(task, semaphore) TASK_TAKE_AT_((task), (semaphore), __COUNTER__ + 1U)
+#define TASK_TAKE_AT_(task, semaphore, point)                                   \
+    do {                                                                        \
+        (task)->resume_point = (point);                                         \
+        if (!SemaphoreTake((semaphore), (task))) {                              \
+            return TASK_BLOCKED;                                                \
+        }                                                                       \
+        __attribute__((fallthrough));                                           \
+    case (point):;                                                              \
+    } while (0)
+
+/*
+ * Event flags: a 32-bit word of independent flags that tasks wait on, any
+ * or all of a mask at a time.
+ *
+ * Setting flags checks each parked waiter's mask against the new word and
+ * makes ready exactly the ones it satisfies, which resume with the matched
+ * flags in `task->events`. The mask and mode live in the waiter's control
+ * block, so waiting allocates nothing. One group per task gives each task
+ * its own notification word.
+ *
+ * EventFlagsSetFromIsr only ORs the flags in and marks the group pending;
+ * the waiters are checked by the next TaskRunOnce, before it picks a task.
+ */
+#define EVENT_WAIT_ANY 0U      /**< Continue once any flag in the mask is set. */
+#define EVENT_WAIT_ALL 1U      /**< Continue once every flag in the mask is set. */
+#define EVENT_CLEAR_ON_EXIT 2U /**< Or'ed into the mode: consume the matched flags. */
+
+typedef struct EventFlags {
+    uint32_t flags;
+    uint32_t pending; /**< Queued for EventFlagsDispatchPending. */
+    struct EventFlags* pending_next;
+    TaskWaitList waiters;
+} EventFlags;
+
+/**
+ * @brief Sets up a group with no flags set.
+ */
+extern void EventFlagsInit(EventFlags* events);
+
+/**
+ * @brief Sets flags from task context and wakes every waiter they satisfy.
+ *
+ * @return The flags left set, after waiters consumed theirs.
+ */
+extern uint32_t EventFlagsSet(EventFlags* events, uint32_t flags);
+
+/**
+ * @brief Sets flags from an interrupt. Waiters are woken on the next
+ * TaskRunOnce.
+ */
+extern void EventFlagsSetFromIsr(EventFlags* events, uint32_t flags);
+
+/**
+ * @brief Clears flags.
+ *
+ * @return The flags set before clearing.
+ */
+extern uint32_t EventFlagsClear(EventFlags* events, uint32_t flags);
+
+/**
+ * @brief The flags currently set.
+ */
+extern uint32_t EventFlagsGet(const EventFlags* events);
+
+/**
+ * @brief Checks `mask` for `task`, or parks `task` until it is satisfied.
+ * Used by TASK_WAIT_EVENTS.
+ *
+ * @param mode EVENT_WAIT_ANY or EVENT_WAIT_ALL, optionally with
+ * EVENT_CLEAR_ON_EXIT.
+ * @return `1` if satisfied now, with the matched flags in `task->events`;
+ * `0` if `task` was parked and must return TASK_BLOCKED.
+ */
+extern uint8_t EventFlagsWait(EventFlags* events, Task* task, uint32_t mask, uint8_t mode);
+
+/**
+ * @brief Wakes the waiters of groups set from interrupts. Called by
+ * TaskRunOnce; costs one load when nothing is pending.
+ */
+extern void EventFlagsDispatchPending(void);
+
+/**
+ * @brief Continues once `events` satisfies `mask` under `mode`; the matched
+ * flags are then in `task->events`.
+ */
+#define TASK_WAIT_EVENTS(task, events, mask, mode)                              \
+    TASK_WAIT_EVENTS_AT_((task), (events), (mask), (mode), __COUNTER__ + 1U)
+#define TASK_WAIT_EVENTS_AT_(task, events, mask, mode, point)                   \
+    do {                                                                        \
+        (task)->resume_point = (point);                                         \
+        if (!EventFlagsWait((events), (task), (mask), (mode))) {                \
+            return TASK_BLOCKED;                                                \
+        }                                                                       \
+        __attribute__((fallthrough));                                           \
+    case (point):;                                                              \
+    } while (0)
+
+/*
+ * Message queues: bounded rings of fixed-size messages, copied inline, with
+ * no locks on any path.
+ *
+ * - MESSAGE_QUEUE_SPSC: one producer and one consumer (e.g. one ISR feeding
+ *   one task). Each side only writes its own index.
+ * - MESSAGE_QUEUE_MPSC: any number of producers, one consumer. Producers
+ *   claim slots with a compare-and-swap and publish them through a
+ *   per-slot sequence number, so a slow producer never exposes a half
+ *   written message.
+ *
+ * Ordering uses the compiler's C11-model atomics, which become LDREX/STREX
+ * on ARMv7-M and later. ARMv6-M has no exclusive access, so there the MPSC
+ * slot claim briefly masks interrupts instead.
+ *
+ * Large payloads can be written and read in place: `MessageQueueReserve`
+ * hands out a slot to fill and `MessageQueueCommit` publishes it, and
+ * `MessageQueuePeek`/`MessageQueueRelease` do the same on the consumer
+ * side. A task waits for messages with
+ * `TASK_AWAIT(task, MessageQueueCount(queue) > 0)`.
+ */
+#define MESSAGE_QUEUE_SPSC 0U
+#define MESSAGE_QUEUE_MPSC 1U
+
+/** @brief Bytes in front of each MPSC message, also its payload alignment. */
+#define MESSAGE_QUEUE_HEADER_SIZE 8U
+
+/** @brief Distance between slots for messages of `message_size` bytes. */
+#define MESSAGE_QUEUE_SLOT_SIZE(mode, message_size)                             \
+    ((((mode) == MESSAGE_QUEUE_MPSC) ? MESSAGE_QUEUE_HEADER_SIZE : 0U) +        \
+     (((size_t)(message_size) + 7U) & ~(size_t)7U))
+
+/** @brief Storage that `MessageQueueInit` needs, to be 8-byte aligned. */
+#define MESSAGE_QUEUE_STORAGE_SIZE(mode, capacity, message_size)                \
+    ((size_t)(capacity) * MESSAGE_QUEUE_SLOT_SIZE((mode), (message_size)))
+
 typedef struct MessageQueue {
-    void* data;
-    size_t size;
+    uint8_t* slots;
+    size_t slot_size;
+    size_t message_size;
+    uint32_t mask; /**< Capacity - 1; the capacity is a power of two. */
+    uint8_t mode;  /**< MESSAGE_QUEUE_SPSC or MESSAGE_QUEUE_MPSC. */
+    uint32_t head; /**< Next message to read, written by the consumer. */
+    uint32_t tail; /**< Next slot to fill, written by the producer(s). */
 } MessageQueue;
 
+/**
+ * @brief Sets up a queue over caller-provided storage.
+ *
+ * @param queue Queue to initialize.
+ * @param storage At least MESSAGE_QUEUE_STORAGE_SIZE bytes, 8-byte aligned.
+ * @param storage_size Size of `storage` in bytes.
+ * @param capacity Number of messages; must be a power of two.
+ * @param message_size Bytes per message.
+ * @param mode MESSAGE_QUEUE_SPSC or MESSAGE_QUEUE_MPSC.
+ * @return `1` on success, `0` if an argument is invalid.
+ */
+extern uint8_t MessageQueueInit(MessageQueue* queue, void* storage, size_t storage_size, uint32_t capacity,
+                                size_t message_size, uint8_t mode);
+
+/**
+ * @brief Copies a message into the queue.
+ *
+ * @return `1` if queued, `0` if the queue is full.
+ */
+extern uint8_t MessageQueueSend(MessageQueue* queue, const void* message);
+
+/**
+ * @brief Copies the oldest message out of the queue.
+ *
+ * @return `1` if a message was received, `0` if the queue is empty.
+ */
+extern uint8_t MessageQueueReceive(MessageQueue* queue, void* message);
+
+/**
+ * @brief Claims a slot to write a message into in place.
+ *
+ * An SPSC producer may hold one reservation at a time. The consumer only
+ * sees the message once it is committed.
+ *
+ * @return The slot's `message_size` bytes, or `NULL` if the queue is full.
+ */
+extern void* MessageQueueReserve(MessageQueue* queue);
+
+/**
+ * @brief Publishes a slot obtained from `MessageQueueReserve`.
+ */
+extern void MessageQueueCommit(MessageQueue* queue, void* message);
+
+/**
+ * @brief The oldest message, left in the queue to be read in place.
+ *
+ * @return The message, or `NULL` if the queue is empty.
+ */
+extern void* MessageQueuePeek(MessageQueue* queue);
+
+/**
+ * @brief Drops the message returned by `MessageQueuePeek`, freeing its slot.
+ */
+extern void MessageQueueRelease(MessageQueue* queue);
+
+/**
+ * @brief Number of messages queued, including MPSC slots still being
+ * written. Only a snapshot while producers are active.
+ */
+extern size_t MessageQueueCount(const MessageQueue* queue);
+
+#ifdef __cplusplus
+}
+#endif
 #endif // COMPOS_CONCURRENCY_H_
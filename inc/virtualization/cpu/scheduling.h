@@ -1,6 +1,154 @@
+/**
+ * @file scheduling.h
+ * @brief Ready queue used by the task runtime to pick the next task.
+ *
+ * One policy is compiled in. Without a policy macro, ready tasks run
+ * round-robin in FIFO order.
+ *
+ * PRIORITY_BASED_SCHEDULING selects fixed priorities: the most urgent ready
+ * task always runs next, and tasks of equal priority take turns. Picking
+ * the next task costs one count-leading-zeros on a bitmap of non-empty
+ * levels, however many tasks are ready. Tasks are cooperative, so a task
+ * that becomes ready runs at the next dispatch rather than interrupting the
+ * one in progress.
+ *
+ * EARLIEST_DEADLINE_FIRST_SCHEDULING runs the ready task with the nearest
+ * absolute deadline, kept in a binary min-heap: O(log n) to queue a task,
+ * O(1) to see which one is next. Deadlines are in ticks of SchedulerClock
+ * and may wrap; two deadlines compare correctly while they are less than
+ * 2^31 ticks apart. Tasks without a deadline wait in a FIFO of their own and
+ * only run when no task with a deadline is ready.
+ */
+
 #ifndef COMPOS_SCHEDULING_H_
 #define COMPOS_SCHEDULING_H_
 
 #include "types.h"
+#include "virtualization/cpu/tasks.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(PRIORITY_BASED_SCHEDULING) &&                                      \
+    defined(EARLIEST_DEADLINE_FIRST_SCHEDULING)
+#error "Define at most one scheduling policy"
+#endif
+
+#ifdef PRIORITY_BASED_SCHEDULING
+/**
+ * @brief Number of priority levels, at most 32 (one bitmap word).
+ */
+#ifndef SCHEDULER_PRIORITIES
+#define SCHEDULER_PRIORITIES 32U
+#endif
+#if SCHEDULER_PRIORITIES < 1 || SCHEDULER_PRIORITIES > 32
+#error "SCHEDULER_PRIORITIES must be between 1 and 32"
+#endif
+
+#define SCHEDULER_HIGHEST_PRIORITY 0U
+#define SCHEDULER_LOWEST_PRIORITY (SCHEDULER_PRIORITIES - 1U)
+#endif
+
+#ifdef EARLIEST_DEADLINE_FIRST_SCHEDULING
+/**
+ * @brief Farthest deadline that still compares as later than now.
+ */
+#define SCHEDULER_DEADLINE_HORIZON 0x7FFFFFFFU
+#endif
+
+/**
+ * @brief Empties the ready queue.
+ */
+extern void SchedulerInit(void);
+
+/**
+ * @brief Queues a task that is ready to run.
+ */
+extern void SchedulerReady(Task *task);
+
+/**
+ * @brief Queues a task that returned TASK_WAITING behind every other ready
+ * task.
+ *
+ * A task polling a condition must not keep the CPU from whoever makes the
+ * condition true. Round-robin simply queues it last. Under
+ * PRIORITY_BASED_SCHEDULING it takes turns at the lowest level, and under
+ * EARLIEST_DEADLINE_FIRST_SCHEDULING with the tasks without a deadline. Its
+ * own priority or deadline applies again once it is next made ready.
+ */
+extern void SchedulerPoll(Task *task);
+
+/**
+ * @brief Removes and returns the task to dispatch next.
+ *
+ * @return The task, or `NULL` if nothing is ready.
+ */
+extern Task *SchedulerNext(void);
+
+#ifdef PRIORITY_BASED_SCHEDULING
+/**
+ * @brief Changes the priority a task returns to once inheritance ends.
+ *
+ * A ready task moves to its new level straight away.
+ */
+extern void SchedulerSetPriority(Task *task, uint8_t priority);
+
+/**
+ * @brief Priority inheritance: raises `owner` to `priority` if that is more
+ * urgent than its current priority.
+ *
+ * Called by a lock when a task of `priority` starts waiting for a resource
+ * that `owner` holds, so the owner cannot be starved by tasks in between.
+ */
+extern void SchedulerInherit(Task *owner, uint8_t priority);
+
+/**
+ * @brief Ends inheritance: drops `owner` back to its base priority.
+ *
+ * Called by a lock on release. An owner still holding other contended
+ * locks should be passed to SchedulerInherit again for their waiters.
+ */
+extern void SchedulerRestore(Task *owner);
+#endif
+
+#ifdef EARLIEST_DEADLINE_FIRST_SCHEDULING
+/**
+ * @brief Current time in scheduler ticks.
+ *
+ * Weak: the default counts SchedulerTick calls. Override it to read a
+ * hardware timer instead.
+ */
+extern uint32_t SchedulerClock(void);
+
+/**
+ * @brief Advances the default clock by one tick, e.g. from a timer ISR.
+ */
+extern void SchedulerTick(void);
+
+/**
+ * @brief The task SchedulerNext would return, without removing it.
+ */
+extern Task *SchedulerPeek(void);
+
+/**
+ * @brief Moves the absolute deadline of `task`, reordering it if queued.
+ *
+ * A task spawned without a deadline gets one from then on.
+ */
+extern void SchedulerSetDeadline(Task *task, uint32_t deadline);
+
+/**
+ * @brief Ends the current job of `task` and starts the next one.
+ *
+ * Counts a miss in `task->deadline_misses` if the clock is already past
+ * the job's deadline, then moves the deadline to `next_deadline`. A
+ * periodic task calls this at the end of every job.
+ */
+extern void SchedulerJobDone(Task *task, uint32_t next_deadline);
+#endif
 
+#ifdef __cplusplus
+}
+#endif
 #endif // COMPOS_SCHEDULING_H_
@@ -1,4 +1,263 @@
+/**
+ * @file tasks.h
+ * @brief Stackless cooperative tasks.
+ *
+ * A task is a resumable state machine rather than a thread: its function is
+ * called every time the task is dispatched and picks up where it last
+ * stopped, using the protothread-style macros below. Nothing lives on a
+ * per-task stack, so a task costs one `Task` control block plus whatever
+ * state the application keeps in its context.
+ *
+ * @code
+ * typedef struct Blinker { uint32_t count; } Blinker;
+ *
+ * static TaskStatus blink(Task *task) {
+ *   Blinker *state = (Blinker *)task->context;
+ *   TASK_BEGIN(task);
+ *   for (state->count = 0; state->count < 10; state->count++) {
+ *     LedToggle();
+ *     TASK_YIELD(task);
+ *   }
+ *   TASK_END(task);
+ * }
+ *
+ * static Blinker blinker;
+ * TaskSpawn(blink, &blinker);
+ * TaskRun();
+ * @endcode
+ *
+ * Local variables do not survive a yield; keep them in the context. The
+ * macros expand to `case` labels numbered with `__COUNTER__`, so a task body
+ * must not use `switch` across a yield point.
+ *
+ * Which ready task runs next is up to the scheduler (see scheduling.h).
+ */
+
 #ifndef COMPOS_TASKS_H_
 #define COMPOS_TASKS_H_
 
-#endif
\ No newline at end of file
+#include "types.h"
+#include "std/list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Number of tasks that can exist at the same time.
+ */
+#ifndef TASK_MAX
+#define TASK_MAX 16U
+#endif
+
+/**
+ * @brief What a task function returns to the runtime.
+ */
+typedef uint8_t TaskStatus;
+#define TASK_YIELDED 0U /**< Ready again; give others a turn first. */
+#define TASK_WAITING 1U /**< Polling a condition; runs after the others. */
+#define TASK_BLOCKED 2U /**< Parked on a wait list until woken. */
+#define TASK_EXITED 3U  /**< Finished; the control block is released. */
+
+/**
+ * @brief Lifecycle of a control block.
+ */
+#define TASK_STATE_FREE 0U
+#define TASK_STATE_READY 1U
+#define TASK_STATE_RUNNING 2U
+#define TASK_STATE_BLOCKED 3U
+#define TASK_STATE_WAITING 4U /**< Queued by SchedulerPoll. */
+
+typedef struct Task Task;
+
+typedef TaskStatus (*TaskFunction)(Task *task);
+
+/**
+ * @brief FIFO of tasks blocked on the same event, linked through
+ * `Task.link`; zeroed means empty.
+ */
+typedef List TaskWaitList;
+
+/**
+ * @brief Task control block, allocated from a static table by `TaskSpawn`.
+ */
+struct Task {
+  TaskFunction function;
+  void *context;         /**< Application state, survives yields. */
+  ListNode link;         /**< Place in the ready queue or a wait list. */
+  uint32_t resume_point; /**< Where the function continues; 0 is the start. */
+  uint8_t state;         /**< One of the TASK_STATE_* values. */
+  uint8_t event_mode;    /**< EVENT_WAIT_* mode while waiting on flags. */
+  uint32_t events;       /**< Flags waited for, then the ones matched. */
+#ifdef PRIORITY_BASED_SCHEDULING
+  uint8_t priority;      /**< Effective priority; 0 is the most urgent. */
+  uint8_t base_priority; /**< Priority without inheritance. */
+#endif
+#ifdef EARLIEST_DEADLINE_FIRST_SCHEDULING
+  uint32_t deadline;        /**< Absolute deadline in scheduler ticks. */
+  uint32_t sequence;        /**< Queue order among equal deadlines. */
+  uint32_t deadline_misses; /**< Jobs finished after their deadline. */
+  uint16_t heap_index;      /**< Slot in the ready heap while queued. */
+  uint8_t has_deadline;     /**< 0: runs only when no deadline is ready. */
+#endif
+};
+
+/**
+ * @brief The task a ready queue or wait list node belongs to.
+ */
+#define TASK_OF(node) LIST_ENTRY((node), Task, link)
+
+/**
+ * @brief Starts a task body. Must be the first statement of the function.
+ */
+#define TASK_BEGIN(task)                                                       \
+  switch ((task)->resume_point) {                                              \
+  case 0:
+
+/**
+ * @brief Lets every other ready task run before continuing.
+ */
+#define TASK_YIELD(task) TASK_YIELD_AT_((task), __COUNTER__ + 1U)
+#define TASK_YIELD_AT_(task, point)                                            \
+  do {                                                                         \
+    (task)->resume_point = (point);                                            \
+    return TASK_YIELDED;                                                       \
+  case (point):;                                                               \
+  } while (0)
+
+/**
+ * @brief Continues once `condition` holds, checking it on every dispatch.
+ *
+ * While the condition is false the task is queued behind every other ready
+ * task (see SchedulerPoll), so it cannot starve the task that would make
+ * the condition true. Prefer TASK_WAIT for events that have a wait list.
+ */
+#define TASK_AWAIT(task, condition)                                            \
+  TASK_AWAIT_AT_((task), (condition), __COUNTER__ + 1U)
+#define TASK_AWAIT_AT_(task, condition, point)                                 \
+  do {                                                                         \
+    (task)->resume_point = (point);                                            \
+    __attribute__((fallthrough));                                              \
+  case (point):                                                                \
+    if (!(condition)) {                                                        \
+      return TASK_WAITING;                                                     \
+    }                                                                          \
+  } while (0)
+
+/**
+ * @brief Parks the task on `wait_list` until `TaskWakeOne`/`TaskWakeAll`.
+ */
+#define TASK_WAIT(task, wait_list)                                             \
+  TASK_WAIT_AT_((task), (wait_list), __COUNTER__ + 1U)
+#define TASK_WAIT_AT_(task, wait_list, point)                                  \
+  do {                                                                         \
+    TaskBlock((task), (wait_list));                                            \
+    (task)->resume_point = (point);                                            \
+    return TASK_BLOCKED;                                                       \
+  case (point):;                                                               \
+  } while (0)
+
+/**
+ * @brief Ends the task from anywhere in its body.
+ */
+#define TASK_EXIT(task)                                                        \
+  do {                                                                         \
+    (task)->resume_point = 0;                                                  \
+    return TASK_EXITED;                                                        \
+  } while (0)
+
+/**
+ * @brief Closes a task body opened with TASK_BEGIN.
+ */
+#define TASK_END(task)                                                         \
+  }                                                                            \
+  (task)->resume_point = 0;                                                    \
+  return TASK_EXITED
+
+/**
+ * @brief Creates a ready task.
+ *
+ * @param function The task body.
+ * @param context State handed to the task through `task->context`.
+ * @return The task, or `NULL` if all TASK_MAX control blocks are in use.
+ */
+extern Task *TaskSpawn(TaskFunction function, void *context);
+
+#ifdef PRIORITY_BASED_SCHEDULING
+/**
+ * @brief Creates a ready task with a fixed priority.
+ *
+ * `TaskSpawn` uses the lowest priority. Values past the lowest level are
+ * clamped to it.
+ *
+ * @return The task, or `NULL` if all TASK_MAX control blocks are in use.
+ */
+extern Task *TaskSpawnPriority(TaskFunction function, void *context,
+                               uint8_t priority);
+#endif
+
+#ifdef EARLIEST_DEADLINE_FIRST_SCHEDULING
+/**
+ * @brief Creates a ready task whose first job is due at `deadline`.
+ *
+ * Tasks from `TaskSpawn` have no deadline: they take turns in FIFO order
+ * whenever no task with a deadline is ready, however long they have waited.
+ *
+ * @return The task, or `NULL` if all TASK_MAX control blocks are in use.
+ */
+extern Task *TaskSpawnDeadline(TaskFunction function, void *context,
+                               uint32_t deadline);
+#endif
+
+/**
+ * @brief Runs the next ready task up to its next yield point.
+ *
+ * @return `1` if a task ran, `0` if none was ready.
+ */
+extern uint8_t TaskRunOnce(void);
+
+/**
+ * @brief Dispatches tasks until none is ready.
+ *
+ * @return The number of dispatches.
+ */
+extern size_t TaskRun(void);
+
+/**
+ * @brief The task being dispatched, or `NULL` outside of a task.
+ */
+extern Task *TaskCurrent(void);
+
+/**
+ * @brief Number of tasks that have been spawned and not yet exited.
+ */
+extern size_t TaskCount(void);
+
+/**
+ * @brief Moves `task` onto `wait_list`. Used by TASK_WAIT.
+ */
+extern void TaskBlock(Task *task, TaskWaitList *wait_list);
+
+/**
+ * @brief Makes the longest-waiting task on `wait_list` ready.
+ *
+ * @return The task woken, or `NULL` if the list was empty.
+ */
+extern Task *TaskWakeOne(TaskWaitList *wait_list);
+
+/**
+ * @brief Makes every task on `wait_list` ready.
+ *
+ * @return The number of tasks woken.
+ */
+extern size_t TaskWakeAll(TaskWaitList *wait_list);
+
+/**
+ * @brief Drops every task and returns the runtime to its initial state.
+ */
+extern void TaskReset(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* COMPOS_TASKS_H_ */
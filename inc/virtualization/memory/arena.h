@@ -0,0 +1,130 @@
+/**
+ * @file arena.h
+ * @brief Linear (bump) arena allocator.
+ *
+ * An arena hands out memory by advancing an offset through one contiguous
+ * block. Allocations carry no header and cannot be freed one by one; instead
+ * everything allocated after a mark is dropped at once by rewinding to it, or
+ * the whole arena is emptied with a reset. All operations are O(1).
+ *
+ * Arenas suit groups of temporaries that die together, such as per-frame or
+ * per-request scratch data. They can be carved out of a caller-provided
+ * buffer (`ArenaInit`), which works without any heap, or out of the heap set
+ * up by `AllocatorInit` (`ArenaCreate`).
+ */
+
+#ifndef COMPOS_ARENA_H_
+#define COMPOS_ARENA_H_
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Alignment of every block handed out by `ArenaAlloc`.
+ */
+#define ARENA_ALIGNMENT (sizeof(void *) * 2U)
+
+/**
+ * @brief Arena control block, placed at the start of the arena's storage.
+ */
+typedef struct Arena {
+  uint8_t *storage; /**< First usable byte. */
+  size_t capacity;  /**< Usable bytes after the control block. */
+  size_t offset;    /**< Bytes in use; the next allocation starts here. */
+  size_t peak;      /**< Highest `offset` reached since creation. */
+  void *heap_block; /**< Block returned by malloc, or NULL if caller-owned. */
+} Arena;
+
+/**
+ * @brief A position in an arena to rewind to, from `ArenaGetMark`.
+ */
+typedef size_t ArenaMark;
+
+/**
+ * @brief Typed helpers.
+ */
+#define ARENA_INIT(buffer) ArenaInit((buffer), sizeof(buffer))
+#define ARENA_ALLOC(arena, type) ((type *)ArenaAlloc((arena), sizeof(type)))
+#define ARENA_ALLOC_ARRAY(arena, type, count)                                  \
+  ((type *)ArenaAllocArray((arena), (count), sizeof(type)))
+
+/**
+ * @brief Builds an arena inside a caller-provided buffer.
+ *
+ * @param buffer Storage for the arena, including its control block.
+ * @param buffer_size Size of `buffer` in bytes.
+ * @return The arena, or `NULL` if the buffer cannot hold the control block.
+ */
+extern Arena *ArenaInit(void *buffer, size_t buffer_size);
+
+/**
+ * @brief Allocates `size` bytes aligned to ARENA_ALIGNMENT.
+ *
+ * @return A pointer to uninitialized memory, or `NULL` if the arena is full
+ * or `size` is 0.
+ */
+extern void *ArenaAlloc(Arena *arena, size_t size);
+
+/**
+ * @brief Allocates an array of `count` elements of `size` bytes.
+ *
+ * @return A pointer to uninitialized memory, or `NULL` if the arena is full
+ * or the total size overflows.
+ */
+extern void *ArenaAllocArray(Arena *arena, size_t count, size_t size);
+
+/**
+ * @brief Allocates `size` bytes aligned to a power-of-two `alignment`.
+ *
+ * @return A pointer to uninitialized memory, or `NULL` if the alignment is
+ * invalid or the arena is full.
+ */
+extern void *ArenaAlignedAlloc(Arena *arena, size_t alignment, size_t size);
+
+/**
+ * @brief Records the current position of the arena.
+ */
+extern ArenaMark ArenaGetMark(const Arena *arena);
+
+/**
+ * @brief Releases everything allocated since `mark` was taken.
+ *
+ * Marks must be rewound in LIFO order; a mark past the current position is
+ * ignored.
+ */
+extern void ArenaRewind(Arena *arena, ArenaMark mark);
+
+/**
+ * @brief Releases every allocation in the arena.
+ */
+extern void ArenaReset(Arena *arena);
+
+/**
+ * @brief Bytes still available for allocations with ARENA_ALIGNMENT.
+ */
+extern size_t ArenaRemaining(const Arena *arena);
+
+#ifndef NO_ALLOCATOR
+/**
+ * @brief Creates an arena with `capacity` usable bytes on the heap.
+ *
+ * @return The arena, or `NULL` if the heap could not satisfy the request.
+ */
+extern Arena *ArenaCreate(size_t capacity);
+
+/**
+ * @brief Releases an arena created by `ArenaCreate`.
+ *
+ * Arenas built with `ArenaInit` are left untouched; their storage belongs to
+ * the caller.
+ */
+extern void ArenaDestroy(Arena *arena);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* COMPOS_ARENA_H_ */
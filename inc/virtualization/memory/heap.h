@@ -28,20 +28,24 @@ extern "C" {
  * At compile time, ensures that one and only one allocator option is defined.
  * If not, a warning is generated. Supported options are:
  * - USE_LIST_ALLOCATOR
+ * - USE_TLSF_ALLOCATOR
  * - USE_RBTOPDOWN_ALLOCATOR
  * - USE_RBLINKED_ALLOCATOR
  * - USE_ZIG_ALLOCATOR
  * - NO_ALLOCATOR
  * - USE_CLANG_ALLOCATOR
  */
-#if defined(USE_LIST_ALLOCATOR) + defined(USE_ZIG_ALLOCATOR) +         \
-        defined(NO_ALLOCATOR) + defined(USE_CLANG_ALLOCATOR) !=                \
+#if defined(USE_LIST_ALLOCATOR) + defined(USE_TLSF_ALLOCATOR) +               \
+        defined(USE_ZIG_ALLOCATOR) + defined(NO_ALLOCATOR) +                   \
+        defined(USE_CLANG_ALLOCATOR) !=                                        \
     1
 #error                                                                         \
-    "Exactly one allocator option must be defined. Define one of: USE_LIST_ALLOCATOR, USE_RBTOPDOWN_ALLOCATOR, USE_RBLINKED_ALLOCATOR, USE_ZIG_ALLOCATOR, or NO_ALLOCATOR, or USE_CLANG_ALLOCATOR."
+    "Exactly one allocator option must be defined. Define one of: USE_LIST_ALLOCATOR, USE_TLSF_ALLOCATOR, USE_RBTOPDOWN_ALLOCATOR, USE_RBLINKED_ALLOCATOR, USE_ZIG_ALLOCATOR, or NO_ALLOCATOR, or USE_CLANG_ALLOCATOR."
 #endif
 #if defined(USE_LIST_ALLOCATOR)
 // #pragma message("Allocator Option: List Allocator")
+#elif defined(USE_TLSF_ALLOCATOR)
+// #pragma message("Allocator Option: TLSF Allocator")
 #elif defined(USE_ZIG_ALLOCATOR)
 // #pragma message("Allocator Option: Zig Allocator")
 #elif defined(NO_ALLOCATOR)
@@ -52,17 +56,50 @@ extern "C" {
 #pragma message("No Allocator Picked, Please go fix that")
 #endif
 
+/**
+ * @brief Heap usage statistics, see `AllocatorGetStats`.
+ *
+ * Byte counts follow the backend's own accounting, so `free_bytes` includes
+ * the headers of free blocks.
+ */
+typedef struct HeapStats {
+  size_t capacity;          /**< Bytes available for allocations. */
+  size_t allocated;         /**< Bytes in allocated blocks. */
+  size_t free_bytes;        /**< capacity - allocated. */
+  size_t peak_allocated;    /**< Highest `allocated` seen. */
+  size_t peak_request_size; /**< Largest request seen, successful or not. */
+  size_t oom_count;         /**< Requests that could not be satisfied. */
+  size_t free_fragments;    /**< Number of free blocks. */
+  size_t largest_free_block; /**< Payload of the largest free block; a lower
+                                bound unless collected with a full walk. */
+  uint32_t fragmentation_permille; /**< 1000 * (1 - largest_free_block /
+                                      free_bytes). */
+} HeapStats;
+
 /**
  * @brief Includes standard library memory functions when using CLANG allocator.
  */
 #if defined(USE_CLANG_ALLOCATOR)
-uint8_t AllocatorInit(void *heap_start, size_t heap_size) {
+#include <string.h>
+
+static inline uint8_t AllocatorInit(void *heap_start, size_t heap_size) {
+    UNUSED(heap_start);
+    UNUSED(heap_size);
     return 1;
 }
 
-void AllocatorDeinit() {
+static inline void AllocatorDeinit() {
     return;
 }
+
+static inline uint8_t AllocatorGetStats(HeapStats *stats, uint8_t full_walk) {
+    // The C library does not expose its bookkeeping
+    UNUSED(full_walk);
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+    }
+    return 0;
+}
 #include <stdlib.h>
 #else
 
@@ -102,6 +139,33 @@ extern void *malloc(size_t SizeWanted);
  */
 extern void *calloc(size_t NumberOfElements, size_t ElementSize);
 
+/**
+ * @brief Allocates a block of memory aligned to a power-of-two boundary.
+ *
+ * Alignments up to the allocator's natural alignment cost the same as
+ * `malloc`. Larger ones over-allocate and hand the unused head and tail back
+ * to the heap, so the block is released with a plain `free`.
+ *
+ * @param Alignment The required alignment in bytes, a power of two.
+ * @param SizeWanted The size of the memory block to allocate in bytes.
+ * @return A pointer to the aligned memory block, or `NULL` if the alignment
+ * is invalid or allocation fails.
+ */
+extern void *aligned_alloc(size_t Alignment, size_t SizeWanted);
+
+/**
+ * @brief POSIX-style aligned allocation, built on `aligned_alloc`.
+ *
+ * @param MemoryPtr Receives the allocated block.
+ * @param Alignment The required alignment in bytes, a power of two and a
+ * multiple of `sizeof(void *)`.
+ * @param SizeWanted The size of the memory block to allocate in bytes.
+ * @return `0` on success, `EINVAL` for an invalid alignment, or `ENOMEM` if
+ * allocation fails.
+ */
+extern int posix_memalign(void **MemoryPtr, size_t Alignment,
+                          size_t SizeWanted);
+
 /**
  * @brief Resizes a previously allocated memory block.
  *
@@ -125,6 +189,228 @@ extern void free(void *ptr);
  */
 extern void AllocatorDeinit();
 
+/**
+ * @brief Reports usage statistics of the default heap.
+ *
+ * Everything except `largest_free_block` is tracked as the heap runs, so
+ * the query is O(1). With `full_walk` set, the free blocks of the largest
+ * size class are walked to make `largest_free_block` (and with it
+ * `fragmentation_permille`) exact.
+ *
+ * @param stats Receives the statistics.
+ * @param full_walk Non-zero to walk the largest size class.
+ * @return `1` on success, `0` if there is no heap.
+ */
+extern uint8_t AllocatorGetStats(HeapStats *stats, uint8_t full_walk);
+
+/**
+ * @defgroup HeapInstances Heap Instances
+ * @brief Independent heaps over separate memory regions.
+ *
+ * Every heap keeps its bookkeeping at the start of its own region, so a
+ * program can run several of them side by side, e.g. one in tightly coupled
+ * RAM for hot data and one in external RAM for bulk buffers. The functions
+ * above operate on the default heap, the one set up by `AllocatorInit`.
+ *
+ * A block must be resized and released through the heap it came from.
+ */
+
+/**
+ * @brief Opaque handle to a heap instance.
+ */
+typedef struct Heap Heap;
+
+/**
+ * @brief Builds a new heap over a memory region.
+ *
+ * The region is owned by the heap until it is no longer used; there is
+ * nothing to tear down. Creating a heap does not change the default heap.
+ *
+ * @param region A pointer to the start of the memory region.
+ * @param region_size The total size of the memory region.
+ * @return The heap, or `NULL` if the region is too small.
+ */
+extern Heap *HeapCreate(void *region, size_t region_size);
+
+/**
+ * @brief Returns the default heap, or `NULL` before `AllocatorInit`.
+ */
+extern Heap *HeapDefault(void);
+
+/**
+ * @brief `malloc` on a specific heap.
+ */
+extern void *HeapAlloc(Heap *heap, size_t SizeWanted);
+
+/**
+ * @brief `calloc` on a specific heap.
+ */
+extern void *HeapCalloc(Heap *heap, size_t NumberOfElements,
+                        size_t ElementSize);
+
+/**
+ * @brief `aligned_alloc` on a specific heap.
+ */
+extern void *HeapAlignedAlloc(Heap *heap, size_t Alignment, size_t SizeWanted);
+
+/**
+ * @brief `realloc` on a specific heap. The block stays in `heap`.
+ */
+extern void *HeapRealloc(Heap *heap, void *ptr, size_t NewSizeWanted);
+
+/**
+ * @brief `free` on a specific heap.
+ */
+extern void HeapFree(Heap *heap, void *ptr);
+
+/**
+ * @brief `AllocatorGetStats` on a specific heap.
+ */
+extern uint8_t HeapGetStats(Heap *heap, HeapStats *stats, uint8_t full_walk);
+
+#ifdef USE_LIST_ALLOCATOR
+/**
+ * @defgroup HeapCheck Integrity Checking
+ * @brief Consistency walker and debug guards for the list allocator.
+ *
+ * `HeapCheck` walks every block and free list of a heap and reports the first
+ * inconsistency it finds. It is O(blocks) and only runs when called.
+ *
+ * Building with HEAP_DEBUG additionally tags every block header, guards the
+ * bytes right after each request, poisons freed memory with HEAP_POISON_BYTE
+ * and reports double and invalid frees through `HeapFault` instead of
+ * silently ignoring them. Without HEAP_DEBUG none of this code is compiled in.
+ */
+
+#define HEAP_CHECK_OK 0U          /**< The heap is consistent. */
+#define HEAP_CHECK_LINKAGE 1U     /**< Broken next/prev chain or stray block. */
+#define HEAP_CHECK_SIZE 2U        /**< Bad block size or size totals. */
+#define HEAP_CHECK_BINS 3U        /**< Free lists, bin classes or bin mask. */
+#define HEAP_CHECK_UNCOALESCED 4U /**< Two free blocks left side by side. */
+#define HEAP_CHECK_CANARY 5U      /**< Overwritten header tag or canary. */
+#define HEAP_CHECK_DOUBLE_FREE 6U /**< Block freed twice (HEAP_DEBUG). */
+#define HEAP_CHECK_INVALID_FREE 7U /**< Pointer not from this heap. */
+
+/**
+ * @brief Verifies the internal consistency of a heap.
+ *
+ * @return HEAP_CHECK_OK, or the HEAP_CHECK_* code of the first problem found
+ * (HEAP_CHECK_LINKAGE if `heap` is `NULL`).
+ */
+extern uint32_t HeapCheck(Heap *heap);
+
+/**
+ * @brief `HeapCheck` on the default heap.
+ */
+extern uint32_t AllocatorCheck(void);
+
+#ifdef HEAP_DEBUG
+#ifndef HEAP_POISON_BYTE
+#define HEAP_POISON_BYTE 0xDDU
+#endif
+
+/**
+ * @brief Called when a debug check fails on `free` or `realloc`.
+ *
+ * The offending block is left untouched. The default panics outside of
+ * TESTING_MODE and does nothing inside it; it is weak, so applications and
+ * tests can log or break instead.
+ *
+ * @param heap The heap the call was made on.
+ * @param ptr The pointer passed by the caller.
+ * @param fault One of the HEAP_CHECK_* codes.
+ */
+extern void HeapFault(Heap *heap, void *ptr, uint32_t fault);
+#endif
+#endif
+
+#ifdef HEAP_TRACE
+/**
+ * @defgroup HeapTrace Allocation Tracing
+ * @brief Records default-heap calls into a ring buffer (HEAP_TRACE builds).
+ *
+ * Every `malloc`, `calloc`, `aligned_alloc`, `realloc` and `free` on the
+ * default heap appends an event; once HEAP_TRACE_CAPACITY events are held the
+ * oldest is overwritten. Captures can be replayed against any backend with
+ * `zig build bench -- capture.htrc`.
+ */
+
+#ifndef HEAP_TRACE_CAPACITY
+#define HEAP_TRACE_CAPACITY 1024U
+#endif
+
+#define HEAP_TRACE_MALLOC 1U
+#define HEAP_TRACE_CALLOC 2U
+#define HEAP_TRACE_ALIGNED_ALLOC 3U
+#define HEAP_TRACE_REALLOC 4U
+#define HEAP_TRACE_FREE 5U
+
+/**
+ * @brief One recorded heap call.
+ */
+typedef struct HeapTraceEvent {
+  void *address;      /**< Block returned, or the block freed. */
+  void *previous;     /**< Block passed to realloc, otherwise NULL. */
+  void *call_site;    /**< Return address of the heap call. */
+  uint32_t size;      /**< Requested size in bytes (total for calloc). */
+  uint32_t timestamp; /**< From HeapTraceClock. */
+  uint8_t op;         /**< One of the HEAP_TRACE_* operations. */
+} HeapTraceEvent;
+
+/**
+ * @brief Timestamp source for events.
+ *
+ * Defaults to the cycle counter where there is one (DWT on Cortex-M3 and up,
+ * the TSC or virtual counter on hosts) and to an event sequence number
+ * elsewhere. Weak, so firmware can supply its own tick source.
+ */
+extern uint32_t HeapTraceClock(void);
+
+/**
+ * @brief Appends an event. Called by the backends, not by applications.
+ */
+extern void HeapTraceRecord(uint32_t op, void *address, void *previous,
+                            size_t size, void *call_site);
+
+/**
+ * @brief Copies up to `max_events` events, oldest first.
+ *
+ * @return The number of events copied.
+ */
+extern size_t HeapTraceSnapshot(HeapTraceEvent *events, size_t max_events);
+
+/**
+ * @brief Number of events recorded since the last clear, including those
+ * already overwritten.
+ */
+extern uint32_t HeapTraceCount(void);
+
+/**
+ * @brief Drops every recorded event.
+ */
+extern void HeapTraceClear(void);
+
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ * @brief Writes the held events to `path` as a binary capture (host only).
+ *
+ * The file starts with a 16-byte header: the magic "HTRC", a format version,
+ * the record size and the record count as 32-bit words. Each 40-byte record
+ * holds op and timestamp as 32-bit words, then size, address, previous
+ * block and call site as 64-bit words, all in host byte order.
+ *
+ * @return `1` on success, `0` if the file could not be written.
+ */
+extern uint8_t HeapTraceDump(const char *path);
+#endif
+
+#define HEAP_TRACE_RECORD(op, address, previous, size)                         \
+  HeapTraceRecord((op), (address), (previous), (size),                         \
+                  __builtin_return_address(0))
+#else
+#define HEAP_TRACE_RECORD(op, address, previous, size) ((void)0)
+#endif
+
 #endif
 #ifdef __cplusplus
 }
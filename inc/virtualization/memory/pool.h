@@ -0,0 +1,120 @@
+/**
+ * @file pool.h
+ * @brief Fixed-size object pool allocator.
+ *
+ * A pool hands out objects of a single size from one contiguous block. Free
+ * objects are chained through their own first word (an intrusive free list)
+ * and a one-bit-per-object bitmap records which slots are live, so objects
+ * carry no header, never fragment, and allocation and free are O(1).
+ *
+ * Pools can be carved out of a caller-provided buffer (`PoolInit`), which
+ * works without any heap, or out of the heap set up by `AllocatorInit`
+ * (`PoolCreate`).
+ */
+
+#ifndef COMPOS_POOL_H_
+#define COMPOS_POOL_H_
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Alignment of every object handed out by a pool.
+ */
+#define POOL_ALIGNMENT (sizeof(void *) * 2U)
+
+/**
+ * @brief Pool control block, placed at the start of the pool's storage.
+ */
+typedef struct Pool {
+  uint8_t *storage;   /**< First object slot. */
+  uint32_t *bitmap;   /**< One bit per slot, set while the slot is allocated. */
+  void *free_list;    /**< Intrusive list of returned slots. */
+  size_t object_size; /**< Slot size, rounded up to POOL_ALIGNMENT. */
+  size_t capacity;    /**< Number of slots. */
+  size_t untouched;   /**< Slots past this index have never been handed out. */
+  size_t available;   /**< Number of free slots. */
+  void *heap_block;   /**< Block returned by malloc, or NULL if caller-owned. */
+} Pool;
+
+/**
+ * @brief Bytes of storage needed for a pool of `count` objects of `size` bytes.
+ *
+ * Usable in constant expressions to size a static buffer for `PoolInit`.
+ */
+#define POOL_STORAGE_SIZE(size, count)                                         \
+  (((sizeof(Pool) + (((count) + 31U) / 32U) * sizeof(uint32_t) +              \
+     POOL_ALIGNMENT - 1U) &                                                    \
+    ~(POOL_ALIGNMENT - 1U)) +                                                  \
+   (count) * ((((size) < sizeof(void *) ? sizeof(void *) : (size)) +          \
+               POOL_ALIGNMENT - 1U) &                                          \
+              ~(POOL_ALIGNMENT - 1U)) +                                        \
+   POOL_ALIGNMENT)
+
+/**
+ * @brief Typed helpers.
+ */
+#define POOL_CREATE(type, count) PoolCreate(sizeof(type), (count))
+#define POOL_INIT(buffer, type)                                                \
+  PoolInit((buffer), sizeof(buffer), sizeof(type))
+#define POOL_ALLOC(pool, type) ((type *)PoolAlloc(pool))
+
+/**
+ * @brief Builds a pool inside a caller-provided buffer.
+ *
+ * The control block, bitmap and slots are all carved from `buffer`; the pool
+ * holds as many objects as fit. O(1): slots are threaded lazily.
+ *
+ * @param buffer Storage for the pool.
+ * @param buffer_size Size of `buffer` in bytes.
+ * @param object_size Size of each object in bytes.
+ * @return The pool, or `NULL` if not even one object fits.
+ */
+extern Pool *PoolInit(void *buffer, size_t buffer_size, size_t object_size);
+
+/**
+ * @brief Allocates one object from the pool.
+ *
+ * @param pool The pool to allocate from.
+ * @return A pointer to an uninitialized object, or `NULL` if the pool is
+ * exhausted.
+ */
+extern void *PoolAlloc(Pool *pool);
+
+/**
+ * @brief Returns an object to the pool.
+ *
+ * Pointers that do not belong to the pool, or that are already free, are
+ * ignored.
+ *
+ * @param pool The pool the object came from.
+ * @param ptr The object to free. If `NULL`, no action is taken.
+ */
+extern void PoolFree(Pool *pool, void *ptr);
+
+#ifndef NO_ALLOCATOR
+/**
+ * @brief Creates a pool of `object_count` objects on the heap.
+ *
+ * @param object_size Size of each object in bytes.
+ * @param object_count Number of objects.
+ * @return The pool, or `NULL` if the heap could not satisfy the request.
+ */
+extern Pool *PoolCreate(size_t object_size, size_t object_count);
+
+/**
+ * @brief Releases a pool created by `PoolCreate`.
+ *
+ * Pools built with `PoolInit` are left untouched; their storage belongs to
+ * the caller.
+ */
+extern void PoolDestroy(Pool *pool);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* COMPOS_POOL_H_ */
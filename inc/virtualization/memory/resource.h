@@ -0,0 +1,87 @@
+/**
+ * @file resource.h
+ * @brief Allocator handles for containers.
+ *
+ * A memory resource bundles an allocator's entry points with its state, so a
+ * container can be handed the default heap, a heap instance, an arena or a
+ * pool without knowing which. Containers take a `const MemoryResource *` and
+ * treat `NULL` as the default heap.
+ *
+ * Every call passes the size of the block back in, which lets arenas grow
+ * their most recent block in place and pools check that a request fits.
+ */
+
+#ifndef COMPOS_RESOURCE_H_
+#define COMPOS_RESOURCE_H_
+
+#include "types.h"
+#include "virtualization/memory/arena.h"
+#include "virtualization/memory/heap.h"
+#include "virtualization/memory/pool.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct MemoryResource {
+  void *(*allocate)(void *context, size_t size);
+  /** Optional; without it blocks are moved by allocate, copy and release. */
+  void *(*reallocate)(void *context, void *ptr, size_t old_size,
+                      size_t new_size);
+  void (*release)(void *context, void *ptr, size_t size);
+  void *context;
+} MemoryResource;
+
+/**
+ * @brief The default heap, the one set up by `AllocatorInit`.
+ */
+extern const MemoryResource *MemoryResourceDefault(void);
+
+#if !defined(USE_CLANG_ALLOCATOR) && !defined(NO_ALLOCATOR)
+/**
+ * @brief Fills `resource` to allocate from a heap instance.
+ */
+extern void MemoryResourceFromHeap(MemoryResource *resource, Heap *heap);
+#endif
+
+/**
+ * @brief Fills `resource` to allocate from an arena. Releases are ignored
+ * until the arena is rewound or reset, except for its most recent block.
+ */
+extern void MemoryResourceFromArena(MemoryResource *resource, Arena *arena);
+
+/**
+ * @brief Fills `resource` to hand out pool objects. Requests larger than
+ * the pool's object size fail.
+ */
+extern void MemoryResourceFromPool(MemoryResource *resource, Pool *pool);
+
+/**
+ * @brief Allocates `size` bytes; `resource` may be `NULL`.
+ *
+ * @return The block, or `NULL` if out of memory or `size` is zero.
+ */
+extern void *MemoryResourceAllocate(const MemoryResource *resource,
+                                    size_t size);
+
+/**
+ * @brief Resizes a block, moving its first `min(old_size, new_size)` bytes
+ * if it cannot be resized in place.
+ *
+ * @return The block, or `NULL` if out of memory; the old block is then
+ * left untouched.
+ */
+extern void *MemoryResourceReallocate(const MemoryResource *resource,
+                                      void *ptr, size_t old_size,
+                                      size_t new_size);
+
+/**
+ * @brief Releases a block of `size` bytes.
+ */
+extern void MemoryResourceRelease(const MemoryResource *resource, void *ptr,
+                                  size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // COMPOS_RESOURCE_H_
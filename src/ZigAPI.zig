@@ -3,13 +3,55 @@ const ZigHeap = @import("./virtualization/memory/ZigHeap.zig");
 const c = @cImport({
     @cInclude("../inc/virtualization/memory/heap.h");
 });
+
+// Default-heap entry points that also record into the HEAP_TRACE ring buffer
+const Traced = struct {
+    fn malloc(size: usize) callconv(.C) ?*anyopaque {
+        const ptr = ZigHeap.malloc(size);
+        c.HeapTraceRecord(c.HEAP_TRACE_MALLOC, ptr, null, size, @ptrFromInt(@returnAddress()));
+        return ptr;
+    }
+
+    fn aligned_alloc(alignment: usize, size: usize) callconv(.C) ?*anyopaque {
+        const ptr = ZigHeap.aligned_alloc(alignment, size);
+        c.HeapTraceRecord(c.HEAP_TRACE_ALIGNED_ALLOC, ptr, null, size, @ptrFromInt(@returnAddress()));
+        return ptr;
+    }
+
+    fn calloc(num: usize, size: usize) callconv(.C) ?*anyopaque {
+        const ptr = ZigHeap.calloc(num, size);
+        c.HeapTraceRecord(c.HEAP_TRACE_CALLOC, ptr, null, if (ptr != null) num * size else 0, @ptrFromInt(@returnAddress()));
+        return ptr;
+    }
+
+    fn realloc(ptr: ?*anyopaque, new_size: usize) callconv(.C) ?*anyopaque {
+        const new_ptr = ZigHeap.realloc(ptr, new_size);
+        c.HeapTraceRecord(c.HEAP_TRACE_REALLOC, new_ptr, ptr, new_size, @ptrFromInt(@returnAddress()));
+        return new_ptr;
+    }
+
+    fn free(ptr: ?*anyopaque) callconv(.C) void {
+        c.HeapTraceRecord(c.HEAP_TRACE_FREE, ptr, null, 0, @ptrFromInt(@returnAddress()));
+        ZigHeap.free(ptr);
+    }
+};
+
 comptime {
     if (@hasDecl(c, "USE_ZIG_ALLOCATOR")) {
+        const Default = if (@hasDecl(c, "HEAP_TRACE")) Traced else ZigHeap;
         @export(ZigHeap.AllocatorInit, .{ .name = "AllocatorInit" });
         @export(ZigHeap.AllocatorDeinit, .{ .name = "AllocatorDeinit" });
-        @export(ZigHeap.malloc, .{ .name = "malloc" });
-        @export(ZigHeap.calloc, .{ .name = "calloc" });
-        @export(ZigHeap.realloc, .{ .name = "realloc" });
-        @export(ZigHeap.free, .{ .name = "free" });
+        @export(Default.malloc, .{ .name = "malloc" });
+        @export(Default.calloc, .{ .name = "calloc" });
+        @export(Default.aligned_alloc, .{ .name = "aligned_alloc" });
+        @export(Default.realloc, .{ .name = "realloc" });
+        @export(Default.free, .{ .name = "free" });
+        @export(ZigHeap.HeapCreate, .{ .name = "HeapCreate" });
+        @export(ZigHeap.HeapDefault, .{ .name = "HeapDefault" });
+        @export(ZigHeap.HeapAlloc, .{ .name = "HeapAlloc" });
+        @export(ZigHeap.HeapAlignedAlloc, .{ .name = "HeapAlignedAlloc" });
+        @export(ZigHeap.HeapRealloc, .{ .name = "HeapRealloc" });
+        @export(ZigHeap.HeapFree, .{ .name = "HeapFree" });
+        @export(ZigHeap.HeapGetStats, .{ .name = "HeapGetStats" });
     }
 }
@@ -1 +1,31 @@
-#include "std/list.h"
\ No newline at end of file
+/**
+ * @file list.cpp
+ * @brief Intrusive list operations that walk the list; the O(1) ones are
+ * inline in the header.
+ */
+#include "std/list.h"
+
+extern "C" {
+
+size_t ListCount(const List* const list) {
+    size_t count = 0;
+    for (const ListNode* node = list->head; node != nullptr; node = node->next) {
+        count++;
+    }
+    return count;
+}
+
+void ListInsertSorted(List* const list, ListNode* const node, const ListCompare compare) {
+    ListNode* position = list->tail;
+    while (position != nullptr && compare(position, node) > 0) {
+        position = position->prev;
+    }
+
+    if (position != nullptr) {
+        ListInsertAfter(list, position, node);
+    } else {
+        ListPushFront(list, node);
+    }
+}
+
+} // extern "C"
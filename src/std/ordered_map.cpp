@@ -1 +1,707 @@
+/**
+ * @file ordered_map.cpp
+ * @brief C interface of the B+-tree map; the C++ wrapper is header-only.
+ *
+ * Node layout: the header, the keys from offset NODE_HEADER, then either the
+ * values (leaf, from `value_offset`) or the child pointers (branch, from
+ * `child_offset`). Child `i` of a branch holds the keys below key `i` and
+ * not below key `i - 1`, so a separator equals the smallest key to its right
+ * when it is made and stays a valid bound after that key is removed.
+ *
+ * Every node but the root is about half full or more: leaves hold at least
+ * half their capacity, branches at least `(branch_capacity - 1) / 2` keys,
+ * which both splits and bulk loading guarantee. Updates descend once,
+ * remembering the path, and fix up nodes bottom-up along it.
+ */
 #include "std/ordered_map.h"
+
+#include "types.h"
+#include <string.h>
+#include <stdint.h>
+
+// Keys start 8-byte aligned after the header
+#define NODE_HEADER ((sizeof(OrderedMapNode) + 7U) & ~(size_t)7U)
+
+// Smallest capacities; they keep every branch at least 3 children wide
+#define CAPACITY_MIN 5U
+
+typedef struct Path {
+    OrderedMapNode* nodes[ORDERED_MAP_MAX_DEPTH];
+    size_t slots[ORDERED_MAP_MAX_DEPTH]; /**< Child taken at each branch. */
+} Path;
+
+/*
+ * Node access
+ */
+static inline uint8_t* bytesOf(const OrderedMapNode* const node) {
+    return reinterpret_cast<uint8_t*>(const_cast<OrderedMapNode*>(node));
+}
+
+static inline uint8_t* keyAt(const OrderedMap* const map, const OrderedMapNode* const node, const size_t index) {
+    return bytesOf(node) + NODE_HEADER + index * map->key_size;
+}
+
+static inline uint8_t* valueAt(const OrderedMap* const map, const OrderedMapNode* const node, const size_t index) {
+    return bytesOf(node) + map->value_offset + index * map->value_size;
+}
+
+static inline OrderedMapNode** childrenOf(const OrderedMap* const map, const OrderedMapNode* const node) {
+    return reinterpret_cast<OrderedMapNode**>(bytesOf(node) + map->child_offset);
+}
+
+static inline int compareKeys(const OrderedMap* const map, const void* const a, const void* const b) {
+    if (map->compare != nullptr) {
+        return map->compare(a, b, map->key_size);
+    }
+    switch (map->key_size) {
+    case sizeof(uint8_t):
+        return (int)*static_cast<const uint8_t*>(a) - (int)*static_cast<const uint8_t*>(b);
+    case sizeof(uint16_t): {
+        uint16_t x;
+        uint16_t y;
+        __builtin_memcpy(&x, a, sizeof(x));
+        __builtin_memcpy(&y, b, sizeof(y));
+        return (int)x - (int)y;
+    }
+    case sizeof(uint32_t): {
+        uint32_t x;
+        uint32_t y;
+        __builtin_memcpy(&x, a, sizeof(x));
+        __builtin_memcpy(&y, b, sizeof(y));
+        return (x > y) - (x < y);
+    }
+    case sizeof(uint64_t): {
+        uint64_t x;
+        uint64_t y;
+        __builtin_memcpy(&x, a, sizeof(x));
+        __builtin_memcpy(&y, b, sizeof(y));
+        return (x > y) - (x < y);
+    }
+    default:
+        return memcmp(a, b, map->key_size);
+    }
+}
+
+// First index whose key compares at least `threshold` against `key`: the
+// lower bound for 0, the upper bound for 1
+static size_t boundIn(const OrderedMap* const map, const OrderedMapNode* const node, const void* const key,
+                      const int threshold) {
+    size_t low = 0;
+    size_t high = node->count;
+    while (low < high) {
+        const size_t middle = (low + high) / 2U;
+        if (compareKeys(map, keyAt(map, node, middle), key) < threshold) {
+            low = middle + 1U;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+// Leaf that holds `key` or would; records the way down in `path` unless NULL
+static OrderedMapNode* descend(const OrderedMap* const map, const void* const key, Path* const path) {
+    OrderedMapNode* node = map->root;
+    for (size_t level = 0; !node->leaf; level++) {
+        const size_t slot = boundIn(map, node, key, 1);
+        if (path != nullptr) {
+            path->nodes[level] = node;
+            path->slots[level] = slot;
+        }
+        node = childrenOf(map, node)[slot];
+    }
+    return node;
+}
+
+/*
+ * Moving entries, within a node or between two
+ */
+static inline void moveKeys(const OrderedMap* const map, OrderedMapNode* const to, const size_t to_index,
+                            const OrderedMapNode* const from, const size_t from_index, const size_t count) {
+    memmove(keyAt(map, to, to_index), keyAt(map, from, from_index), count * map->key_size);
+}
+
+static inline void moveEntries(const OrderedMap* const map, OrderedMapNode* const to, const size_t to_index,
+                               const OrderedMapNode* const from, const size_t from_index, const size_t count) {
+    moveKeys(map, to, to_index, from, from_index, count);
+    if (map->value_size > 0) {
+        memmove(valueAt(map, to, to_index), valueAt(map, from, from_index), count * map->value_size);
+    }
+}
+
+static inline void moveChildren(const OrderedMap* const map, OrderedMapNode* const to, const size_t to_index,
+                                const OrderedMapNode* const from, const size_t from_index, const size_t count) {
+    memmove(childrenOf(map, to) + to_index, childrenOf(map, from) + from_index, count * sizeof(OrderedMapNode*));
+}
+
+static OrderedMapNode* newNode(const OrderedMap* const map, const uint8_t leaf) {
+    OrderedMapNode* const node = static_cast<OrderedMapNode*>(MemoryResourceAllocate(map->resource, map->node_size));
+    if (node != nullptr) {
+        node->next = nullptr;
+        node->count = 0;
+        node->leaf = leaf;
+    }
+    return node;
+}
+
+static inline void releaseNode(const OrderedMap* const map, OrderedMapNode* const node) {
+    MemoryResourceRelease(map->resource, node, map->node_size);
+}
+
+static void releaseTree(const OrderedMap* const map, OrderedMapNode* const node) {
+    if (!node->leaf) {
+        OrderedMapNode** const children = childrenOf(map, node);
+        for (size_t i = 0; i <= node->count; i++) {
+            releaseTree(map, children[i]);
+        }
+    }
+    releaseNode(map, node);
+}
+
+/*
+ * Insertion
+ */
+static uint8_t* insertIntoLeaf(const OrderedMap* const map, OrderedMapNode* const leaf, const size_t index,
+                               const void* const key) {
+    moveEntries(map, leaf, index + 1U, leaf, index, leaf->count - index);
+    memcpy(keyAt(map, leaf, index), key, map->key_size);
+    leaf->count++;
+    return valueAt(map, leaf, index);
+}
+
+static void insertIntoBranch(const OrderedMap* const map, OrderedMapNode* const branch, const size_t index,
+                             const void* const key, OrderedMapNode* const child) {
+    moveKeys(map, branch, index + 1U, branch, index, branch->count - index);
+    moveChildren(map, branch, index + 2U, branch, index + 1U, branch->count - index);
+    memcpy(keyAt(map, branch, index), key, map->key_size);
+    childrenOf(map, branch)[index + 1U] = child;
+    branch->count++;
+}
+
+// Splits the full `leaf` into it and `right`, then inserts `key` at `index`
+static uint8_t* splitLeaf(const OrderedMap* const map, OrderedMapNode* const leaf, OrderedMapNode* const right,
+                          const size_t index, const void* const key) {
+    const size_t half = (leaf->count + 1U) / 2U;
+    moveEntries(map, right, 0, leaf, half, leaf->count - half);
+    right->count = static_cast<uint16_t>(leaf->count - half);
+    leaf->count = static_cast<uint16_t>(half);
+    right->next = leaf->next;
+    leaf->next = right;
+    return (index <= half) ? insertIntoLeaf(map, leaf, index, key) : insertIntoLeaf(map, right, index - half, key);
+}
+
+/*
+ * Splits the full `branch` into it and `right` while inserting `key` and
+ * `child` at `index`, leaving the key that moves up to the parent in the
+ * last key slot of `right`, which its own keys never reach.
+ */
+static void splitBranch(const OrderedMap* const map, OrderedMapNode* const branch, OrderedMapNode* const right,
+                        const size_t index, const void* const key, OrderedMapNode* const child) {
+    const size_t count = branch->count;
+    const size_t up = (count + 1U) / 2U;
+    uint8_t* const carried = keyAt(map, right, map->branch_capacity - 1U);
+
+    if (index < up) {
+        memcpy(carried, keyAt(map, branch, up - 1U), map->key_size);
+        moveKeys(map, right, 0, branch, up, count - up);
+        moveChildren(map, right, 0, branch, up, count - up + 1U);
+        right->count = static_cast<uint16_t>(count - up);
+        branch->count = static_cast<uint16_t>(up - 1U);
+        insertIntoBranch(map, branch, index, key, child);
+    } else if (index == up) {
+        memcpy(carried, key, map->key_size);
+        moveKeys(map, right, 0, branch, up, count - up);
+        childrenOf(map, right)[0] = child;
+        moveChildren(map, right, 1U, branch, up + 1U, count - up);
+        right->count = static_cast<uint16_t>(count - up);
+        branch->count = static_cast<uint16_t>(up);
+    } else {
+        memcpy(carried, keyAt(map, branch, up), map->key_size);
+        moveKeys(map, right, 0, branch, up + 1U, count - up - 1U);
+        moveChildren(map, right, 0, branch, up + 1U, count - up);
+        right->count = static_cast<uint16_t>(count - up - 1U);
+        branch->count = static_cast<uint16_t>(up);
+        insertIntoBranch(map, right, index - up - 1U, key, child);
+    }
+}
+
+/*
+ * Inserts into the full leaf at the end of `path`. Every node the splits
+ * need is allocated first, so running out of memory changes nothing.
+ */
+static uint8_t* insertSplitting(OrderedMap* const map, const Path* const path, OrderedMapNode* const leaf,
+                                const size_t index, const void* const key) {
+    size_t needed = 1;
+    size_t level = map->depth - 1U;
+    while (level > 0 && path->nodes[level - 1U]->count == map->branch_capacity) {
+        needed++;
+        level--;
+    }
+    if (level == 0) {
+        if (map->depth == ORDERED_MAP_MAX_DEPTH) {
+            return nullptr;
+        }
+        needed++; // a new root
+    }
+
+    OrderedMapNode* spare[ORDERED_MAP_MAX_DEPTH + 1U];
+    for (size_t i = 0; i < needed; i++) {
+        spare[i] = newNode(map, 0);
+        if (spare[i] == nullptr) {
+            while (i > 0) {
+                releaseNode(map, spare[--i]);
+            }
+            return nullptr;
+        }
+    }
+
+    OrderedMapNode* right = spare[--needed];
+    right->leaf = 1;
+    uint8_t* const value = splitLeaf(map, leaf, right, index, key);
+    const void* separator = keyAt(map, right, 0);
+
+    for (level = map->depth - 1U; level > 0; level--) {
+        OrderedMapNode* const parent = path->nodes[level - 1U];
+        const size_t slot = path->slots[level - 1U];
+        if (parent->count < map->branch_capacity) {
+            insertIntoBranch(map, parent, slot, separator, right);
+            return value;
+        }
+        OrderedMapNode* const sibling = spare[--needed];
+        splitBranch(map, parent, sibling, slot, separator, right);
+        separator = keyAt(map, sibling, map->branch_capacity - 1U);
+        right = sibling;
+    }
+
+    OrderedMapNode* const root = spare[--needed];
+    memcpy(keyAt(map, root, 0), separator, map->key_size);
+    childrenOf(map, root)[0] = map->root;
+    childrenOf(map, root)[1] = right;
+    root->count = 1;
+    map->root = root;
+    map->depth++;
+    return value;
+}
+
+/*
+ * Removal: a node below half full borrows from a sibling that can spare an
+ * entry, or else merges with it, which may leave the parent short in turn.
+ */
+static void borrowFromLeft(const OrderedMap* const map, OrderedMapNode* const parent, const size_t slot) {
+    OrderedMapNode* const node = childrenOf(map, parent)[slot];
+    OrderedMapNode* const left = childrenOf(map, parent)[slot - 1U];
+    const size_t last = left->count - 1U;
+
+    if (node->leaf) {
+        moveEntries(map, node, 1U, node, 0, node->count);
+        moveEntries(map, node, 0, left, last, 1U);
+        memcpy(keyAt(map, parent, slot - 1U), keyAt(map, node, 0), map->key_size);
+    } else {
+        moveKeys(map, node, 1U, node, 0, node->count);
+        moveChildren(map, node, 1U, node, 0, node->count + 1U);
+        memcpy(keyAt(map, node, 0), keyAt(map, parent, slot - 1U), map->key_size);
+        childrenOf(map, node)[0] = childrenOf(map, left)[left->count];
+        memcpy(keyAt(map, parent, slot - 1U), keyAt(map, left, last), map->key_size);
+    }
+    left->count--;
+    node->count++;
+}
+
+static void borrowFromRight(const OrderedMap* const map, OrderedMapNode* const parent, const size_t slot) {
+    OrderedMapNode* const node = childrenOf(map, parent)[slot];
+    OrderedMapNode* const right = childrenOf(map, parent)[slot + 1U];
+
+    if (node->leaf) {
+        moveEntries(map, node, node->count, right, 0, 1U);
+        moveEntries(map, right, 0, right, 1U, right->count - 1U);
+        memcpy(keyAt(map, parent, slot), keyAt(map, right, 0), map->key_size);
+    } else {
+        memcpy(keyAt(map, node, node->count), keyAt(map, parent, slot), map->key_size);
+        childrenOf(map, node)[node->count + 1U] = childrenOf(map, right)[0];
+        memcpy(keyAt(map, parent, slot), keyAt(map, right, 0), map->key_size);
+        moveKeys(map, right, 0, right, 1U, right->count - 1U);
+        moveChildren(map, right, 0, right, 1U, right->count);
+    }
+    right->count--;
+    node->count++;
+}
+
+// Merges child `slot + 1` of `parent` into child `slot`
+static void mergeChildren(const OrderedMap* const map, OrderedMapNode* const parent, const size_t slot) {
+    OrderedMapNode* const left = childrenOf(map, parent)[slot];
+    OrderedMapNode* const right = childrenOf(map, parent)[slot + 1U];
+
+    if (left->leaf) {
+        moveEntries(map, left, left->count, right, 0, right->count);
+        left->count = static_cast<uint16_t>(left->count + right->count);
+        left->next = right->next;
+    } else {
+        memcpy(keyAt(map, left, left->count), keyAt(map, parent, slot), map->key_size);
+        moveKeys(map, left, left->count + 1U, right, 0, right->count);
+        moveChildren(map, left, left->count + 1U, right, 0, right->count + 1U);
+        left->count = static_cast<uint16_t>(left->count + right->count + 1U);
+    }
+    releaseNode(map, right);
+
+    moveKeys(map, parent, slot, parent, slot + 1U, parent->count - slot - 1U);
+    moveChildren(map, parent, slot + 1U, parent, slot + 2U, parent->count - slot - 1U);
+    parent->count--;
+}
+
+static void rebalance(OrderedMap* const map, const Path* const path, OrderedMapNode* node) {
+    for (size_t level = map->depth - 1U; level > 0; level--) {
+        const size_t minimum = node->leaf ? map->leaf_capacity / 2U : (map->branch_capacity - 1U) / 2U;
+        if (node->count >= minimum) {
+            break;
+        }
+
+        OrderedMapNode* const parent = path->nodes[level - 1U];
+        const size_t slot = path->slots[level - 1U];
+        OrderedMapNode** const children = childrenOf(map, parent);
+        if (slot > 0 && children[slot - 1U]->count > minimum) {
+            borrowFromLeft(map, parent, slot);
+            break;
+        }
+        if (slot < parent->count && children[slot + 1U]->count > minimum) {
+            borrowFromRight(map, parent, slot);
+            break;
+        }
+        mergeChildren(map, parent, (slot > 0) ? slot - 1U : slot);
+        node = parent;
+    }
+
+    OrderedMapNode* const root = map->root;
+    if (root->count > 0) {
+        return;
+    }
+    if (root->leaf) {
+        map->root = nullptr;
+        map->first = nullptr;
+        map->depth = 0;
+    } else {
+        map->root = childrenOf(map, root)[0];
+        map->depth--;
+    }
+    releaseNode(map, root);
+}
+
+/*
+ * Bulk loading
+ */
+static inline size_t divideRoundingUp(const size_t x, const size_t y) {
+    return x / y + ((x % y) != 0);
+}
+
+static const uint8_t* smallestKey(const OrderedMap* const map, const OrderedMapNode* node) {
+    while (!node->leaf) {
+        node = childrenOf(map, node)[0];
+    }
+    return keyAt(map, node, 0);
+}
+
+// Builds the level above the `count` nodes chained from `below`, spreading
+// the children evenly; returns its first node
+static OrderedMapNode* buildBranches(const OrderedMap* const map, OrderedMapNode* below, const size_t count,
+                                     const size_t branches, OrderedMapNode** const spare) {
+    OrderedMapNode* first = nullptr;
+    OrderedMapNode* previous = nullptr;
+    for (size_t i = 0; i < branches; i++) {
+        OrderedMapNode* const branch = *spare;
+        *spare = branch->next;
+        branch->next = nullptr;
+        branch->leaf = 0;
+
+        const size_t children = count / branches + (i < count % branches);
+        for (size_t j = 0; j < children; j++) {
+            OrderedMapNode* const child = below;
+            below = child->next;
+            if (!child->leaf) {
+                child->next = nullptr;
+            }
+            childrenOf(map, branch)[j] = child;
+            if (j > 0) {
+                memcpy(keyAt(map, branch, j - 1U), smallestKey(map, child), map->key_size);
+            }
+        }
+        branch->count = static_cast<uint16_t>(children - 1U);
+
+        if (previous != nullptr) {
+            previous->next = branch;
+        } else {
+            first = branch;
+        }
+        previous = branch;
+    }
+    return first;
+}
+
+/*
+ * Layout
+ */
+static inline size_t roundUp(const size_t x, const size_t alignment) {
+    return (x + alignment - 1U) & ~(alignment - 1U);
+}
+
+static inline size_t alignmentOf(const size_t size) {
+    const size_t alignment = size & (~size + 1U);
+    return (alignment == 0 || alignment > 8U) ? 8U : alignment;
+}
+
+static inline size_t valueOffset(const OrderedMap* const map, const size_t capacity) {
+    return roundUp(NODE_HEADER + capacity * map->key_size, alignmentOf(map->value_size));
+}
+
+static inline size_t childOffset(const OrderedMap* const map, const size_t capacity) {
+    return roundUp(NODE_HEADER + capacity * map->key_size, sizeof(OrderedMapNode*));
+}
+
+static inline size_t leafBytes(const OrderedMap* const map, const size_t capacity) {
+    return valueOffset(map, capacity) + capacity * map->value_size;
+}
+
+static inline size_t branchBytes(const OrderedMap* const map, const size_t capacity) {
+    return childOffset(map, capacity) + (capacity + 1U) * sizeof(OrderedMapNode*);
+}
+
+static void setup(OrderedMap* const map) {
+    const size_t needed = (leafBytes(map, CAPACITY_MIN) > branchBytes(map, CAPACITY_MIN))
+                              ? leafBytes(map, CAPACITY_MIN)
+                              : branchBytes(map, CAPACITY_MIN);
+    map->node_size = (needed > ORDERED_MAP_NODE_SIZE) ? roundUp(needed, 8U) : ORDERED_MAP_NODE_SIZE;
+
+    size_t leaf = (map->node_size - NODE_HEADER) / (map->key_size + map->value_size);
+    while (leafBytes(map, leaf) > map->node_size) {
+        leaf--;
+    }
+    size_t branch = (map->node_size - NODE_HEADER) / (map->key_size + sizeof(OrderedMapNode*));
+    while (branchBytes(map, branch) > map->node_size) {
+        branch--;
+    }
+
+    // Counts are 16-bit
+    map->leaf_capacity = (leaf > UINT16_MAX) ? UINT16_MAX : leaf;
+    map->branch_capacity = (branch > UINT16_MAX) ? UINT16_MAX : branch;
+    map->value_offset = valueOffset(map, map->leaf_capacity);
+    map->child_offset = childOffset(map, map->branch_capacity);
+}
+
+extern "C" {
+
+void OrderedMapInit(OrderedMap* const map, const size_t key_size, const size_t value_size,
+                    const OrderedCompare compare, const MemoryResource* const resource) {
+    map->root = nullptr;
+    map->first = nullptr;
+    map->size = 0;
+    map->key_size = (key_size > 0) ? key_size : 1U;
+    map->value_size = value_size;
+    map->depth = 0;
+    map->compare = compare;
+    map->resource = resource;
+    setup(map);
+}
+
+void OrderedMapDestroy(OrderedMap* const map) {
+    if (map->root != nullptr) {
+        releaseTree(map, map->root);
+    }
+    map->root = nullptr;
+    map->first = nullptr;
+    map->size = 0;
+    map->depth = 0;
+}
+
+uint8_t OrderedMapBulkLoad(OrderedMap* const map, const void* const keys, const void* const values,
+                           const size_t count) {
+    if (map->root != nullptr) {
+        return 0;
+    }
+    if (count == 0) {
+        return 1;
+    }
+
+    const uint8_t* const key_bytes = static_cast<const uint8_t*>(keys);
+    for (size_t i = 1; i < count; i++) {
+        if (compareKeys(map, key_bytes + (i - 1U) * map->key_size, key_bytes + i * map->key_size) >= 0) {
+            return 0;
+        }
+    }
+
+    // Allocate every node up front, chained through `next`
+    const size_t leaves = divideRoundingUp(count, map->leaf_capacity);
+    size_t total = leaves;
+    size_t depth = 1;
+    for (size_t nodes = leaves; nodes > 1U; depth++) {
+        nodes = divideRoundingUp(nodes, map->branch_capacity + 1U);
+        total += nodes;
+    }
+    if (depth > ORDERED_MAP_MAX_DEPTH) {
+        return 0;
+    }
+
+    OrderedMapNode* spare = nullptr;
+    for (size_t i = 0; i < total; i++) {
+        OrderedMapNode* const node = newNode(map, 1);
+        if (node == nullptr) {
+            while (spare != nullptr) {
+                OrderedMapNode* const next = spare->next;
+                releaseNode(map, spare);
+                spare = next;
+            }
+            return 0;
+        }
+        node->next = spare;
+        spare = node;
+    }
+
+    // Leaves, filled evenly, so each is at least half full
+    const uint8_t* const value_bytes = static_cast<const uint8_t*>(values);
+    OrderedMapNode* previous = nullptr;
+    size_t done = 0;
+    for (size_t i = 0; i < leaves; i++) {
+        OrderedMapNode* const leaf = spare;
+        spare = leaf->next;
+        leaf->next = nullptr;
+
+        const size_t entries = count / leaves + (i < count % leaves);
+        memcpy(keyAt(map, leaf, 0), key_bytes + done * map->key_size, entries * map->key_size);
+        if (map->value_size > 0) {
+            if (value_bytes != nullptr) {
+                memcpy(valueAt(map, leaf, 0), value_bytes + done * map->value_size, entries * map->value_size);
+            } else {
+                memset(valueAt(map, leaf, 0), 0, entries * map->value_size);
+            }
+        }
+        leaf->count = static_cast<uint16_t>(entries);
+        done += entries;
+
+        if (previous != nullptr) {
+            previous->next = leaf;
+        } else {
+            map->first = leaf;
+        }
+        previous = leaf;
+    }
+
+    OrderedMapNode* level = map->first;
+    for (size_t nodes = leaves; nodes > 1U;) {
+        const size_t branches = divideRoundingUp(nodes, map->branch_capacity + 1U);
+        level = buildBranches(map, level, nodes, branches, &spare);
+        nodes = branches;
+    }
+
+    map->root = level;
+    map->depth = depth;
+    map->size = count;
+    return 1;
+}
+
+void* OrderedMapFind(const OrderedMap* const map, const void* const key) {
+    if (map->root == nullptr) {
+        return nullptr;
+    }
+    const OrderedMapNode* const leaf = descend(map, key, nullptr);
+    const size_t index = boundIn(map, leaf, key, 0);
+    if (index < leaf->count && compareKeys(map, keyAt(map, leaf, index), key) == 0) {
+        return valueAt(map, leaf, index);
+    }
+    return nullptr;
+}
+
+void* OrderedMapInsert(OrderedMap* const map, const void* const key, uint8_t* const inserted) {
+    if (inserted != nullptr) {
+        *inserted = 0;
+    }
+    if (map->root == nullptr) {
+        OrderedMapNode* const leaf = newNode(map, 1);
+        if (leaf == nullptr) {
+            return nullptr;
+        }
+        map->root = leaf;
+        map->first = leaf;
+        map->depth = 1;
+    }
+
+    Path path;
+    OrderedMapNode* const leaf = descend(map, key, &path);
+    const size_t index = boundIn(map, leaf, key, 0);
+    if (index < leaf->count && compareKeys(map, keyAt(map, leaf, index), key) == 0) {
+        return valueAt(map, leaf, index);
+    }
+
+    uint8_t* const value = (leaf->count < map->leaf_capacity) ? insertIntoLeaf(map, leaf, index, key)
+                                                              : insertSplitting(map, &path, leaf, index, key);
+    if (value != nullptr) {
+        map->size++;
+        if (inserted != nullptr) {
+            *inserted = 1;
+        }
+    }
+    return value;
+}
+
+uint8_t OrderedMapPut(OrderedMap* const map, const void* const key, const void* const value) {
+    void* const slot = OrderedMapInsert(map, key, nullptr);
+    if (slot == nullptr) {
+        return 0;
+    }
+    if (map->value_size > 0) {
+        memcpy(slot, value, map->value_size);
+    }
+    return 1;
+}
+
+uint8_t OrderedMapRemove(OrderedMap* const map, const void* const key) {
+    if (map->root == nullptr) {
+        return 0;
+    }
+
+    Path path;
+    OrderedMapNode* const leaf = descend(map, key, &path);
+    const size_t index = boundIn(map, leaf, key, 0);
+    if (index >= leaf->count || compareKeys(map, keyAt(map, leaf, index), key) != 0) {
+        return 0;
+    }
+
+    moveEntries(map, leaf, index, leaf, index + 1U, leaf->count - index - 1U);
+    leaf->count--;
+    map->size--;
+    rebalance(map, &path, leaf);
+    return 1;
+}
+
+void OrderedMapFirst(const OrderedMap* const map, OrderedMapIterator* const iterator) {
+    iterator->leaf = map->first;
+    iterator->index = 0;
+}
+
+void OrderedMapLowerBound(const OrderedMap* const map, const void* const key, OrderedMapIterator* const iterator) {
+    iterator->leaf = (map->root != nullptr) ? descend(map, key, nullptr) : nullptr;
+    iterator->index = (iterator->leaf != nullptr) ? boundIn(map, iterator->leaf, key, 0) : 0;
+}
+
+void OrderedMapUpperBound(const OrderedMap* const map, const void* const key, OrderedMapIterator* const iterator) {
+    iterator->leaf = (map->root != nullptr) ? descend(map, key, nullptr) : nullptr;
+    iterator->index = (iterator->leaf != nullptr) ? boundIn(map, iterator->leaf, key, 1) : 0;
+}
+
+uint8_t OrderedMapNext(const OrderedMap* const map, OrderedMapIterator* const iterator, void** const key,
+                       void** const value) {
+    while (iterator->leaf != nullptr && iterator->index >= iterator->leaf->count) {
+        iterator->leaf = iterator->leaf->next;
+        iterator->index = 0;
+    }
+    if (iterator->leaf == nullptr) {
+        return 0;
+    }
+
+    if (key != nullptr) {
+        *key = keyAt(map, iterator->leaf, iterator->index);
+    }
+    if (value != nullptr) {
+        *value = valueAt(map, iterator->leaf, iterator->index);
+    }
+    iterator->index++;
+    return 1;
+}
+
+} // extern "C"
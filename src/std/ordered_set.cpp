@@ -1 +1,40 @@
+/**
+ * @file ordered_set.cpp
+ * @brief Ordered set entry points, forwarding to the value-less OrderedMap.
+ */
 #include "std/ordered_set.h"
+
+#include "types.h"
+
+extern "C" {
+
+void OrderedSetInit(OrderedSet* const set, const size_t key_size, const OrderedCompare compare,
+                    const MemoryResource* const resource) {
+    OrderedMapInit(set, key_size, 0, compare, resource);
+}
+
+void OrderedSetDestroy(OrderedSet* const set) {
+    OrderedMapDestroy(set);
+}
+
+uint8_t OrderedSetBulkLoad(OrderedSet* const set, const void* const keys, const size_t count) {
+    return OrderedMapBulkLoad(set, keys, nullptr, count);
+}
+
+uint8_t OrderedSetAdd(OrderedSet* const set, const void* const key) {
+    return OrderedMapInsert(set, key, nullptr) != nullptr;
+}
+
+uint8_t OrderedSetContains(const OrderedSet* const set, const void* const key) {
+    return OrderedMapFind(set, key) != nullptr;
+}
+
+uint8_t OrderedSetRemove(OrderedSet* const set, const void* const key) {
+    return OrderedMapRemove(set, key);
+}
+
+uint8_t OrderedSetNext(const OrderedSet* const set, OrderedMapIterator* const iterator, void** const key) {
+    return OrderedMapNext(set, iterator, key, nullptr);
+}
+
+} // extern "C"
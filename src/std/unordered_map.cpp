@@ -1 +1,434 @@
+/**
+ * @file unordered_map.cpp
+ * @brief C interface of the flat hash map; the C++ wrapper is header-only.
+ *
+ * The control array holds `capacity + HASH_MAP_GROUP_WIDTH` bytes: the last
+ * group mirrors the first one, so a group load starting anywhere in the
+ * table never has to wrap. A table that has storage always keeps at least a
+ * quarter of its slots empty, which is what ends every probe.
+ *
+ * Invariant: no empty slot lies between an entry and the slot its hash
+ * picks (its home). Removal keeps it by moving later entries of the run
+ * back into the hole unless that would move them before their home.
+ */
 #include "std/unordered_map.h"
+
+#include "bits.h"
+#include "types.h"
+#include <string.h>
+#include <stdint.h>
+
+#if HASH_MAP_GROUP_WIDTH == 16U
+#include <emmintrin.h>
+#endif
+
+#define CONTROL_EMPTY 0x80U
+
+// Hash bits that pick the home slot, and the 7 kept in the control byte
+static inline size_t homeOf(const uint32_t hash, const size_t mask) {
+    return (size_t)(hash >> 7) & mask;
+}
+
+static inline uint8_t tagOf(const uint32_t hash) {
+    return (uint8_t)(hash & 0x7FU);
+}
+
+/*
+ * Group matching. A match mask has one bit per control byte, lowest byte in
+ * the lowest position; `nextMatch` turns the lowest set bit into an offset.
+ */
+#if HASH_MAP_GROUP_WIDTH == 16U
+typedef uint32_t GroupMask;
+
+static inline GroupMask matchTag(const uint8_t* const group, const uint8_t tag) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return (GroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)tag)));
+}
+
+static inline GroupMask matchEmpty(const uint8_t* const group) {
+    // Only empty bytes have the top bit set
+    return (GroupMask)_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group)));
+}
+
+static inline size_t nextMatch(GroupMask* const mask) {
+    const size_t offset = (size_t)Ctz32(*mask);
+    *mask &= *mask - 1U;
+    return offset;
+}
+#else
+// SWAR: eight control bytes in a 64-bit word, one result bit per byte's top
+typedef uint64_t GroupMask;
+
+#define BYTES_LOW 0x0101010101010101ULL
+#define BYTES_HIGH 0x8080808080808080ULL
+
+static inline uint64_t loadGroup(const uint8_t* const group) {
+    uint64_t word;
+    __builtin_memcpy(&word, group, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+static inline GroupMask matchTag(const uint8_t* const group, const uint8_t tag) {
+    // Zero bytes of x flag the matches; a borrow can add a false positive
+    // above a real one, which the key comparison then rejects
+    const uint64_t x = loadGroup(group) ^ (BYTES_LOW * tag);
+    return (x - BYTES_LOW) & ~x & BYTES_HIGH;
+}
+
+static inline GroupMask matchEmpty(const uint8_t* const group) {
+    return loadGroup(group) & BYTES_HIGH;
+}
+
+static inline size_t nextMatch(GroupMask* const mask) {
+    const size_t offset = (size_t)Ctz64(*mask) / 8U;
+    *mask &= *mask - 1U;
+    return offset;
+}
+#endif
+
+/*
+ * Slots
+ */
+static inline uint8_t* slotAt(const HashMap* const map, const size_t index) {
+    return map->slots + index * map->slot_size;
+}
+
+static inline void setControl(HashMap* const map, const size_t index, const uint8_t value) {
+    map->control[index] = value;
+    if (index < HASH_MAP_GROUP_WIDTH) {
+        map->control[map->capacity + index] = value;
+    }
+}
+
+static inline uint32_t hashKey(const HashMap* const map, const void* const key) {
+    return (map->hash != nullptr) ? map->hash(key, map->key_size) : HashBytes(key, map->key_size);
+}
+
+static inline uint8_t keysEqual(const HashMap* const map, const void* const a, const void* const b) {
+    if (map->equals != nullptr) {
+        return map->equals(a, b, map->key_size);
+    }
+    // Word-sized keys, the common case, compare without a library call
+    if (map->key_size == sizeof(uint32_t)) {
+        uint32_t x;
+        uint32_t y;
+        __builtin_memcpy(&x, a, sizeof(x));
+        __builtin_memcpy(&y, b, sizeof(y));
+        return x == y;
+    }
+    if (map->key_size == sizeof(uint64_t)) {
+        uint64_t x;
+        uint64_t y;
+        __builtin_memcpy(&x, a, sizeof(x));
+        __builtin_memcpy(&y, b, sizeof(y));
+        return x == y;
+    }
+    return memcmp(a, b, map->key_size) == 0;
+}
+
+static inline size_t alignmentOf(const size_t size) {
+    // Largest power of two dividing the size, which any type of it allows
+    const size_t alignment = size & (~size + 1U);
+    return (alignment == 0 || alignment > 8U) ? 8U : alignment;
+}
+
+static inline size_t roundUp(const size_t x, const size_t alignment) {
+    return (x + alignment - 1U) & ~(alignment - 1U);
+}
+
+static inline size_t controlBytes(const size_t capacity) {
+    return roundUp(capacity + HASH_MAP_GROUP_WIDTH, 8U);
+}
+
+static inline size_t maxLoad(const size_t capacity) {
+    return capacity / HASH_MAP_MAX_LOAD_DENOMINATOR * HASH_MAP_MAX_LOAD_NUMERATOR;
+}
+
+static void layout(HashMap* const map, uint8_t* const storage, const size_t capacity) {
+    map->control = storage;
+    map->slots = storage + controlBytes(capacity);
+    map->capacity = capacity;
+    memset(map->control, CONTROL_EMPTY, capacity + HASH_MAP_GROUP_WIDTH);
+}
+
+// Slot of `key`, or `capacity` if absent
+static size_t findIndex(const HashMap* const map, const void* const key, const uint32_t hash) {
+    if (map->capacity == 0) {
+        return 0;
+    }
+
+    const size_t mask = map->capacity - 1U;
+    const uint8_t tag = tagOf(hash);
+    size_t position = homeOf(hash, mask);
+    for (;;) {
+        const uint8_t* const group = map->control + position;
+        GroupMask matches = matchTag(group, tag);
+        while (matches != 0) {
+            const size_t index = (position + nextMatch(&matches)) & mask;
+            if (keysEqual(map, key, slotAt(map, index))) {
+                return index;
+            }
+        }
+        if (matchEmpty(group) != 0) {
+            return map->capacity;
+        }
+        position = (position + HASH_MAP_GROUP_WIDTH) & mask;
+    }
+}
+
+// First empty slot from the home of `hash`; the table is never full
+static size_t findEmpty(const HashMap* const map, const uint32_t hash) {
+    const size_t mask = map->capacity - 1U;
+    size_t position = homeOf(hash, mask);
+    for (;;) {
+        GroupMask empties = matchEmpty(map->control + position);
+        if (empties != 0) {
+            return (position + nextMatch(&empties)) & mask;
+        }
+        position = (position + HASH_MAP_GROUP_WIDTH) & mask;
+    }
+}
+
+static uint8_t* place(HashMap* const map, const void* const key, const uint32_t hash) {
+    const size_t index = findEmpty(map, hash);
+    setControl(map, index, tagOf(hash));
+    uint8_t* const slot = slotAt(map, index);
+    memcpy(slot, key, map->key_size);
+    map->size++;
+    return slot;
+}
+
+static uint8_t resize(HashMap* const map, const size_t capacity) {
+    size_t slot_bytes;
+    size_t bytes;
+    if (__builtin_mul_overflow(capacity, map->slot_size, &slot_bytes) ||
+        __builtin_add_overflow(slot_bytes, controlBytes(capacity), &bytes)) {
+        return 0;
+    }
+    uint8_t* const storage = static_cast<uint8_t*>(MemoryResourceAllocate(map->resource, bytes));
+    if (storage == nullptr) {
+        return 0;
+    }
+
+    HashMap old = *map;
+    layout(map, storage, capacity);
+    map->size = 0;
+    for (size_t i = 0; i < old.capacity; i++) {
+        if (old.control[i] != CONTROL_EMPTY) {
+            const uint8_t* const slot = slotAt(&old, i);
+            uint8_t* const moved = place(map, slot, hashKey(map, slot));
+            memcpy(moved + map->key_size, slot + map->key_size, map->slot_size - map->key_size);
+        }
+    }
+
+    if (old.control != nullptr) {
+        MemoryResourceRelease(map->resource, old.control,
+                              controlBytes(old.capacity) + old.capacity * old.slot_size);
+    }
+    return 1;
+}
+
+static size_t capacityFor(const size_t count) {
+    size_t capacity = HASH_MAP_GROUP_WIDTH;
+    while (maxLoad(capacity) < count) {
+        if (capacity > SIZE_MAX / 2U) {
+            return 0;
+        }
+        capacity *= 2U;
+    }
+    return capacity;
+}
+
+static uint8_t makeRoom(HashMap* const map, const size_t count) {
+    if (count <= maxLoad(map->capacity)) {
+        return 1;
+    }
+    if (map->fixed) {
+        return 0;
+    }
+    const size_t capacity = capacityFor(count);
+    return capacity != 0 && resize(map, capacity);
+}
+
+static void setup(HashMap* const map, const size_t key_size, const size_t value_size, const HashFunction hash,
+                  const HashEquals equals) {
+    const size_t value_alignment = (value_size > 0) ? alignmentOf(value_size) : 1U;
+    const size_t key_alignment = alignmentOf(key_size);
+    map->control = nullptr;
+    map->slots = nullptr;
+    map->capacity = 0;
+    map->size = 0;
+    map->key_size = key_size;
+    map->value_size = value_size;
+    map->value_offset = roundUp(key_size, value_alignment);
+    map->slot_size = roundUp(map->value_offset + value_size,
+                             (key_alignment > value_alignment) ? key_alignment : value_alignment);
+    map->hash = hash;
+    map->equals = equals;
+    map->resource = nullptr;
+    map->fixed = 0;
+}
+
+extern "C" {
+
+uint32_t HashBytes(const void* const key, const size_t key_size) {
+    const uint8_t* const bytes = static_cast<const uint8_t*>(key);
+    uint32_t hash;
+    if (key_size == sizeof(uint32_t)) {
+        __builtin_memcpy(&hash, bytes, sizeof(hash));
+    } else if (key_size == sizeof(uint64_t)) {
+        uint64_t word;
+        __builtin_memcpy(&word, bytes, sizeof(word));
+        hash = (uint32_t)word ^ (uint32_t)(word >> 32) * 0x9E3779B9U;
+    } else {
+        // FNV-1a
+        hash = 2166136261U;
+        for (size_t i = 0; i < key_size; i++) {
+            hash = (hash ^ bytes[i]) * 16777619U;
+        }
+    }
+
+    // Murmur3 finalizer: every input bit reaches the home and tag bits
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35U;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+void HashMapInit(HashMap* const map, const size_t key_size, const size_t value_size, const HashFunction hash,
+                 const HashEquals equals, const MemoryResource* const resource) {
+    setup(map, (key_size > 0) ? key_size : 1U, value_size, hash, equals);
+    map->resource = resource;
+}
+
+uint8_t HashMapInitFixed(HashMap* const map, const size_t key_size, const size_t value_size,
+                         const HashFunction hash, const HashEquals equals, void* const storage,
+                         const size_t storage_size, const size_t capacity) {
+    // Even when rejected the map is valid, and refuses every insert
+    setup(map, (key_size > 0) ? key_size : 1U, value_size, hash, equals);
+    map->fixed = 1;
+    if (storage == nullptr || capacity < HASH_MAP_GROUP_WIDTH || (capacity & (capacity - 1U)) != 0) {
+        return 0;
+    }
+
+    size_t bytes;
+    if (__builtin_mul_overflow(capacity, map->slot_size, &bytes) ||
+        __builtin_add_overflow(bytes, controlBytes(capacity), &bytes) || bytes > storage_size) {
+        return 0;
+    }
+
+    layout(map, static_cast<uint8_t*>(storage), capacity);
+    return 1;
+}
+
+void HashMapDestroy(HashMap* const map) {
+    if (map->fixed) {
+        HashMapClear(map);
+        return;
+    }
+    if (map->control != nullptr) {
+        MemoryResourceRelease(map->resource, map->control,
+                              controlBytes(map->capacity) + map->capacity * map->slot_size);
+    }
+    map->control = nullptr;
+    map->slots = nullptr;
+    map->capacity = 0;
+    map->size = 0;
+}
+
+uint8_t HashMapReserve(HashMap* const map, const size_t count) {
+    return makeRoom(map, count);
+}
+
+void* HashMapFind(const HashMap* const map, const void* const key) {
+    const size_t index = findIndex(map, key, hashKey(map, key));
+    return (index < map->capacity) ? slotAt(map, index) + map->value_offset : nullptr;
+}
+
+void* HashMapInsert(HashMap* const map, const void* const key, uint8_t* const inserted) {
+    const uint32_t hash = hashKey(map, key);
+    const size_t index = findIndex(map, key, hash);
+    if (inserted != nullptr) {
+        *inserted = 0;
+    }
+    if (index < map->capacity) {
+        return slotAt(map, index) + map->value_offset;
+    }
+
+    if (!makeRoom(map, map->size + 1U)) {
+        return nullptr;
+    }
+    if (inserted != nullptr) {
+        *inserted = 1;
+    }
+    return place(map, key, hash) + map->value_offset;
+}
+
+uint8_t HashMapPut(HashMap* const map, const void* const key, const void* const value) {
+    void* const slot = HashMapInsert(map, key, nullptr);
+    if (slot == nullptr) {
+        return 0;
+    }
+    if (map->value_size > 0) {
+        memcpy(slot, value, map->value_size);
+    }
+    return 1;
+}
+
+uint8_t HashMapRemove(HashMap* const map, const void* const key) {
+    size_t hole = findIndex(map, key, hashKey(map, key));
+    if (hole >= map->capacity) {
+        return 0;
+    }
+
+    // Backward shift: pull each later entry of the run into the hole unless
+    // its home lies cyclically after the hole
+    const size_t mask = map->capacity - 1U;
+    size_t index = (hole + 1U) & mask;
+    while (map->control[index] != CONTROL_EMPTY) {
+        const uint8_t* const slot = slotAt(map, index);
+        const size_t home = homeOf(hashKey(map, slot), mask);
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            memcpy(slotAt(map, hole), slot, map->slot_size);
+            setControl(map, hole, map->control[index]);
+            hole = index;
+        }
+        index = (index + 1U) & mask;
+    }
+
+    setControl(map, hole, CONTROL_EMPTY);
+    map->size--;
+    return 1;
+}
+
+void HashMapClear(HashMap* const map) {
+    if (map->control != nullptr) {
+        memset(map->control, CONTROL_EMPTY, map->capacity + HASH_MAP_GROUP_WIDTH);
+    }
+    map->size = 0;
+}
+
+uint8_t HashMapNext(const HashMap* const map, size_t* const position, void** const key, void** const value) {
+    for (size_t index = *position; index < map->capacity; index++) {
+        if (map->control[index] != CONTROL_EMPTY) {
+            uint8_t* const slot = slotAt(map, index);
+            if (key != nullptr) {
+                *key = slot;
+            }
+            if (value != nullptr) {
+                *value = slot + map->value_offset;
+            }
+            *position = index + 1U;
+            return 1;
+        }
+    }
+    *position = map->capacity;
+    return 0;
+}
+
+} // extern "C"
@@ -1 +1,42 @@
+/**
+ * @file unordered_set.cpp
+ * @brief Hash set entry points, forwarding to the value-less HashMap.
+ */
 #include "std/unordered_set.h"
+
+#include "types.h"
+
+extern "C" {
+
+void HashSetInit(HashSet* const set, const size_t key_size, const HashFunction hash, const HashEquals equals,
+                 const MemoryResource* const resource) {
+    HashMapInit(set, key_size, 0, hash, equals, resource);
+}
+
+uint8_t HashSetInitFixed(HashSet* const set, const size_t key_size, const HashFunction hash,
+                         const HashEquals equals, void* const storage, const size_t storage_size,
+                         const size_t capacity) {
+    return HashMapInitFixed(set, key_size, 0, hash, equals, storage, storage_size, capacity);
+}
+
+void HashSetDestroy(HashSet* const set) {
+    HashMapDestroy(set);
+}
+
+uint8_t HashSetAdd(HashSet* const set, const void* const key) {
+    return HashMapInsert(set, key, nullptr) != nullptr;
+}
+
+uint8_t HashSetContains(const HashSet* const set, const void* const key) {
+    return HashMapFind(set, key) != nullptr;
+}
+
+uint8_t HashSetRemove(HashSet* const set, const void* const key) {
+    return HashMapRemove(set, key);
+}
+
+uint8_t HashSetNext(const HashSet* const set, size_t* const position, void** const key) {
+    return HashMapNext(set, position, key, nullptr);
+}
+
+} // extern "C"
@@ -1 +1,219 @@
+/**
+ * @file vector.cpp
+ * @brief C interface of the growable array; the C++ wrapper is header-only.
+ *
+ * Storage is in one of three states: none (`data == NULL`), the inline
+ * buffer (`data == inline_data`), or a block from the vector's resource.
+ * Only the last is ever released or reallocated.
+ */
 #include "std/vector.h"
+
+#include "types.h"
+#include <string.h>
+#include <stdint.h>
+
+static inline uint8_t isInline(const Vector* const vector) {
+    return vector->data != nullptr && vector->data == vector->inline_data;
+}
+
+static inline uint8_t* elementAt(const Vector* const vector, const size_t index) {
+    return vector->data + index * vector->element_size;
+}
+
+static inline uint8_t bytesFor(const Vector* const vector, const size_t count, size_t* const bytes) {
+    return !__builtin_mul_overflow(count, vector->element_size, bytes);
+}
+
+// Moves the elements to `capacity` slots, `inline_data` or a new block
+static uint8_t relocateStorage(Vector* const vector, const size_t capacity) {
+    size_t bytes;
+    if (!bytesFor(vector, capacity, &bytes)) {
+        return 0;
+    }
+    const size_t old_bytes = vector->capacity * vector->element_size;
+    const size_t used_bytes = vector->size * vector->element_size;
+
+    uint8_t* target;
+    if (vector->inline_data != nullptr && capacity <= vector->inline_capacity) {
+        target = vector->inline_data;
+    } else if (!isInline(vector) && vector->relocate == nullptr) {
+        // Plain bytes: the allocator may resize the block in place
+        target = static_cast<uint8_t*>(MemoryResourceReallocate(vector->resource, vector->data, old_bytes, bytes));
+        if (target == nullptr) {
+            return 0;
+        }
+        vector->data = target;
+        vector->capacity = capacity;
+        return 1;
+    } else {
+        target = static_cast<uint8_t*>(MemoryResourceAllocate(vector->resource, bytes));
+        if (target == nullptr) {
+            return 0;
+        }
+    }
+
+    if (target != vector->data && vector->size > 0) {
+        if (vector->relocate != nullptr) {
+            vector->relocate(target, vector->data, vector->size);
+        } else {
+            memcpy(target, vector->data, used_bytes);
+        }
+    }
+    if (vector->data != nullptr && !isInline(vector) && target != vector->data) {
+        MemoryResourceRelease(vector->resource, vector->data, old_bytes);
+    }
+
+    vector->data = target;
+    vector->capacity = (target == vector->inline_data) ? vector->inline_capacity : capacity;
+    return 1;
+}
+
+// Capacity after running out with `needed` elements required
+static size_t grownCapacity(const Vector* const vector, const size_t needed) {
+    size_t capacity = vector->capacity;
+    if (capacity < SIZE_MAX / vector->growth) {
+        capacity = capacity * vector->growth / 100U;
+    } else {
+        capacity = SIZE_MAX;
+    }
+
+    if (capacity <= vector->capacity) {
+        capacity = vector->capacity + 1U;
+    }
+    if (capacity < VECTOR_CAPACITY_MIN) {
+        capacity = VECTOR_CAPACITY_MIN;
+    }
+    return (capacity < needed) ? needed : capacity;
+}
+
+static uint8_t ensureCapacity(Vector* const vector, const size_t needed) {
+    // Before the capacity check: a wrapped size + count is small enough to pass it
+    if (needed < vector->size) {
+        return 0;
+    }
+    if (needed <= vector->capacity) {
+        return 1;
+    }
+    return relocateStorage(vector, grownCapacity(vector, needed));
+}
+
+extern "C" {
+
+void VectorInit(Vector* const vector, const size_t element_size, const MemoryResource* const resource) {
+    VectorInitInline(vector, element_size, nullptr, 0, resource);
+}
+
+void VectorInitInline(Vector* const vector, const size_t element_size, void* const buffer, const size_t capacity,
+                      const MemoryResource* const resource) {
+    vector->inline_data = static_cast<uint8_t*>(buffer);
+    vector->inline_capacity = (buffer != nullptr) ? capacity : 0U;
+    vector->data = vector->inline_data;
+    vector->size = 0;
+    vector->capacity = vector->inline_capacity;
+    vector->element_size = (element_size > 0) ? element_size : 1U;
+    vector->resource = resource;
+    vector->relocate = nullptr;
+    vector->growth = VECTOR_GROWTH_DEFAULT;
+}
+
+void VectorDestroy(Vector* const vector) {
+    if (vector->data != nullptr && !isInline(vector)) {
+        MemoryResourceRelease(vector->resource, vector->data, vector->capacity * vector->element_size);
+    }
+    vector->data = vector->inline_data;
+    vector->size = 0;
+    vector->capacity = vector->inline_capacity;
+}
+
+void VectorSetGrowth(Vector* const vector, const uint16_t percent) {
+    vector->growth = (percent < VECTOR_GROWTH_MIN) ? static_cast<uint16_t>(VECTOR_GROWTH_MIN) : percent;
+}
+
+uint8_t VectorReserve(Vector* const vector, const size_t capacity) {
+    if (capacity <= vector->capacity) {
+        return 1;
+    }
+    return relocateStorage(vector, capacity);
+}
+
+uint8_t VectorShrinkToFit(Vector* const vector) {
+    if (isInline(vector) || vector->data == nullptr || vector->capacity == vector->size) {
+        return 1;
+    }
+    if (vector->size == 0 && vector->inline_data == nullptr) {
+        VectorDestroy(vector);
+        return 1;
+    }
+    return relocateStorage(vector, vector->size);
+}
+
+uint8_t VectorResize(Vector* const vector, const size_t size) {
+    if (size > vector->size) {
+        if (!ensureCapacity(vector, size)) {
+            return 0;
+        }
+        memset(elementAt(vector, vector->size), 0, (size - vector->size) * vector->element_size);
+    }
+    vector->size = size;
+    return 1;
+}
+
+void* VectorPush(Vector* const vector, const void* const element) {
+    if (!ensureCapacity(vector, vector->size + 1U)) {
+        return nullptr;
+    }
+
+    uint8_t* const slot = elementAt(vector, vector->size);
+    if (element != nullptr) {
+        memcpy(slot, element, vector->element_size);
+    }
+    vector->size++;
+    return slot;
+}
+
+uint8_t VectorAppend(Vector* const vector, const void* const elements, const size_t count) {
+    size_t bytes;
+    if (count == 0) {
+        return 1;
+    }
+    if (!bytesFor(vector, count, &bytes) || !ensureCapacity(vector, vector->size + count)) {
+        return 0;
+    }
+
+    memcpy(elementAt(vector, vector->size), elements, bytes);
+    vector->size += count;
+    return 1;
+}
+
+uint8_t VectorPop(Vector* const vector, void* const element) {
+    if (vector->size == 0) {
+        return 0;
+    }
+
+    vector->size--;
+    if (element != nullptr) {
+        memcpy(element, elementAt(vector, vector->size), vector->element_size);
+    }
+    return 1;
+}
+
+uint8_t VectorErase(Vector* const vector, const size_t index) {
+    if (index >= vector->size) {
+        return 0;
+    }
+
+    memmove(elementAt(vector, index), elementAt(vector, index + 1U),
+            (vector->size - index - 1U) * vector->element_size);
+    vector->size--;
+    return 1;
+}
+
+void* VectorAt(const Vector* const vector, const size_t index) {
+    return (index < vector->size) ? elementAt(vector, index) : nullptr;
+}
+
+void VectorClear(Vector* const vector) {
+    vector->size = 0;
+}
+
+} // extern "C"
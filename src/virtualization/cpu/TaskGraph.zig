@@ -0,0 +1,302 @@
+//! Task sets fixed at compile time, run from a precomputed table.
+//!
+//! `TaskGraph(spec)` takes every task with its period, worst-case cost and
+//! deadline in ticks, plus the message queues between tasks, and produces a
+//! type holding their control blocks and queue storage as statics. The
+//! schedule over one hyperperiod (the LCM of the periods) is worked out at
+//! compile time, preemptive at tick granularity, by earliest deadline or by
+//! fixed priority; a set that would miss a deadline is a compile error.
+//!
+//! ```zig
+//! const Graph = TaskGraph(.{
+//!     .tasks = .{
+//!         .{ .name = "sample", .function = &sampleTask, .period = 10, .cost = 2 },
+//!         .{ .name = "fuse", .function = &fuseTask, .period = 20, .cost = 5, .deadline = 15 },
+//!     },
+//!     .queues = .{
+//!         .{ .name = "samples", .type = u16, .capacity = 8 },
+//!     },
+//! });
+//!
+//! // From the tick interrupt or a timed loop:
+//! Graph.step();
+//! ```
+//!
+//! Each slot in the table runs its task function once, so a task gets
+//! `cost` dispatches per period and should return `TASK_YIELDED` between
+//! units of work and `TASK_EXITED` when its job is done. There is no ready
+//! queue, so the wait-list macros do not apply here.
+const std = @import("std");
+pub const c = @cImport({
+    @cInclude("virtualization/cpu/tasks.h");
+});
+
+pub const Policy = enum { earliest_deadline, priority };
+
+/// Largest hyperperiod accepted, so compile-time simulation stays bounded
+pub const max_hyperperiod: u32 = 1 << 14;
+
+/// Table entry for a tick with nothing to run
+pub const idle: u8 = std.math.maxInt(u8);
+
+const TaskSpec = struct {
+    name: [:0]const u8,
+    function: c.TaskFunction,
+    context: ?*anyopaque,
+    period: u32,
+    cost: u32,
+    deadline: u32,
+    priority: u8,
+};
+
+fn taskSpecs(comptime spec: anytype) []const TaskSpec {
+    comptime {
+        const count = spec.tasks.len;
+        if (count == 0 or count > 32) @compileError("A task graph needs between 1 and 32 tasks");
+
+        var specs: [count]TaskSpec = undefined;
+        inline for (spec.tasks, 0..) |task, i| {
+            const T = @TypeOf(task);
+            specs[i] = .{
+                .name = task.name,
+                .function = task.function,
+                .context = if (@hasField(T, "context")) task.context else null,
+                .period = task.period,
+                .cost = task.cost,
+                .deadline = if (@hasField(T, "deadline")) task.deadline else task.period,
+                .priority = if (@hasField(T, "priority")) task.priority else 0,
+            };
+            if (specs[i].period == 0 or specs[i].cost == 0) {
+                @compileError("Task '" ++ task.name ++ "' needs a non-zero period and cost");
+            }
+            if (specs[i].deadline > specs[i].period or specs[i].deadline < specs[i].cost) {
+                @compileError("Task '" ++ task.name ++ "' needs cost <= deadline <= period");
+            }
+        }
+        const frozen = specs;
+        return &frozen;
+    }
+}
+
+fn policyOf(comptime spec: anytype) Policy {
+    return if (@hasField(@TypeOf(spec), "policy")) spec.policy else .earliest_deadline;
+}
+
+fn hyperperiodOf(comptime tasks: []const TaskSpec) u32 {
+    comptime {
+        var lcm: u64 = 1;
+        for (tasks) |task| {
+            lcm = lcm / std.math.gcd(lcm, task.period) * task.period;
+            if (lcm > max_hyperperiod) {
+                @compileError(std.fmt.comptimePrint("Hyperperiod exceeds {} ticks; choose harmonic periods", .{max_hyperperiod}));
+            }
+        }
+        return @intCast(lcm);
+    }
+}
+
+/// Outcome of simulating one hyperperiod
+pub const Schedule = struct {
+    table: []const u8,
+    miss: ?struct { task: usize, tick: u32 },
+};
+
+fn simulate(comptime tasks: []const TaskSpec, comptime policy: Policy) Schedule {
+    comptime {
+        const hyperperiod = hyperperiodOf(tasks);
+        @setEvalBranchQuota(hyperperiod * tasks.len * 16 + 1000);
+
+        var table = [_]u8{idle} ** hyperperiod;
+        var remaining = [_]u32{0} ** tasks.len;
+        var due = [_]u32{0} ** tasks.len;
+        for (0..hyperperiod) |tick| {
+            for (tasks, 0..) |task, i| {
+                if (tick % task.period == 0) {
+                    remaining[i] = task.cost;
+                    due[i] = tick + task.deadline;
+                }
+            }
+
+            var chosen: ?usize = null;
+            for (tasks, 0..) |task, i| {
+                if (remaining[i] == 0) continue;
+                const best = chosen orelse {
+                    chosen = i;
+                    continue;
+                };
+                const more_urgent = switch (policy) {
+                    .earliest_deadline => due[i] < due[best],
+                    .priority => task.priority < tasks[best].priority,
+                };
+                if (more_urgent) chosen = i;
+            }
+
+            if (chosen) |i| {
+                table[tick] = i;
+                remaining[i] -= 1;
+            }
+            for (0..tasks.len) |i| {
+                if (remaining[i] > 0 and tick + 1 >= due[i]) {
+                    const frozen = table;
+                    return .{ .table = &frozen, .miss = .{ .task = i, .tick = due[i] } };
+                }
+            }
+        }
+        const frozen = table;
+        return .{ .table = &frozen, .miss = null };
+    }
+}
+
+/// Whether `spec` meets every deadline, for checks that should not fail the build
+pub fn isFeasible(comptime spec: anytype) bool {
+    return simulate(taskSpecs(spec), policyOf(spec)).miss == null;
+}
+
+/// Fixed-capacity FIFO for passing values between graph tasks
+pub fn StaticQueue(comptime T: type, comptime capacity: usize) type {
+    if (capacity == 0) @compileError("Queue capacity must be non-zero");
+    return struct {
+        const Self = @This();
+
+        buffer: [capacity]T = undefined,
+        head: usize = 0,
+        count: usize = 0,
+
+        pub fn push(self: *Self, value: T) bool {
+            if (self.count == capacity) return false;
+            self.buffer[(self.head + self.count) % capacity] = value;
+            self.count += 1;
+            return true;
+        }
+
+        pub fn pop(self: *Self) ?T {
+            if (self.count == 0) return null;
+            const value = self.buffer[self.head];
+            self.head = (self.head + 1) % capacity;
+            self.count -= 1;
+            return value;
+        }
+
+        pub fn len(self: *const Self) usize {
+            return self.count;
+        }
+    };
+}
+
+fn QueuesOf(comptime spec: anytype) type {
+    if (!@hasField(@TypeOf(spec), "queues")) return struct {};
+    var fields: [spec.queues.len]std.builtin.Type.StructField = undefined;
+    inline for (spec.queues, 0..) |queue, i| {
+        const Queue = StaticQueue(queue.type, queue.capacity);
+        const empty = Queue{};
+        fields[i] = .{
+            .name = queue.name,
+            .type = Queue,
+            .default_value = &empty,
+            .is_comptime = false,
+            .alignment = @alignOf(Queue),
+        };
+    }
+    return @Type(.{ .Struct = .{
+        .layout = .auto,
+        .fields = &fields,
+        .decls = &.{},
+        .is_tuple = false,
+    } });
+}
+
+pub fn TaskGraph(comptime spec: anytype) type {
+    const tasks = taskSpecs(spec);
+    const policy = policyOf(spec);
+    const schedule = simulate(tasks, policy);
+    if (schedule.miss) |miss| {
+        @compileError(std.fmt.comptimePrint("Task '{s}' misses its deadline at tick {}", .{ tasks[miss.task].name, miss.tick }));
+    }
+
+    return struct {
+        pub const task_count = tasks.len;
+        pub const hyperperiod = hyperperiodOf(tasks);
+        pub const dispatch_table: [hyperperiod]u8 = schedule.table[0..hyperperiod].*;
+
+        /// Bitmask of the tasks whose next job starts at each tick
+        pub const release_table: [hyperperiod]u32 = blk: {
+            @setEvalBranchQuota(hyperperiod * task_count * 4 + 1000);
+            var releases = [_]u32{0} ** hyperperiod;
+            for (tasks, 0..) |task, i| {
+                var tick: u32 = 0;
+                while (tick < hyperperiod) : (tick += task.period) releases[tick] |= 1 << i;
+            }
+            break :blk releases;
+        };
+
+        pub const utilization: f64 = blk: {
+            var sum: f64 = 0;
+            for (tasks) |task| sum += @as(f64, @floatFromInt(task.cost)) / @as(f64, @floatFromInt(task.period));
+            break :blk sum;
+        };
+
+        pub var control_blocks: [task_count]c.Task = blk: {
+            var blocks: [task_count]c.Task = undefined;
+            for (tasks, 0..) |task, i| {
+                blocks[i] = std.mem.zeroes(c.Task);
+                blocks[i].function = task.function;
+                blocks[i].context = task.context;
+                blocks[i].state = c.TASK_STATE_READY;
+            }
+            break :blk blocks;
+        };
+
+        pub var queues: QueuesOf(spec) = .{};
+
+        /// Jobs still running when their next release came round
+        pub var overruns = [_]u32{0} ** task_count;
+
+        var tick: u32 = 0;
+        var tick_count: u64 = 0;
+        var finished: u32 = 0;
+
+        /// Runs one tick of the table
+        pub fn step() void {
+            const releases = release_table[tick];
+            for (0..task_count) |i| {
+                if (releases & (@as(u32, 1) << @intCast(i)) == 0) continue;
+                if (finished & (@as(u32, 1) << @intCast(i)) == 0 and tick_count != 0) overruns[i] += 1;
+                finished &= ~(@as(u32, 1) << @intCast(i));
+            }
+
+            const slot = dispatch_table[tick];
+            if (slot != idle and finished & (@as(u32, 1) << @intCast(slot)) == 0) {
+                const block = &control_blocks[slot];
+                if (block.function.?(block) == c.TASK_EXITED) {
+                    block.resume_point = 0;
+                    finished |= @as(u32, 1) << @intCast(slot);
+                }
+            }
+
+            tick = if (tick + 1 == hyperperiod) 0 else tick + 1;
+            tick_count += 1;
+        }
+
+        /// Ticks stepped since the last reset
+        pub fn ticks() u64 {
+            return tick_count;
+        }
+
+        pub fn task(comptime name: []const u8) *c.Task {
+            inline for (tasks, 0..) |candidate, i| {
+                if (comptime std.mem.eql(u8, candidate.name, name)) return &control_blocks[i];
+            }
+            @compileError("No task named '" ++ name ++ "'");
+        }
+
+        /// Rewinds to tick 0 with every job pending and the queues empty
+        pub fn reset() void {
+            for (&control_blocks) |*block| block.resume_point = 0;
+            queues = .{};
+            overruns = [_]u32{0} ** task_count;
+            tick = 0;
+            tick_count = 0;
+            finished = 0;
+        }
+    };
+}
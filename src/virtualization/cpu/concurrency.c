@@ -1 +1,556 @@
 #include "virtualization/cpu/concurrency.h"
+#include "virtualization/cpu/scheduling.h"
+#include "assert.h"
+
+#include "types.h"
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Read-modify-write helpers. Elsewhere these are the compiler's atomics,
+ * LDREX/STREX loops on ARMv7-M and up; ARMv6-M has no exclusive access, so
+ * there they run with interrupts masked instead. Plain loads and stores are
+ * single instructions everywhere and use the builtins directly.
+ */
+#if defined(__ARM_ARCH_6M__)
+static inline uint32_t interruptsMask(void) {
+    uint32_t primask;
+    __asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r"(primask) : : "memory");
+    return primask;
+}
+
+static inline void interruptsRestore(const uint32_t primask) {
+    __asm__ volatile("msr primask, %0" : : "r"(primask) : "memory");
+}
+
+static inline uint8_t compareExchange(uint32_t* const target, uint32_t* const expected, const uint32_t desired,
+                                      const int order) {
+    const uint32_t primask = interruptsMask();
+    const uint8_t swapped = (*target == *expected);
+    if (swapped) {
+        *target = desired;
+    } else {
+        *expected = *target;
+    }
+    interruptsRestore(primask);
+    UNUSED(order);
+    return swapped;
+}
+
+static inline uint32_t exchange(uint32_t* const target, const uint32_t value, const int order) {
+    const uint32_t primask = interruptsMask();
+    const uint32_t previous = *target;
+    *target = value;
+    interruptsRestore(primask);
+    UNUSED(order);
+    return previous;
+}
+
+static inline uint32_t fetchAdd(uint32_t* const target, const uint32_t value, const int order) {
+    const uint32_t primask = interruptsMask();
+    const uint32_t previous = *target;
+    *target = previous + value;
+    interruptsRestore(primask);
+    UNUSED(order);
+    return previous;
+}
+
+static inline uint32_t fetchOr(uint32_t* const target, const uint32_t value, const int order) {
+    const uint32_t primask = interruptsMask();
+    const uint32_t previous = *target;
+    *target = previous | value;
+    interruptsRestore(primask);
+    UNUSED(order);
+    return previous;
+}
+
+static inline uint32_t fetchAnd(uint32_t* const target, const uint32_t value, const int order) {
+    const uint32_t primask = interruptsMask();
+    const uint32_t previous = *target;
+    *target = previous & value;
+    interruptsRestore(primask);
+    UNUSED(order);
+    return previous;
+}
+
+// Read-modify-write builtins would call into libatomic here; keep them out
+#pragma GCC poison __atomic_compare_exchange_n __atomic_exchange_n __atomic_fetch_add __atomic_fetch_or \
+    __atomic_fetch_and __atomic_add_fetch
+#else
+#define compareExchange(target, expected, desired, order)                                                      \
+    __atomic_compare_exchange_n((target), (expected), (desired), 0, (order), __ATOMIC_RELAXED)
+#define exchange(target, value, order) __atomic_exchange_n((target), (value), (order))
+#define fetchAdd(target, value, order) __atomic_fetch_add((target), (value), (order))
+#define fetchOr(target, value, order) __atomic_fetch_or((target), (value), (order))
+#define fetchAnd(target, value, order) __atomic_fetch_and((target), (value), (order))
+#endif
+
+/*
+ * Mutexes
+ *
+ * `state` is the whole fast path: FREE -> LOCKED on lock and back on unlock,
+ * each a single compare-and-swap. A task that finds the mutex taken marks it
+ * CONTENDED before parking, which sends the owner's unlock down the slow
+ * path to hand the mutex over.
+ *
+ * An interrupt cannot touch the wait list, so its contended unlock pushes
+ * the mutex onto a lock-free stack instead, still locked, and
+ * MutexDispatchPending hands it over from the next TaskRunOnce.
+ */
+#define MUTEX_FREE 0U
+#define MUTEX_LOCKED 1U
+#define MUTEX_CONTENDED 2U
+
+static Mutex* pending_unlocks = NULL;
+
+#if defined(__ARM_ARCH_6M__)
+static void pushUnlock(Mutex* const mutex) {
+    const uint32_t primask = interruptsMask();
+    mutex->pending_next = pending_unlocks;
+    pending_unlocks = mutex;
+    interruptsRestore(primask);
+}
+
+static Mutex* takeUnlocks(void) {
+    const uint32_t primask = interruptsMask();
+    Mutex* const mutex = pending_unlocks;
+    pending_unlocks = NULL;
+    interruptsRestore(primask);
+    return mutex;
+}
+#else
+static void pushUnlock(Mutex* const mutex) {
+    Mutex* head = __atomic_load_n(&pending_unlocks, __ATOMIC_RELAXED);
+    do {
+        mutex->pending_next = head;
+    } while (!__atomic_compare_exchange_n(&pending_unlocks, &head, mutex, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static Mutex* takeUnlocks(void) {
+    return __atomic_exchange_n(&pending_unlocks, NULL, __ATOMIC_ACQUIRE);
+}
+#endif
+
+#ifdef PRIORITY_BASED_SCHEDULING
+// The new owner inherits from whoever is still waiting
+static void inheritFromWaiters(const Mutex* const mutex) {
+    uint8_t priority = SCHEDULER_LOWEST_PRIORITY;
+    for (const ListNode* link = mutex->waiters.head; link != NULL; link = link->next) {
+        if (TASK_OF(link)->priority < priority) {
+            priority = TASK_OF(link)->priority;
+        }
+    }
+    SchedulerInherit(mutex->owner, priority);
+}
+#endif
+
+void MutexInit(Mutex* const mutex, const uint8_t options) {
+    mutex->state = MUTEX_FREE;
+    mutex->options = options;
+    mutex->owner = NULL;
+    ListInit(&mutex->waiters);
+    mutex->pending_next = NULL;
+}
+
+// Leaves `owner` at NULL: an interrupt may call this on top of whichever
+// task it preempted, and that task must not be boosted or restored for it
+uint8_t MutexTryLock(Mutex* const mutex) {
+    uint32_t expected = MUTEX_FREE;
+    return compareExchange(&mutex->state, &expected, MUTEX_LOCKED, __ATOMIC_ACQUIRE);
+}
+
+uint8_t MutexLock(Mutex* const mutex, Task* const task) {
+    if (MutexTryLock(mutex)) {
+        mutex->owner = task;
+        return 1;
+    }
+
+    // Released since the first attempt; it stays marked contended, which
+    // only costs the next unlock a look at the empty wait list
+    if (exchange(&mutex->state, MUTEX_CONTENDED, __ATOMIC_ACQUIRE) == MUTEX_FREE) {
+        mutex->owner = task;
+        return 1;
+    }
+
+    TaskBlock(task, &mutex->waiters);
+#ifdef PRIORITY_BASED_SCHEDULING
+    if ((mutex->options & MUTEX_PRIORITY_INHERITANCE) != 0U) {
+        SchedulerInherit(mutex->owner, task->priority);
+    }
+#endif
+    return 0;
+}
+
+void MutexUnlock(Mutex* const mutex) {
+    Task* const owner = mutex->owner;
+    uint32_t expected = MUTEX_LOCKED;
+    mutex->owner = NULL;
+    if (compareExchange(&mutex->state, &expected, MUTEX_FREE, __ATOMIC_RELEASE)) {
+        return;
+    }
+
+#ifdef PRIORITY_BASED_SCHEDULING
+    if ((mutex->options & MUTEX_PRIORITY_INHERITANCE) != 0U) {
+        SchedulerRestore(owner);
+    }
+#else
+    UNUSED(owner);
+#endif
+
+    Task* const next = TaskWakeOne(&mutex->waiters);
+    if (next == NULL) {
+        __atomic_store_n(&mutex->state, MUTEX_FREE, __ATOMIC_RELEASE);
+        return;
+    }
+
+    // Handed over still locked; contended while others wait behind it
+    mutex->owner = next;
+    if (ListEmpty(&mutex->waiters)) {
+        __atomic_store_n(&mutex->state, MUTEX_LOCKED, __ATOMIC_RELEASE);
+    }
+#ifdef PRIORITY_BASED_SCHEDULING
+    else if ((mutex->options & MUTEX_PRIORITY_INHERITANCE) != 0U) {
+        inheritFromWaiters(mutex);
+    }
+#endif
+}
+
+void MutexUnlockFromIsr(Mutex* const mutex) {
+    uint32_t expected = MUTEX_LOCKED;
+    if (!compareExchange(&mutex->state, &expected, MUTEX_FREE, __ATOMIC_RELEASE)) {
+        pushUnlock(mutex);
+    }
+}
+
+void MutexDispatchPending(void) {
+    if (__atomic_load_n(&pending_unlocks, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+
+    Mutex* mutex = takeUnlocks();
+    while (mutex != NULL) {
+        // Read the link first: once handed over, the mutex may be queued again
+        Mutex* const next = mutex->pending_next;
+        MutexUnlock(mutex);
+        mutex = next;
+    }
+}
+
+/*
+ * Semaphores
+ *
+ * `count` only goes positive while nobody waits: a give with waiters hands
+ * its unit straight to the first one, so takers cannot overtake them.
+ */
+void SemaphoreInit(Semaphore* const semaphore, const int32_t count) {
+    semaphore->count = count;
+    ListInit(&semaphore->waiters);
+}
+
+uint8_t SemaphoreTryTake(Semaphore* const semaphore) {
+    uint32_t* const count = (uint32_t*)&semaphore->count;
+    uint32_t expected = __atomic_load_n(count, __ATOMIC_RELAXED);
+    while ((int32_t)expected > 0) {
+        if (compareExchange(count, &expected, expected - 1U, __ATOMIC_ACQUIRE)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint8_t SemaphoreTake(Semaphore* const semaphore, Task* const task) {
+    if (SemaphoreTryTake(semaphore)) {
+        return 1;
+    }
+    TaskBlock(task, &semaphore->waiters);
+    return 0;
+}
+
+void SemaphoreGive(Semaphore* const semaphore) {
+    if (TaskWakeOne(&semaphore->waiters) == NULL) {
+        fetchAdd((uint32_t*)&semaphore->count, 1U, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+ * Event flags
+ *
+ * Groups set from interrupts are pushed onto a lock-free stack, each at most
+ * once while its `pending` word is set; TaskRunOnce drains it before picking
+ * the next task, so waiters are checked in task context only.
+ */
+static EventFlags* pending_events = NULL;
+
+static inline uint8_t eventsMatch(const uint32_t flags, const uint32_t mask, const uint8_t mode) {
+    if ((mode & EVENT_WAIT_ALL) != 0U) {
+        return (flags & mask) == mask;
+    }
+    return (flags & mask) != 0U;
+}
+
+#if defined(__ARM_ARCH_6M__)
+static void pushPending(EventFlags* const events) {
+    const uint32_t primask = interruptsMask();
+    events->pending_next = pending_events;
+    pending_events = events;
+    interruptsRestore(primask);
+}
+
+static EventFlags* takePending(void) {
+    const uint32_t primask = interruptsMask();
+    EventFlags* const events = pending_events;
+    pending_events = NULL;
+    interruptsRestore(primask);
+    return events;
+}
+#else
+static void pushPending(EventFlags* const events) {
+    EventFlags* head = __atomic_load_n(&pending_events, __ATOMIC_RELAXED);
+    do {
+        events->pending_next = head;
+    } while (!__atomic_compare_exchange_n(&pending_events, &head, events, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static EventFlags* takePending(void) {
+    return __atomic_exchange_n(&pending_events, NULL, __ATOMIC_ACQUIRE);
+}
+#endif
+
+// Readies every waiter the current flags satisfy, in the order they parked
+static uint32_t wakeWaiters(EventFlags* const events) {
+    uint32_t flags = __atomic_load_n(&events->flags, __ATOMIC_ACQUIRE);
+    ListNode* link = events->waiters.head;
+    while (link != NULL) {
+        ListNode* const next = link->next;
+        Task* const waiter = TASK_OF(link);
+        if (!eventsMatch(flags, waiter->events, waiter->event_mode)) {
+            link = next;
+            continue;
+        }
+
+        ListRemove(&events->waiters, link);
+
+        waiter->events &= flags;
+        if ((waiter->event_mode & EVENT_CLEAR_ON_EXIT) != 0U) {
+            flags = fetchAnd(&events->flags, ~waiter->events, __ATOMIC_ACQ_REL) & ~waiter->events;
+        }
+        waiter->state = TASK_STATE_READY;
+        SchedulerReady(waiter);
+        link = next;
+    }
+    return flags;
+}
+
+void EventFlagsInit(EventFlags* const events) {
+    events->flags = 0;
+    events->pending = 0;
+    events->pending_next = NULL;
+    ListInit(&events->waiters);
+}
+
+uint32_t EventFlagsSet(EventFlags* const events, const uint32_t flags) {
+    fetchOr(&events->flags, flags, __ATOMIC_RELEASE);
+    return wakeWaiters(events);
+}
+
+void EventFlagsSetFromIsr(EventFlags* const events, const uint32_t flags) {
+    fetchOr(&events->flags, flags, __ATOMIC_RELEASE);
+    if (exchange(&events->pending, 1U, __ATOMIC_ACQ_REL) == 0U) {
+        pushPending(events);
+    }
+}
+
+uint32_t EventFlagsClear(EventFlags* const events, const uint32_t flags) {
+    return fetchAnd(&events->flags, ~flags, __ATOMIC_ACQ_REL);
+}
+
+uint32_t EventFlagsGet(const EventFlags* const events) {
+    return __atomic_load_n(&events->flags, __ATOMIC_ACQUIRE);
+}
+
+uint8_t EventFlagsWait(EventFlags* const events, Task* const task, const uint32_t mask, const uint8_t mode) {
+    const uint32_t flags = __atomic_load_n(&events->flags, __ATOMIC_ACQUIRE);
+    if (eventsMatch(flags, mask, mode)) {
+        task->events = flags & mask;
+        if ((mode & EVENT_CLEAR_ON_EXIT) != 0U) {
+            fetchAnd(&events->flags, ~task->events, __ATOMIC_ACQ_REL);
+        }
+        return 1;
+    }
+
+    task->events = mask;
+    task->event_mode = mode;
+    TaskBlock(task, &events->waiters);
+    return 0;
+}
+
+void EventFlagsDispatchPending(void) {
+    if (__atomic_load_n(&pending_events, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+
+    EventFlags* events = takePending();
+    while (events != NULL) {
+        // Read the link first: once `pending` drops, an interrupt may requeue it
+        EventFlags* const next = events->pending_next;
+        __atomic_store_n(&events->pending, 0U, __ATOMIC_RELEASE);
+        wakeWaiters(events);
+        events = next;
+    }
+}
+
+/*
+ * Message queues
+ *
+ * `head` and `tail` are free-running counters; slot N lives at N & mask, and
+ * tail - head is the fill level even across wraparound.
+ *
+ * MPSC slots start with a sequence word (Vyukov's bounded queue): it equals
+ * N while slot N & mask is free for message N, N + 1 once message N is
+ * committed, and N + capacity once the consumer has released it, which
+ * makes it free for the message one lap later.
+ */
+static inline uint32_t* sequenceOf(uint8_t* const slot) {
+    return (uint32_t*)(void*)slot;
+}
+
+static inline uint8_t* slotAt(const MessageQueue* const queue, const uint32_t position) {
+    return queue->slots + (size_t)(position & queue->mask) * queue->slot_size;
+}
+
+static inline uint8_t* payloadOf(const MessageQueue* const queue, uint8_t* const slot) {
+    return (queue->mode == MESSAGE_QUEUE_MPSC) ? slot + MESSAGE_QUEUE_HEADER_SIZE : slot;
+}
+
+#if defined(__ARM_ARCH_6M__)
+// No LDREX/STREX: claim MPSC slots with interrupts masked
+static uint8_t* claimSlot(MessageQueue* const queue) {
+    uint8_t* slot = NULL;
+    const uint32_t primask = interruptsMask();
+    const uint32_t position = queue->tail;
+    if (*sequenceOf(slotAt(queue, position)) == position) {
+        slot = slotAt(queue, position);
+        queue->tail = position + 1U;
+    }
+    interruptsRestore(primask);
+    return slot;
+}
+#else
+static uint8_t* claimSlot(MessageQueue* const queue) {
+    uint32_t position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    for (;;) {
+        uint8_t* const slot = slotAt(queue, position);
+        const int32_t lag = (int32_t)(__atomic_load_n(sequenceOf(slot), __ATOMIC_ACQUIRE) - position);
+        if (lag == 0) {
+            // Free for this lap; on failure `position` is reloaded
+            if (__atomic_compare_exchange_n(&queue->tail, &position, position + 1U, 1, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                return slot;
+            }
+        } else if (lag < 0) {
+            // Still holds the message from the previous lap
+            return NULL;
+        } else {
+            // Another producer took it first
+            position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+#endif
+
+uint8_t MessageQueueInit(MessageQueue* const queue, void* const storage, const size_t storage_size,
+                         const uint32_t capacity, const size_t message_size, const uint8_t mode) {
+    if (queue == NULL || storage == NULL || message_size == 0 || capacity == 0 ||
+        (capacity & (capacity - 1U)) != 0 || mode > MESSAGE_QUEUE_MPSC ||
+        storage_size < MESSAGE_QUEUE_STORAGE_SIZE(mode, capacity, message_size) ||
+        ((uintptr_t)storage & 7U) != 0) {
+        return 0;
+    }
+
+    queue->slots = (uint8_t*)storage;
+    queue->slot_size = MESSAGE_QUEUE_SLOT_SIZE(mode, message_size);
+    queue->message_size = message_size;
+    queue->mask = capacity - 1U;
+    queue->mode = mode;
+    queue->head = 0;
+    queue->tail = 0;
+
+    if (mode == MESSAGE_QUEUE_MPSC) {
+        for (uint32_t i = 0; i < capacity; i++) {
+            *sequenceOf(slotAt(queue, i)) = i;
+        }
+    }
+    return 1;
+}
+
+void* MessageQueueReserve(MessageQueue* const queue) {
+    if (queue->mode == MESSAGE_QUEUE_MPSC) {
+        uint8_t* const slot = claimSlot(queue);
+        return (slot != NULL) ? payloadOf(queue, slot) : NULL;
+    }
+
+    const uint32_t tail = queue->tail;
+    if (tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) > queue->mask) {
+        return NULL;
+    }
+    return slotAt(queue, tail);
+}
+
+void MessageQueueCommit(MessageQueue* const queue, void* const message) {
+    if (queue->mode == MESSAGE_QUEUE_MPSC) {
+        // The sequence still holds the position claimed for this slot
+        uint32_t* const sequence = sequenceOf((uint8_t*)message - MESSAGE_QUEUE_HEADER_SIZE);
+        __atomic_store_n(sequence, *sequence + 1U, __ATOMIC_RELEASE);
+        return;
+    }
+
+    UNUSED(message);
+    __atomic_store_n(&queue->tail, queue->tail + 1U, __ATOMIC_RELEASE);
+}
+
+void* MessageQueuePeek(MessageQueue* const queue) {
+    const uint32_t head = queue->head;
+    uint8_t* const slot = slotAt(queue, head);
+
+    if (queue->mode == MESSAGE_QUEUE_MPSC) {
+        if (__atomic_load_n(sequenceOf(slot), __ATOMIC_ACQUIRE) != head + 1U) {
+            return NULL;
+        }
+    } else if (__atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) == head) {
+        return NULL;
+    }
+    return payloadOf(queue, slot);
+}
+
+void MessageQueueRelease(MessageQueue* const queue) {
+    const uint32_t head = queue->head;
+    if (queue->mode == MESSAGE_QUEUE_MPSC) {
+        __atomic_store_n(sequenceOf(slotAt(queue, head)), head + queue->mask + 1U, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&queue->head, head + 1U, __ATOMIC_RELEASE);
+}
+
+uint8_t MessageQueueSend(MessageQueue* const queue, const void* const message) {
+    void* const slot = MessageQueueReserve(queue);
+    if (slot == NULL) {
+        return 0;
+    }
+    memcpy(slot, message, queue->message_size);
+    MessageQueueCommit(queue, slot);
+    return 1;
+}
+
+uint8_t MessageQueueReceive(MessageQueue* const queue, void* const message) {
+    const void* const slot = MessageQueuePeek(queue);
+    if (slot == NULL) {
+        return 0;
+    }
+    memcpy(message, slot, queue->message_size);
+    MessageQueueRelease(queue);
+    return 1;
+}
+
+size_t MessageQueueCount(const MessageQueue* const queue) {
+    const uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    return (size_t)(__atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) - head);
+}
@@ -1,9 +1,269 @@
+#include "bits.h"
+#include "virtualization/cpu/concurrency.h"
+#include "virtualization/cpu/persistance.h"
 #include "virtualization/cpu/scheduling.h"
 
 #ifdef PRIORITY_BASED_SCHEDULING
+/*
+ * Fixed priorities: a FIFO per level, doubly linked so inheritance can move
+ * a queued task, and a bitmap of the non-empty levels. Level 0 is the most
+ * significant bit, so the most urgent level is a single Clz32. Polling tasks
+ * sit at the lowest level whatever their priority.
+ */
 
+#define LEVEL_BIT(priority) (0x80000000U >> (priority))
+
+static List ready_queues[SCHEDULER_PRIORITIES];
+static uint32_t ready_levels = 0;
+
+static void enqueue(Task* const task, const uint8_t level) {
+    ListPushBack(&ready_queues[level], &task->link);
+    ready_levels |= LEVEL_BIT(level);
+}
+
+static void dequeue(Task* const task, const uint8_t level) {
+    ListRemove(&ready_queues[level], &task->link);
+    if (ListEmpty(&ready_queues[level])) {
+        ready_levels &= ~LEVEL_BIT(level);
+    }
+}
+
+// Moves a queued task to its new level; others pick it up on their next enqueue
+static void changePriority(Task* const task, const uint8_t priority) {
+    if (task->priority == priority) {
+        return;
+    }
+    if (task->state == TASK_STATE_READY) {
+        dequeue(task, task->priority);
+        task->priority = priority;
+        enqueue(task, priority);
+    } else {
+        task->priority = priority;
+    }
+}
+
+void SchedulerInit(void) {
+    for (size_t i = 0; i < SCHEDULER_PRIORITIES; i++) {
+        ListInit(&ready_queues[i]);
+    }
+    ready_levels = 0;
+}
+
+void SchedulerReady(Task* const task) {
+    enqueue(task, task->priority);
+}
+
+void SchedulerPoll(Task* const task) {
+    enqueue(task, SCHEDULER_LOWEST_PRIORITY);
+}
+
+Task* SchedulerNext(void) {
+    if (ready_levels == 0U) {
+        return NULL;
+    }
+    const uint8_t level = (uint8_t)Clz32(ready_levels);
+    Task* const task = TASK_OF(ready_queues[level].head);
+    dequeue(task, level);
+    return task;
+}
+
+void SchedulerSetPriority(Task* const task, uint8_t priority) {
+    if (task == NULL) {
+        return;
+    }
+    if (priority > SCHEDULER_LOWEST_PRIORITY) {
+        priority = SCHEDULER_LOWEST_PRIORITY;
+    }
+
+    const uint8_t boosted = (task->priority < task->base_priority) ? task->priority : priority;
+    task->base_priority = priority;
+    changePriority(task, (boosted < priority) ? boosted : priority);
+}
+
+void SchedulerInherit(Task* const owner, const uint8_t priority) {
+    if (owner != NULL && priority < owner->priority) {
+        changePriority(owner, priority);
+    }
+}
+
+void SchedulerRestore(Task* const owner) {
+    if (owner != NULL) {
+        changePriority(owner, owner->base_priority);
+    }
+}
 #endif
 
 #ifdef EARLIEST_DEADLINE_FIRST_SCHEDULING
+/*
+ * Earliest deadline first: a binary min-heap of ready tasks. Every task in
+ * the heap owns a control block from the task table, so TASK_MAX slots are
+ * always enough. Each task records its slot for in-place deadline changes.
+ *
+ * Tasks without a deadline never enter the heap: giving them one far ahead
+ * would not work, as it falls behind the clock after 2^31 ticks and then
+ * compares as the most overdue. They queue round-robin behind the heap,
+ * together with polling tasks.
+ */
+static Task* ready_heap[TASK_MAX];
+static size_t ready_count = 0;
+static List background_queue;
+static uint32_t next_sequence = 0;
+static uint32_t ticks = 0;
+
+// Wrap-safe "a is due before b", falling back to queue order
+static uint8_t dueBefore(const Task* const a, const Task* const b) {
+    if (a->deadline != b->deadline) {
+        return (int32_t)(a->deadline - b->deadline) < 0;
+    }
+    return (int32_t)(a->sequence - b->sequence) < 0;
+}
+
+static void placeAt(Task* const task, const size_t index) {
+    ready_heap[index] = task;
+    task->heap_index = (uint16_t)index;
+}
+
+static void siftUp(size_t index) {
+    Task* const task = ready_heap[index];
+    while (index > 0) {
+        const size_t parent = (index - 1U) / 2U;
+        if (!dueBefore(task, ready_heap[parent])) {
+            break;
+        }
+        placeAt(ready_heap[parent], index);
+        index = parent;
+    }
+    placeAt(task, index);
+}
+
+static void siftDown(size_t index) {
+    Task* const task = ready_heap[index];
+    for (;;) {
+        size_t child = 2U * index + 1U;
+        if (child >= ready_count) {
+            break;
+        }
+        if (child + 1U < ready_count && dueBefore(ready_heap[child + 1U], ready_heap[child])) {
+            child++;
+        }
+        if (!dueBefore(ready_heap[child], task)) {
+            break;
+        }
+        placeAt(ready_heap[child], index);
+        index = child;
+    }
+    placeAt(task, index);
+}
+
+__attribute__((weak)) uint32_t SchedulerClock(void) {
+    return ticks;
+}
 
-#endif
\ No newline at end of file
+void SchedulerTick(void) {
+    ticks++;
+}
+
+void SchedulerInit(void) {
+    ready_count = 0;
+    next_sequence = 0;
+    ListInit(&background_queue);
+}
+
+void SchedulerReady(Task* const task) {
+    if (!task->has_deadline) {
+        ListPushBack(&background_queue, &task->link);
+        return;
+    }
+
+    task->sequence = next_sequence++;
+    ready_heap[ready_count] = task;
+    ready_count++;
+    siftUp(ready_count - 1U);
+}
+
+void SchedulerPoll(Task* const task) {
+    ListPushBack(&background_queue, &task->link);
+}
+
+Task* SchedulerNext(void) {
+    if (ready_count == 0) {
+        ListNode* const link = ListPopFront(&background_queue);
+        return (link != NULL) ? TASK_OF(link) : NULL;
+    }
+
+    Task* const task = ready_heap[0];
+    ready_count--;
+    if (ready_count > 0) {
+        ready_heap[0] = ready_heap[ready_count];
+        siftDown(0);
+    }
+    return task;
+}
+
+Task* SchedulerPeek(void) {
+    if (ready_count == 0) {
+        return (background_queue.head != NULL) ? TASK_OF(background_queue.head) : NULL;
+    }
+    return ready_heap[0];
+}
+
+void SchedulerSetDeadline(Task* const task, const uint32_t deadline) {
+    if (task == NULL) {
+        return;
+    }
+
+    const uint32_t previous = task->deadline;
+    task->deadline = deadline;
+    if (!task->has_deadline) {
+        // Leaves the background queue for the heap
+        task->has_deadline = 1;
+        if (task->state == TASK_STATE_READY) {
+            ListRemove(&background_queue, &task->link);
+            SchedulerReady(task);
+        }
+        return;
+    }
+    if (task->state != TASK_STATE_READY) {
+        return;
+    }
+    if ((int32_t)(deadline - previous) < 0) {
+        siftUp(task->heap_index);
+    } else {
+        siftDown(task->heap_index);
+    }
+}
+
+void SchedulerJobDone(Task* const task, const uint32_t next_deadline) {
+    if (task == NULL) {
+        return;
+    }
+    if (task->has_deadline && (int32_t)(SchedulerClock() - task->deadline) > 0) {
+        task->deadline_misses++;
+    }
+    SchedulerSetDeadline(task, next_deadline);
+}
+#endif
+
+#if !defined(PRIORITY_BASED_SCHEDULING) && !defined(EARLIEST_DEADLINE_FIRST_SCHEDULING)
+/*
+ * Round-robin: a single FIFO linked through Task.link.
+ */
+static List ready_queue;
+
+void SchedulerInit(void) {
+    ListInit(&ready_queue);
+}
+
+void SchedulerReady(Task* const task) {
+    ListPushBack(&ready_queue, &task->link);
+}
+
+void SchedulerPoll(Task* const task) {
+    SchedulerReady(task);
+}
+
+Task* SchedulerNext(void) {
+    ListNode* const link = ListPopFront(&ready_queue);
+    return (link != NULL) ? TASK_OF(link) : NULL;
+}
+#endif
@@ -1 +1,176 @@
-#include "virtualization/cpu/tasks.h"
\ No newline at end of file
+/**
+ * @file tasks.c
+ * @brief Stackless cooperative task runtime.
+ *
+ * Control blocks come from a static table of TASK_MAX entries, so spawning
+ * never touches the heap. Dispatch calls the task function once; what it
+ * returns decides whether the task goes back to the scheduler, stays parked
+ * on a wait list, or releases its control block.
+ */
+#include "virtualization/cpu/tasks.h"
+#include "virtualization/cpu/scheduling.h"
+#include "virtualization/cpu/concurrency.h"
+
+#include "types.h"
+#include <string.h>
+
+static Task tasks[TASK_MAX];
+static Task* current = NULL;
+static size_t live_tasks = 0;
+
+// Takes a free control block without queueing it
+static Task* claimTask(const TaskFunction function, void* const context) {
+    if (function == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < TASK_MAX; i++) {
+        Task* const task = &tasks[i];
+        if (task->state == TASK_STATE_FREE) {
+            task->function = function;
+            task->context = context;
+            task->resume_point = 0;
+            task->state = TASK_STATE_READY;
+            live_tasks++;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+#ifdef PRIORITY_BASED_SCHEDULING
+Task* TaskSpawnPriority(const TaskFunction function, void* const context, uint8_t priority) {
+    Task* const task = claimTask(function, context);
+    if (task != NULL) {
+        if (priority > SCHEDULER_LOWEST_PRIORITY) {
+            priority = SCHEDULER_LOWEST_PRIORITY;
+        }
+        task->priority = priority;
+        task->base_priority = priority;
+        SchedulerReady(task);
+    }
+    return task;
+}
+
+Task* TaskSpawn(const TaskFunction function, void* const context) {
+    return TaskSpawnPriority(function, context, SCHEDULER_LOWEST_PRIORITY);
+}
+#elif defined(EARLIEST_DEADLINE_FIRST_SCHEDULING)
+Task* TaskSpawnDeadline(const TaskFunction function, void* const context, const uint32_t deadline) {
+    Task* const task = claimTask(function, context);
+    if (task != NULL) {
+        task->deadline = deadline;
+        task->deadline_misses = 0;
+        task->has_deadline = 1;
+        SchedulerReady(task);
+    }
+    return task;
+}
+
+Task* TaskSpawn(const TaskFunction function, void* const context) {
+    Task* const task = claimTask(function, context);
+    if (task != NULL) {
+        task->deadline_misses = 0;
+        task->has_deadline = 0;
+        SchedulerReady(task);
+    }
+    return task;
+}
+#else
+Task* TaskSpawn(const TaskFunction function, void* const context) {
+    Task* const task = claimTask(function, context);
+    if (task != NULL) {
+        SchedulerReady(task);
+    }
+    return task;
+}
+#endif
+
+uint8_t TaskRunOnce(void) {
+    MutexDispatchPending();
+    EventFlagsDispatchPending();
+    Task* const task = SchedulerNext();
+    if (task == NULL) {
+        return 0;
+    }
+
+    task->state = TASK_STATE_RUNNING;
+    current = task;
+    const TaskStatus status = task->function(task);
+    current = NULL;
+
+    switch (status) {
+    case TASK_BLOCKED:
+        // TaskBlock already parked it; it may even have been woken since
+        break;
+    case TASK_EXITED:
+        task->state = TASK_STATE_FREE;
+        live_tasks--;
+        break;
+    case TASK_WAITING:
+        task->state = TASK_STATE_WAITING;
+        SchedulerPoll(task);
+        break;
+    default:
+        task->state = TASK_STATE_READY;
+        SchedulerReady(task);
+        break;
+    }
+    return 1;
+}
+
+size_t TaskRun(void) {
+    size_t dispatches = 0;
+    while (TaskRunOnce()) {
+        dispatches++;
+    }
+    return dispatches;
+}
+
+Task* TaskCurrent(void) {
+    return current;
+}
+
+size_t TaskCount(void) {
+    return live_tasks;
+}
+
+void TaskBlock(Task* const task, TaskWaitList* const wait_list) {
+    if (task == NULL || wait_list == NULL) {
+        return;
+    }
+
+    task->state = TASK_STATE_BLOCKED;
+    ListPushBack(wait_list, &task->link);
+}
+
+Task* TaskWakeOne(TaskWaitList* const wait_list) {
+    if (wait_list == NULL) {
+        return NULL;
+    }
+
+    ListNode* const link = ListPopFront(wait_list);
+    if (link == NULL) {
+        return NULL;
+    }
+
+    Task* const task = TASK_OF(link);
+    task->state = TASK_STATE_READY;
+    SchedulerReady(task);
+    return task;
+}
+
+size_t TaskWakeAll(TaskWaitList* const wait_list) {
+    size_t woken = 0;
+    while (TaskWakeOne(wait_list) != NULL) {
+        woken++;
+    }
+    return woken;
+}
+
+void TaskReset(void) {
+    memset(tasks, 0, sizeof(tasks));
+    current = NULL;
+    live_tasks = 0;
+    SchedulerInit();
+}
@@ -1,92 +1,414 @@
+//! Segregated free-list heaps, each over its own region: the default heap is
+//! the one passed to `AllocatorInit`, more can be made with `HeapCreate`.
+//!
+//! Blocks tile the region back to back, each prefixed by a two-word header
+//! holding its physical predecessor and payload size, so both neighbours are
+//! reachable in O(1) and are coalesced on free. Free blocks are kept in
+//! power-of-two size classes with a bitmask of non-empty classes, and
+//! `realloc` grows or shrinks in place whenever the next block allows it.
 const std = @import("std");
 
-// Global state
-var buffer: [1024 * 1024]u8 align(@alignOf(usize)) = undefined; // 1MB buffer
-var fba = std.heap.FixedBufferAllocator.init(&buffer);
-const allocator = fba.allocator();
+/// Payload alignment handed out to C callers (two words, like the C backends)
+const alignment: usize = 2 * @sizeOf(usize);
+const bin_count = @bitSizeOf(usize);
+const BinIndex = std.math.Log2Int(usize);
+const free_bit: usize = 1;
 
-pub fn AllocatorInit(heap_start: *anyopaque, heap_size: usize) callconv(.C) u8 {
-    _ = heap_start;
-    _ = heap_size;
-    return 1;
+const Block = extern struct {
+    prev_phys: ?*Block,
+    size: usize, // Payload bytes, `free_bit` set while free
+    // Only valid while the block is free
+    next_free: ?*Block,
+    prev_free: ?*Block,
+
+    const overhead = @offsetOf(Block, "next_free");
+    const min_size = @sizeOf(Block) - overhead;
+
+    fn payloadSize(self: *const Block) usize {
+        return self.size & ~free_bit;
+    }
+
+    fn isFree(self: *const Block) bool {
+        return (self.size & free_bit) != 0;
+    }
+
+    fn payload(self: *Block) [*]u8 {
+        return @as([*]u8, @ptrCast(self)) + overhead;
+    }
+
+    fn fromPayload(ptr: *anyopaque) *Block {
+        return @ptrFromInt(@intFromPtr(ptr) - overhead);
+    }
+
+    fn nextPhys(self: *Block) *Block {
+        return @ptrCast(@alignCast(self.payload() + self.payloadSize()));
+    }
+};
+
+comptime {
+    std.debug.assert(Block.overhead == alignment);
 }
 
-pub fn AllocatorDeinit() callconv(.C) void {
-    // Reset the allocator
-    fba = std.heap.FixedBufferAllocator.init(&buffer);
+const Heap = struct {
+    bins: [bin_count]?*Block,
+    nonempty_bin_mask: usize,
+    free_blocks: usize,
+    diagnostics: struct {
+        capacity: usize,
+        allocated: usize,
+        peak_allocated: usize,
+        peak_request_size: usize,
+        oom_count: usize,
+    },
+
+    const size_padded = std.mem.alignForward(usize, @sizeOf(Heap), alignment);
+
+    fn binFloor(size: usize) BinIndex {
+        return @intCast(bin_count - 1 - @clz(size / alignment));
+    }
+
+    fn binCeil(size: usize) usize {
+        const units = size / alignment;
+        return if (units <= 1) 0 else bin_count - @as(usize, @clz(units - 1));
+    }
+
+    fn insert(self: *Heap, block: *Block) void {
+        const index = binFloor(block.payloadSize());
+        block.next_free = self.bins[index];
+        block.prev_free = null;
+        if (self.bins[index]) |head| head.prev_free = block;
+        self.bins[index] = block;
+        self.nonempty_bin_mask |= @as(usize, 1) << index;
+        self.free_blocks += 1;
+    }
+
+    fn remove(self: *Heap, block: *Block) void {
+        const index = binFloor(block.payloadSize());
+        if (block.next_free) |next| next.prev_free = block.prev_free;
+        if (block.prev_free) |prev| {
+            prev.next_free = block.next_free;
+        } else {
+            self.bins[index] = block.next_free;
+            if (block.next_free == null) self.nonempty_bin_mask &= ~(@as(usize, 1) << index);
+        }
+        self.free_blocks -= 1;
+    }
+
+    /// Smallest non-empty class whose blocks all fit, falling back to the
+    /// head of the class just below.
+    fn findFit(self: *Heap, size: usize) ?*Block {
+        const optimal = binCeil(size);
+        if (optimal < bin_count) {
+            const shift: BinIndex = @intCast(optimal);
+            const candidates = self.nonempty_bin_mask & ~((@as(usize, 1) << shift) - 1);
+            if (candidates != 0) return self.bins[@ctz(candidates)];
+        }
+        if (optimal > 0) {
+            if (self.bins[optimal - 1]) |head| {
+                if (head.payloadSize() >= size) return head;
+            }
+        }
+        return null;
+    }
+
+    /// Cuts `block` down to `size` bytes if the tail can stand as its own
+    /// block, merging the tail into a free successor.
+    fn split(self: *Heap, block: *Block, size: usize) void {
+        const current = block.payloadSize();
+        if (current < size + Block.overhead + Block.min_size) return;
+
+        const rest: *Block = @ptrCast(@alignCast(block.payload() + size));
+        rest.prev_phys = block;
+        rest.size = (current - size - Block.overhead) | free_bit;
+        block.size = size | (block.size & free_bit);
+
+        var next = rest.nextPhys();
+        if (next.isFree()) {
+            self.remove(next);
+            rest.size += Block.overhead + next.payloadSize();
+            next = rest.nextPhys();
+        }
+        next.prev_phys = rest;
+        self.insert(rest);
+    }
+
+    fn track(self: *Heap, released: usize, acquired: usize) void {
+        self.diagnostics.allocated = self.diagnostics.allocated - released + acquired;
+        if (self.diagnostics.peak_allocated < self.diagnostics.allocated) {
+            self.diagnostics.peak_allocated = self.diagnostics.allocated;
+        }
+    }
+
+    /// Lays a heap out over `region`, or returns null if it is too small.
+    fn create(region: *anyopaque, region_size: usize) ?*Heap {
+        const base = @intFromPtr(region);
+        const start = std.mem.alignForward(usize, base, alignment);
+        const end = std.mem.alignBackward(usize, base +| region_size, alignment);
+        if (end <= start or end - start < size_padded + 2 * Block.overhead + Block.min_size) return null;
+
+        const self: *Heap = @ptrFromInt(start);
+        @memset(std.mem.asBytes(self), 0);
+
+        // One free block spanning the region, followed by a used zero-size sentinel
+        const first: *Block = @ptrFromInt(start + size_padded);
+        first.prev_phys = null;
+        first.size = (end - start - size_padded - 2 * Block.overhead) | free_bit;
+        self.insert(first);
+
+        const sentinel = first.nextPhys();
+        sentinel.prev_phys = first;
+        sentinel.size = 0;
+
+        self.diagnostics.capacity = first.payloadSize();
+        return self;
+    }
+
+    fn alloc(self: *Heap, size: usize) ?*anyopaque {
+        if (size == 0) return null;
+        if (self.diagnostics.peak_request_size < size) self.diagnostics.peak_request_size = size;
+        if (size > self.diagnostics.capacity) {
+            self.diagnostics.oom_count += 1;
+            return null;
+        }
+
+        const wanted = blockSizeFor(size);
+        const block = self.findFit(wanted) orelse {
+            self.diagnostics.oom_count += 1;
+            return null;
+        };
+
+        self.remove(block);
+        self.split(block, wanted);
+        block.size &= ~free_bit;
+        self.track(0, block.payloadSize());
+        return block.payload();
+    }
+
+    fn alignedAlloc(self: *Heap, alignment_wanted: usize, size: usize) ?*anyopaque {
+        if (alignment_wanted == 0 or !std.math.isPowerOfTwo(alignment_wanted)) return null;
+        if (alignment_wanted <= alignment) return self.alloc(size);
+        if (size == 0 or size > self.diagnostics.capacity or alignment_wanted > self.diagnostics.capacity / 2) return null;
+
+        // Leave room to slide the payload forward by a gap that can stand on its
+        // own as a free block
+        const wanted = blockSizeFor(size);
+        const gap_min = Block.overhead + Block.min_size;
+        const raw = self.alloc(wanted + alignment_wanted + gap_min) orelse return null;
+
+        var block = Block.fromPayload(raw);
+        var aligned = std.mem.alignForward(usize, @intFromPtr(raw), alignment_wanted);
+        if (aligned != @intFromPtr(raw)) {
+            if (aligned - @intFromPtr(raw) < gap_min) aligned += alignment_wanted;
+
+            // Split the leading gap off and hand it back
+            const gap = aligned - @intFromPtr(raw);
+            const shifted = Block.fromPayload(@ptrFromInt(aligned));
+            shifted.prev_phys = block;
+            shifted.size = block.payloadSize() - gap;
+            shifted.nextPhys().prev_phys = shifted;
+            block.size = gap - Block.overhead;
+            self.diagnostics.allocated -= Block.overhead;
+            self.release(raw);
+            block = shifted;
+        }
+
+        const before_trim = block.payloadSize();
+        self.split(block, wanted);
+        self.track(before_trim, block.payloadSize());
+        return block.payload();
+    }
+
+    fn calloc(self: *Heap, num: usize, size: usize) ?*anyopaque {
+        // Check for overflow
+        const requested_size = std.math.mul(usize, num, size) catch return null;
+        if (requested_size == 0) return null;
+
+        // Allocate memory
+        const ptr = self.alloc(requested_size) orelse return null;
+
+        // Zero the memory
+        const data = @as([*]u8, @ptrCast(ptr));
+        @memset(data[0..requested_size], 0);
+
+        return ptr;
+    }
+
+    fn resize(self: *Heap, p: *anyopaque, new_size: usize) ?*anyopaque {
+        const block = Block.fromPayload(p);
+        if (block.isFree() or new_size > self.diagnostics.capacity) return null;
+
+        const wanted = blockSizeFor(new_size);
+        const old_size = block.payloadSize();
+
+        // Grow into the next block if it's free and large enough
+        if (wanted > old_size) {
+            const next = block.nextPhys();
+            if (next.isFree() and old_size + Block.overhead + next.payloadSize() >= wanted) {
+                self.remove(next);
+                block.size += Block.overhead + next.payloadSize();
+                block.nextPhys().prev_phys = block;
+            }
+        }
+
+        if (wanted <= block.payloadSize()) {
+            self.split(block, wanted);
+            self.track(old_size, block.payloadSize());
+            return p;
+        }
+
+        // Need to allocate new block
+        const new_ptr = self.alloc(new_size) orelse return null;
+        const new_data = @as([*]u8, @ptrCast(new_ptr));
+        @memcpy(new_data[0..old_size], block.payload()[0..old_size]);
+        self.release(p);
+        return new_ptr;
+    }
+
+    fn release(self: *Heap, ptr: *anyopaque) void {
+        var block = Block.fromPayload(ptr);
+        if (block.isFree()) return;
+
+        self.track(block.payloadSize(), 0);
+        block.size |= free_bit;
+
+        // Merge with the previous block if it's free
+        if (block.prev_phys) |prev| {
+            if (prev.isFree()) {
+                self.remove(prev);
+                prev.size += Block.overhead + block.payloadSize();
+                block = prev;
+            }
+        }
+
+        // Merge with the next block if it's free (the sentinel never is)
+        const next = block.nextPhys();
+        if (next.isFree()) {
+            self.remove(next);
+            block.size += Block.overhead + next.payloadSize();
+        }
+        block.nextPhys().prev_phys = block;
+
+        self.insert(block);
+    }
+};
+
+/// Mirrors `HeapStats` in heap.h
+pub const HeapStats = extern struct {
+    capacity: usize,
+    allocated: usize,
+    free_bytes: usize,
+    peak_allocated: usize,
+    peak_request_size: usize,
+    oom_count: usize,
+    free_fragments: usize,
+    largest_free_block: usize,
+    fragmentation_permille: u32,
+};
+
+// Default heap, set up by `AllocatorInit`; it lives at the start of its region
+var heap: ?*Heap = null;
+
+fn blockSizeFor(size: usize) usize {
+    return @max(std.mem.alignForward(usize, size, alignment), Block.min_size);
 }
 
-pub fn malloc(size: usize) callconv(.C) ?*anyopaque {
-    if (size == 0) return null;
-    
-    // Add size prefix
-    const total_size = size + @sizeOf(usize);
-    const mem = allocator.alloc(u8, total_size) catch return null;
-    
-    // Store size at start
-    const size_ptr = @as(*usize, @ptrCast(@alignCast(mem.ptr)));
-    size_ptr.* = size;
-    
-    // Return pointer after size
-    return @as(*anyopaque, @ptrCast(@alignCast(mem.ptr + @sizeOf(usize))));
+/// C handles are opaque; every heap is a `Heap` at the start of its region.
+fn fromHandle(handle: ?*anyopaque) ?*Heap {
+    return @ptrCast(@alignCast(handle));
 }
 
-pub fn calloc(num: usize, size: usize) callconv(.C) ?*anyopaque {
-    // Check for overflow
-    const requested_size = num *% size;
-    if (size != 0 and requested_size / size != num) return null;
-    if (requested_size == 0) return null;
+pub fn HeapCreate(region: ?*anyopaque, region_size: usize) callconv(.C) ?*anyopaque {
+    return Heap.create(region orelse return null, region_size);
+}
 
-    // Allocate memory
-    const ptr = malloc(requested_size) orelse return null;
-    
-    // Zero the memory
-    const data = @as([*]u8, @ptrCast(ptr));
-    @memset(data[0..requested_size], 0);
-    
-    return ptr;
+pub fn HeapDefault() callconv(.C) ?*anyopaque {
+    return heap;
 }
 
-pub fn realloc(ptr: ?*anyopaque, new_size: usize) callconv(.C) ?*anyopaque {
-    if (ptr == null and new_size > 0) return malloc(new_size);
+pub fn HeapAlloc(handle: ?*anyopaque, size: usize) callconv(.C) ?*anyopaque {
+    const h = fromHandle(handle) orelse return null;
+    return h.alloc(size);
+}
+
+pub fn HeapAlignedAlloc(handle: ?*anyopaque, alignment_wanted: usize, size: usize) callconv(.C) ?*anyopaque {
+    const h = fromHandle(handle) orelse return null;
+    return h.alignedAlloc(alignment_wanted, size);
+}
+
+pub fn HeapRealloc(handle: ?*anyopaque, ptr: ?*anyopaque, new_size: usize) callconv(.C) ?*anyopaque {
+    const p = ptr orelse return HeapAlloc(handle, new_size);
     if (new_size == 0) {
-        if (ptr) |p| free(p);
+        HeapFree(handle, p);
         return null;
     }
+    const h = fromHandle(handle) orelse return null;
+    return h.resize(p, new_size);
+}
 
-    if (ptr) |p| {
-        // Get original size
-        const size_ptr = @as(*usize, @ptrCast(@alignCast(@as([*]u8, @ptrCast(p)) - @sizeOf(usize))));
-        const old_size = size_ptr.*;
+pub fn HeapFree(handle: ?*anyopaque, ptr: ?*anyopaque) callconv(.C) void {
+    const h = fromHandle(handle) orelse return;
+    h.release(ptr orelse return);
+}
 
-        // If sizes match, no need to reallocate
-        if (new_size == old_size) return ptr;
+pub fn HeapGetStats(handle: ?*anyopaque, stats: ?*HeapStats, full_walk: u8) callconv(.C) u8 {
+    const h = fromHandle(handle) orelse return 0;
+    const out = stats orelse return 0;
 
-        // Allocate new memory
-        const new_ptr = malloc(new_size) orelse return null;
-        
-        // Copy data
-        const copy_size = @min(old_size, new_size);
-        const old_data = @as([*]u8, @ptrCast(p));
-        const new_data = @as([*]u8, @ptrCast(new_ptr));
-        @memcpy(new_data[0..copy_size], old_data[0..copy_size]);
-        
-        // Free old memory
-        free(p);
-        
-        return new_ptr;
+    // Size classes are ordered, so only the top non-empty one can hold the
+    // largest block
+    var largest: usize = 0;
+    if (h.nonempty_bin_mask != 0) {
+        const top = h.bins[bin_count - 1 - @clz(h.nonempty_bin_mask)].?;
+        largest = top.payloadSize();
+        if (full_walk != 0) {
+            var it = top.next_free;
+            while (it) |block| : (it = block.next_free) largest = @max(largest, block.payloadSize());
+        }
     }
-    return null;
+
+    const free_bytes = h.diagnostics.capacity - h.diagnostics.allocated;
+    out.* = .{
+        .capacity = h.diagnostics.capacity,
+        .allocated = h.diagnostics.allocated,
+        .free_bytes = free_bytes,
+        .peak_allocated = h.diagnostics.peak_allocated,
+        .peak_request_size = h.diagnostics.peak_request_size,
+        .oom_count = h.diagnostics.oom_count,
+        .free_fragments = h.free_blocks,
+        .largest_free_block = largest,
+        .fragmentation_permille = if (free_bytes == 0) 0 else @intCast(1000 - (@as(u64, largest) * 1000) / free_bytes),
+    };
+    return 1;
+}
+
+pub fn AllocatorInit(heap_start: ?*anyopaque, heap_size: usize) callconv(.C) u8 {
+    heap = Heap.create(heap_start orelse return 0, heap_size) orelse return 0;
+    return 1;
+}
+
+pub fn AllocatorDeinit() callconv(.C) void {
+    heap = null;
+}
+
+pub fn malloc(size: usize) callconv(.C) ?*anyopaque {
+    const h = heap orelse return null;
+    return h.alloc(size);
+}
+
+pub fn aligned_alloc(alignment_wanted: usize, size: usize) callconv(.C) ?*anyopaque {
+    const h = heap orelse return null;
+    return h.alignedAlloc(alignment_wanted, size);
+}
+
+pub fn calloc(num: usize, size: usize) callconv(.C) ?*anyopaque {
+    const h = heap orelse return null;
+    return h.calloc(num, size);
+}
+
+pub fn realloc(ptr: ?*anyopaque, new_size: usize) callconv(.C) ?*anyopaque {
+    return HeapRealloc(heap, ptr, new_size);
 }
 
 pub fn free(ptr: ?*anyopaque) callconv(.C) void {
-    if (ptr == null) return;
-    
-    // Get original size
-    const size_ptr = @as(*usize, @ptrCast(@alignCast(@as([*]u8, @ptrCast(ptr.?)) - @sizeOf(usize))));
-    const size = size_ptr.*;
-    
-    // Free entire allocation including size prefix
-    const full_ptr = @as([*]u8, @ptrCast(size_ptr));
-    allocator.free(full_ptr[0..(size + @sizeOf(usize))]);
+    HeapFree(heap, ptr);
 }
@@ -0,0 +1,158 @@
+/**
+ * @file arena.c
+ * @brief Linear (bump) arena allocator.
+ *
+ * Layout of an arena inside its buffer:
+ *
+ *   [Arena][padding][storage ... offset ... capacity]
+ *
+ * Allocation rounds the request up to ARENA_ALIGNMENT and bumps `offset`, so
+ * `offset` stays aligned and the common path needs no alignment fix-up.
+ */
+#include "virtualization/memory/arena.h"
+#include "virtualization/memory/heap.h"
+
+#include "types.h"
+#include <stdint.h>
+
+#define CONTROL_SIZE_PADDED ((sizeof(Arena) + ARENA_ALIGNMENT - 1U) & ~(ARENA_ALIGNMENT - 1U))
+
+static inline size_t roundUpToAlignment(const size_t x) {
+    return (x + ARENA_ALIGNMENT - 1U) & ~(ARENA_ALIGNMENT - 1U);
+}
+
+static inline void* bump(Arena* const arena, const size_t start, const size_t size) {
+    // Compare against what is left so neither side can overflow
+    if (start > arena->capacity || size > arena->capacity - start) {
+        return NULL;
+    }
+
+    arena->offset = roundUpToAlignment(start + size);
+    if (arena->offset > arena->capacity) {
+        arena->offset = arena->capacity;
+    }
+    if (arena->peak < arena->offset) {
+        arena->peak = arena->offset;
+    }
+    return arena->storage + start;
+}
+
+Arena* ArenaInit(void* const buffer, const size_t buffer_size) {
+    if (buffer == NULL) {
+        return NULL;
+    }
+
+    // Align the start of the buffer up rather than rejecting it
+    const size_t padding = (size_t)(-(uintptr_t)buffer) & (ARENA_ALIGNMENT - 1U);
+    if (buffer_size <= padding + CONTROL_SIZE_PADDED) {
+        return NULL;
+    }
+
+    Arena* const arena = (Arena*)(void*)(((uint8_t*)buffer) + padding);
+    arena->storage = ((uint8_t*)arena) + CONTROL_SIZE_PADDED;
+    arena->capacity = buffer_size - padding - CONTROL_SIZE_PADDED;
+    arena->offset = 0;
+    arena->peak = 0;
+    arena->heap_block = NULL;
+    return arena;
+}
+
+void* ArenaAlloc(Arena* const arena, const size_t size) {
+    if (arena == NULL || size == 0) {
+        return NULL;
+    }
+
+    return bump(arena, arena->offset, size);
+}
+
+void* ArenaAllocArray(Arena* const arena, const size_t count, const size_t size) {
+    size_t total_size;
+    if (__builtin_mul_overflow(count, size, &total_size)) {
+        return NULL;
+    }
+
+    return ArenaAlloc(arena, total_size);
+}
+
+void* ArenaAlignedAlloc(Arena* const arena, const size_t alignment, const size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1U)) != 0) {
+        return NULL;
+    }
+
+    if (alignment <= ARENA_ALIGNMENT) {
+        return ArenaAlloc(arena, size);
+    }
+
+    if (arena == NULL || size == 0) {
+        return NULL;
+    }
+
+    // Skip ahead to the next aligned address; the gap is simply lost until
+    // the arena is rewound past it
+    const uintptr_t current = (uintptr_t)(arena->storage + arena->offset);
+    const size_t gap = (size_t)(-current) & (alignment - 1U);
+    if (gap > arena->capacity - arena->offset) {
+        return NULL;
+    }
+
+    return bump(arena, arena->offset + gap, size);
+}
+
+ArenaMark ArenaGetMark(const Arena* const arena) {
+    return (arena != NULL) ? arena->offset : 0U;
+}
+
+void ArenaRewind(Arena* const arena, const ArenaMark mark) {
+    if (arena == NULL || mark > arena->offset) {
+        return;
+    }
+
+    arena->offset = mark;
+}
+
+void ArenaReset(Arena* const arena) {
+    if (arena == NULL) {
+        return;
+    }
+
+    arena->offset = 0;
+}
+
+size_t ArenaRemaining(const Arena* const arena) {
+    return (arena != NULL) ? arena->capacity - arena->offset : 0U;
+}
+
+#ifndef NO_ALLOCATOR
+Arena* ArenaCreate(const size_t capacity) {
+    if (capacity == 0 || capacity > (SIZE_MAX / 2U)) {
+        return NULL;
+    }
+
+    size_t storage_size;
+    if (__builtin_add_overflow(roundUpToAlignment(capacity), CONTROL_SIZE_PADDED + ARENA_ALIGNMENT, &storage_size)) {
+        return NULL;
+    }
+
+    void* const buffer = malloc(storage_size);
+    if (buffer == NULL) {
+        return NULL;
+    }
+
+    Arena* const arena = ArenaInit(buffer, storage_size);
+    if (arena == NULL) {
+        free(buffer);
+        return NULL;
+    }
+
+    arena->heap_block = buffer;
+    return arena;
+}
+
+void ArenaDestroy(Arena* const arena) {
+    if (arena == NULL || arena->heap_block == NULL) {
+        return;
+    }
+
+    free(arena->heap_block);
+}
+#endif
@@ -0,0 +1,204 @@
+/**
+ * @file heap.c
+ * @brief Allocator-independent parts of the heap API.
+ *
+ * Everything here is written on top of the entry points each backend
+ * exports, so it is shared by the list, TLSF and Zig allocators. The clang
+ * allocator gets these from the C library instead.
+ *
+ * With HEAP_TRACE defined this also holds the allocation trace ring buffer.
+ */
+#if defined(HEAP_TRACE) && (defined(__unix__) || defined(__APPLE__)) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#include "virtualization/memory/heap.h"
+
+#if !defined(USE_CLANG_ALLOCATOR) && !defined(NO_ALLOCATOR)
+
+#include "types.h"
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(HEAP_TRACE) && (defined(__unix__) || defined(__APPLE__))
+// Raw file I/O: stdio would allocate from the very heap being traced
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+void* HeapCalloc(Heap* const heap, const size_t num_elements, const size_t element_size) {
+    size_t total_size;
+    if (__builtin_mul_overflow(num_elements, element_size, &total_size)) {
+        return NULL;
+    }
+
+    void* const ptr = HeapAlloc(heap, total_size);
+    if (ptr != NULL) {
+        memset(ptr, 0, total_size);
+    }
+    return ptr;
+}
+
+uint8_t AllocatorGetStats(HeapStats* const stats, const uint8_t full_walk) {
+    return HeapGetStats(HeapDefault(), stats, full_walk);
+}
+
+int posix_memalign(void** const memory_ptr, const size_t alignment, const size_t size) {
+    if (memory_ptr == NULL || alignment < sizeof(void*) || (alignment & (alignment - 1U)) != 0) {
+        return EINVAL;
+    }
+
+    if (size == 0) {
+        *memory_ptr = NULL;
+        return 0;
+    }
+
+    void* const ptr = aligned_alloc(alignment, size);
+    if (ptr == NULL) {
+        return ENOMEM;
+    }
+
+    *memory_ptr = ptr;
+    return 0;
+}
+
+#ifdef HEAP_TRACE
+/*
+ * The trace is a ring of the last HEAP_TRACE_CAPACITY events. `trace_count`
+ * only grows, so event N lives in slot N % HEAP_TRACE_CAPACITY.
+ */
+#define TRACE_RECORD_SIZE 40U
+
+static HeapTraceEvent trace_events[HEAP_TRACE_CAPACITY];
+static uint32_t trace_count = 0;
+
+__attribute__((weak)) uint32_t HeapTraceClock(void) {
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) || defined(__ARM_ARCH_8M_MAIN__)
+    // DWT cycle counter, switched on the first time it is needed
+    volatile uint32_t* const demcr = (volatile uint32_t*)0xE000EDFCU;
+    volatile uint32_t* const dwt_ctrl = (volatile uint32_t*)0xE0001000U;
+    volatile uint32_t* const dwt_cyccnt = (volatile uint32_t*)0xE0001004U;
+    if ((*dwt_ctrl & 1U) == 0U) {
+        *demcr |= 1U << 24U;
+        *dwt_ctrl |= 1U;
+    }
+    return *dwt_cyccnt;
+#elif defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return (uint32_t)ticks;
+#else
+    // No cycle counter (e.g. Cortex-M0): fall back to the event order
+    return trace_count;
+#endif
+}
+
+void HeapTraceRecord(const uint32_t op, void* const address, void* const previous, const size_t size,
+                     void* const call_site) {
+    if (op == HEAP_TRACE_FREE && address == NULL) {
+        return;
+    }
+
+#ifdef HEAP_THREAD_SAFE
+    const uint32_t index = __atomic_fetch_add(&trace_count, 1U, __ATOMIC_RELAXED);
+#else
+    const uint32_t index = trace_count++;
+#endif
+
+    HeapTraceEvent* const event = &trace_events[index % HEAP_TRACE_CAPACITY];
+    event->address = address;
+    event->previous = previous;
+    event->call_site = call_site;
+    event->size = (size > UINT32_MAX) ? UINT32_MAX : (uint32_t)size;
+    event->timestamp = HeapTraceClock();
+    event->op = (uint8_t)op;
+}
+
+/**
+ * @brief Number of events still held and the number of the oldest one.
+ */
+static uint32_t heldEvents(uint32_t* const first) {
+    const uint32_t count = trace_count;
+    const uint32_t held = (count < HEAP_TRACE_CAPACITY) ? count : HEAP_TRACE_CAPACITY;
+    *first = count - held;
+    return held;
+}
+
+size_t HeapTraceSnapshot(HeapTraceEvent* const events, const size_t max_events) {
+    if (events == NULL) {
+        return 0;
+    }
+
+    uint32_t first;
+    const uint32_t held = heldEvents(&first);
+    const size_t copied = (held < max_events) ? held : max_events;
+    for (size_t i = 0; i < copied; i++) {
+        events[i] = trace_events[(first + i) % HEAP_TRACE_CAPACITY];
+    }
+    return copied;
+}
+
+uint32_t HeapTraceCount(void) {
+    return trace_count;
+}
+
+void HeapTraceClear(void) {
+    trace_count = 0;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+static uint8_t writeAll(const int fd, const void* const data, const size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    size_t left = size;
+    while (left > 0) {
+        const ssize_t written = write(fd, bytes, left);
+        if (written <= 0) {
+            return 0;
+        }
+        bytes += written;
+        left -= (size_t)written;
+    }
+    return 1;
+}
+
+uint8_t HeapTraceDump(const char* const path) {
+    if (path == NULL) {
+        return 0;
+    }
+
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+
+    uint32_t first;
+    const uint32_t held = heldEvents(&first);
+    const uint32_t header[3] = {1U, TRACE_RECORD_SIZE, held};
+    uint8_t ok = writeAll(fd, "HTRC", 4U) && writeAll(fd, header, sizeof(header));
+
+    for (uint32_t i = 0; ok && i < held; i++) {
+        const HeapTraceEvent* const event = &trace_events[(first + i) % HEAP_TRACE_CAPACITY];
+        uint32_t record[TRACE_RECORD_SIZE / sizeof(uint32_t)];
+        const uint64_t wide[4] = {
+            event->size,
+            (uint64_t)(uintptr_t)event->address,
+            (uint64_t)(uintptr_t)event->previous,
+            (uint64_t)(uintptr_t)event->call_site,
+        };
+        record[0] = event->op;
+        record[1] = event->timestamp;
+        memcpy(&record[2], wide, sizeof(wide));
+        ok = writeAll(fd, record, sizeof(record));
+    }
+
+    if (close(fd) != 0) {
+        ok = 0;
+    }
+    return ok;
+}
+#endif
+#endif
+
+#endif
@@ -10,48 +10,87 @@
  * - Good cache locality
  *
  * @note Configuration:
- * - O1HEAP_ALIGNMENT: Memory alignment (16 bytes)
- * - FRAGMENT_SIZE_MIN: Minimum fragment size (32 bytes)
+ * - O1HEAP_ALIGNMENT: Memory alignment (4 pointers: 16 bytes on 32-bit, 32 on 64-bit)
+ * - FRAGMENT_SIZE_MIN: Minimum fragment size (2 * O1HEAP_ALIGNMENT)
  * - FRAGMENT_SIZE_MAX: Maximum fragment size (2^31 bytes)
  * - NUM_BINS_MAX: Maximum number of bins (32)
+ * - HEAP_THREAD_SAFE: Lock each heap and add per-thread fragment caches for the
+ *   default heap (host only)
+ * - HEAP_DEBUG: Tag headers, add a canary after each block, poison freed
+ *   memory and report double/invalid frees through HeapFault
+ *
+ * Every heap is self-contained: its O1HeapInstance sits at the start of its
+ * own region, so any number of them can coexist. `malloc` and friends operate
+ * on the default heap set up by `AllocatorInit`.
  */
+#if defined(HEAP_THREAD_SAFE) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include "virtualization/memory/heap.h"
 
 #ifdef USE_LIST_ALLOCATOR
-/*
-* Slower than clang and zig allocator, so discontinued until I can beat it
-*/
-
 
+#include "bits.h"
 #include "types.h"
+#include "std/list.h"
 #include <string.h>
 #include <limits.h>
 #include <stdint.h>
 
-#define O1HEAP_ALIGNMENT 16
+#ifdef HEAP_THREAD_SAFE
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "HEAP_THREAD_SAFE needs pthreads and is only supported on the testing (host) target"
+#endif
+#include <pthread.h>
+#endif
+
+// The fragment header lives in the first O1HEAP_ALIGNMENT bytes of every block,
+// so the alignment has to cover next/prev/size/used on the target.
+#define O1HEAP_ALIGNMENT (sizeof(void*) * 4U)
 #define FRAGMENT_SIZE_MIN (O1HEAP_ALIGNMENT * 2U)
 #define FRAGMENT_SIZE_MAX ((SIZE_MAX >> 1U) + 1U)
 #define NUM_BINS_MAX (sizeof(size_t) * CHAR_BIT)
 #define INSTANCE_SIZE_PADDED ((sizeof(O1HeapInstance) + O1HEAP_ALIGNMENT - 1U) & ~(O1HEAP_ALIGNMENT - 1U))
 
-typedef struct Fragment Fragment;
-
 typedef struct FragmentHeader {
-    Fragment* next;
-    Fragment* prev;
-    size_t    size;
+    ListNode link; // Neighbours in address order
+    size_t   size;
     int      used;
 } FragmentHeader;
 
-struct Fragment {
+typedef struct Fragment {
     FragmentHeader header;
-    Fragment* next_free;
-    Fragment* prev_free;
-};
+    ListNode       free_link; // Place in a bin or thread cache; free space only
+} Fragment;
+
+_Static_assert(sizeof(FragmentHeader) <= O1HEAP_ALIGNMENT, "Fragment header must fit in the alignment padding");
 
-typedef struct O1HeapInstance {
-    Fragment* bins[NUM_BINS_MAX];
+/*
+ * `used` doubles as a header tag in debug builds: anything other than the
+ * known values means the header was overwritten. The guard starts right after
+ * the requested bytes: every byte up to the end of the fragment is filled with
+ * GUARD_BYTE, except the last word, which records how many guard bytes precede
+ * it. At least GUARD_SIZE bytes are reserved on top of the request for this.
+ */
+#ifdef HEAP_DEBUG
+#define FRAGMENT_FREE 0x0F4EEB1C
+#define FRAGMENT_USED 0x05EDB10C
+#define FRAGMENT_CACHED 0x0CAC4ED0 // Used, parked in a thread cache
+#define GUARD_SIZE (2U * sizeof(uint32_t))
+#define GUARD_VALUE 0xFEEDFACEU // Mixed into the guard length word
+#define GUARD_BYTE 0xFDU
+#else
+#define FRAGMENT_FREE 0
+#define FRAGMENT_USED 1
+#define GUARD_SIZE 0U
+#endif
+
+typedef struct Heap O1HeapInstance;
+
+struct Heap {
+    List      bins[NUM_BINS_MAX];
     size_t    nonempty_bin_mask;
+    size_t    free_fragments;
     struct {
         size_t capacity;
         size_t allocated;
@@ -59,30 +98,16 @@ typedef struct O1HeapInstance {
         size_t peak_request_size;
         size_t oom_count;
     } diagnostics;
-} O1HeapInstance;
+#ifdef HEAP_THREAD_SAFE
+    pthread_mutex_t lock;
+#endif
+};
 
 // Global variables
-static O1HeapInstance* heap = NULL;
-static void* heap_start = NULL;
-static size_t heap_size = 0;
-
-static inline uint_fast8_t clz(const size_t x) {
-    size_t t = ((size_t)1U) << ((sizeof(size_t) * CHAR_BIT) - 1U);
-    uint_fast8_t r = 0;
-    while ((x & t) == 0) {
-        t >>= 1U;
-        r++;
-    }
-    return r;
-}
-
-static inline uint_fast8_t log2Floor(const size_t x) {
-    return (uint_fast8_t)(((sizeof(size_t) * CHAR_BIT) - 1U) - clz(x));
-}
-
-static inline uint_fast8_t log2Ceil(const size_t x) {
-    return (x <= 1U) ? 0U : (uint_fast8_t)((sizeof(x) * CHAR_BIT) - clz(x - 1U));
-}
+static O1HeapInstance* heap = NULL; // Default heap, set up by AllocatorInit
+#ifdef HEAP_THREAD_SAFE
+static size_t heap_generation = 0; // Bumped by AllocatorInit to invalidate thread caches
+#endif
 
 static inline size_t pow2(const uint_fast8_t power) {
     return ((size_t)1U) << power;
@@ -94,63 +119,104 @@ static inline size_t roundUpToAlignment(size_t x, size_t alignment) {
 
 static inline size_t roundUpToPowerOf2(const size_t x) {
     if (x <= FRAGMENT_SIZE_MIN) return FRAGMENT_SIZE_MIN;
-    return pow2(log2Ceil(x));
+    return pow2(Log2Ceil(x));
 }
 
-static inline void interlink(Fragment* const left, Fragment* const right) {
-    if (left != NULL) {
-        left->header.next = right;
-    }
-    if (right != NULL) {
-        right->header.prev = left;
-    }
+/**
+ * @brief The fragment at the lowest address; it never moves or merges away.
+ */
+static inline Fragment* firstFragment(const O1HeapInstance* const handle) {
+    // Placed so user pointers land on FRAGMENT_SIZE_MIN boundaries; fragment
+    // sizes are multiples of it, so every block inherits that alignment and
+    // aligned_alloc can split off any leading gap
+    const uintptr_t first_user = (uintptr_t)handle + INSTANCE_SIZE_PADDED + O1HEAP_ALIGNMENT;
+    return (Fragment*)(void*)(((char*)handle) + INSTANCE_SIZE_PADDED +
+                              ((size_t)(-first_user) & (FRAGMENT_SIZE_MIN - 1U)));
+}
+
+static inline Fragment* fragmentOf(const ListNode* const link) {
+    return (link != NULL) ? LIST_ENTRY(link, Fragment, header.link) : NULL;
+}
+
+static inline Fragment* nextFragment(const Fragment* const frag) {
+    return fragmentOf(frag->header.link.next);
+}
+
+static inline Fragment* prevFragment(const Fragment* const frag) {
+    return fragmentOf(frag->header.link.prev);
+}
+
+// The free fragment a bin or thread cache node belongs to
+static inline Fragment* freeFragmentOf(const ListNode* const free_link) {
+    return LIST_ENTRY(free_link, Fragment, free_link);
 }
 
 static void rebin(O1HeapInstance* const handle, Fragment* const fragment) {
-    const uint_fast8_t bin_index = log2Floor(fragment->header.size / FRAGMENT_SIZE_MIN);
+    const uint_fast8_t bin_index = Log2Floor(fragment->header.size / FRAGMENT_SIZE_MIN);
     if (bin_index >= NUM_BINS_MAX) {
         return;
     }
 
-    // Add to free list
-    fragment->next_free = handle->bins[bin_index];
-    fragment->prev_free = NULL;
-    if (handle->bins[bin_index] != NULL) {
-        handle->bins[bin_index]->prev_free = fragment;
-    }
-    handle->bins[bin_index] = fragment;
+    ListPushFront(&handle->bins[bin_index], &fragment->free_link);
     handle->nonempty_bin_mask |= ((size_t)1U) << bin_index;
+    handle->free_fragments++;
 }
 
-static void unbin(O1HeapInstance* const handle, const Fragment* const fragment) {
-    const uint_fast8_t idx = log2Floor(fragment->header.size / FRAGMENT_SIZE_MIN);
-    if (fragment->next_free != NULL) {
-        fragment->next_free->prev_free = fragment->prev_free;
+static void unbin(O1HeapInstance* const handle, Fragment* const fragment) {
+    const uint_fast8_t idx = Log2Floor(fragment->header.size / FRAGMENT_SIZE_MIN);
+    ListRemove(&handle->bins[idx], &fragment->free_link);
+    if (ListEmpty(&handle->bins[idx])) {
+        handle->nonempty_bin_mask &= ~pow2(idx);
     }
-    if (fragment->prev_free != NULL) {
-        fragment->prev_free->next_free = fragment->next_free;
+    handle->free_fragments--;
+}
+
+/**
+ * @brief Shrinks a fragment to `size` bytes, releasing the tail as a free
+ * fragment (merged with a free successor) if it is large enough.
+ */
+static void splitTail(O1HeapInstance* const handle, Fragment* const fragment, const size_t size) {
+    const size_t leftover = fragment->header.size - size;
+    if (leftover < FRAGMENT_SIZE_MIN) {
+        return;
     }
-    if (handle->bins[idx] == fragment) {
-        handle->bins[idx] = fragment->next_free;
-        if (handle->bins[idx] == NULL) {
-            handle->nonempty_bin_mask &= ~pow2(idx);
-        }
+
+    Fragment* const tail = (Fragment*)(void*)(((char*)fragment) + size);
+    tail->header.size = leftover;
+    tail->header.used = FRAGMENT_FREE;
+    ListLinkAfter(&fragment->header.link, &tail->header.link);
+    fragment->header.size = size;
+
+    Fragment* const next = nextFragment(tail);
+    if (next != NULL && next->header.used == FRAGMENT_FREE) {
+        unbin(handle, next);
+        tail->header.size += next->header.size;
+        ListUnlink(&next->header.link);
     }
+    rebin(handle, tail);
 }
 
-uint8_t AllocatorInit(void* const base, const size_t size) {
-    if (base == NULL || (((size_t)base) % O1HEAP_ALIGNMENT) != 0 || 
-        size < (INSTANCE_SIZE_PADDED + FRAGMENT_SIZE_MIN)) {
-        return 0;
+Heap* HeapCreate(void* const region, const size_t region_size) {
+    if (region == NULL) {
+        return NULL;
+    }
+
+    // Align the start of the region up rather than rejecting it
+    const size_t padding = (size_t)(-(uintptr_t)region) & (O1HEAP_ALIGNMENT - 1U);
+    if (region_size < padding + INSTANCE_SIZE_PADDED + O1HEAP_ALIGNMENT + FRAGMENT_SIZE_MIN) {
+        return NULL;
     }
+    void* const base = ((char*)region) + padding;
+    const size_t size = region_size - padding;
+
+    O1HeapInstance* const handle = (O1HeapInstance*)base;
+    memset(handle, 0, sizeof(O1HeapInstance));  // Zero out the heap instance
+
+    Fragment* const frag = firstFragment(handle);
+    const size_t fragment_offset = (size_t)((char*)frag - (char*)base);
 
-    heap_start = base;
-    heap_size = size;
-    heap = (O1HeapInstance*)base;
-    memset(heap, 0, sizeof(O1HeapInstance));  // Zero out the heap instance
-    
     // Calculate usable capacity
-    size_t capacity = size - INSTANCE_SIZE_PADDED;
+    size_t capacity = size - fragment_offset;
     if (capacity > FRAGMENT_SIZE_MAX) {
         capacity = FRAGMENT_SIZE_MAX;
     }
@@ -158,140 +224,526 @@ uint8_t AllocatorInit(void* const base, const size_t size) {
     capacity = (capacity / FRAGMENT_SIZE_MIN) * FRAGMENT_SIZE_MIN;
 
     // Initialize the first fragment
-    Fragment* const frag = (Fragment*)(void*)(((char*)base) + INSTANCE_SIZE_PADDED);
-    frag->header.next = NULL;
-    frag->header.prev = NULL;
+    frag->header.link.next = NULL;
+    frag->header.link.prev = NULL;
     frag->header.size = capacity;
-    frag->header.used = 0;
-    frag->next_free = NULL;
-    frag->prev_free = NULL;
-    
+    frag->header.used = FRAGMENT_FREE;
+
     // Add to appropriate bin
-    rebin(heap, frag);
+    rebin(handle, frag);
 
     // Initialize diagnostics
-    heap->diagnostics.capacity = capacity;
-    heap->diagnostics.allocated = 0;
-    heap->diagnostics.peak_allocated = 0;
-    heap->diagnostics.peak_request_size = 0;
-    heap->diagnostics.oom_count = 0;
+    handle->diagnostics.capacity = capacity;
+    handle->diagnostics.allocated = 0;
+    handle->diagnostics.peak_allocated = 0;
+    handle->diagnostics.peak_request_size = 0;
+    handle->diagnostics.oom_count = 0;
+
+#ifdef HEAP_THREAD_SAFE
+    pthread_mutex_init(&handle->lock, NULL);
+#endif
+    return handle;
+}
+
+// Called for every request, including ones a thread cache serves without
+// taking the heap lock
+static void recordRequest(O1HeapInstance* const handle, const size_t amount) {
+#ifdef HEAP_THREAD_SAFE
+    size_t peak = __atomic_load_n(&handle->diagnostics.peak_request_size, __ATOMIC_RELAXED);
+    while (peak < amount && !__atomic_compare_exchange_n(&handle->diagnostics.peak_request_size, &peak, amount, 1,
+                                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+#else
+    if (handle->diagnostics.peak_request_size < amount) {
+        handle->diagnostics.peak_request_size = amount;
+    }
+#endif
+}
+
+static void recordOOM(O1HeapInstance* const handle) {
+    handle->diagnostics.oom_count++;
+}
+
+/**
+ * @brief Takes a fragment of at least `fragment_size` bytes out of the bins.
+ *
+ * @param amount The caller's request for diagnostics, or 0 for speculative
+ * allocations that should not count as OOM.
+ */
+static Fragment* allocateFragment(O1HeapInstance* const handle, const size_t fragment_size, const size_t amount) {
+    // Segregated fit: every fragment in bin N is at least FRAGMENT_SIZE_MIN * 2^N
+    // bytes, so the smallest non-empty bin at or above Log2Ceil(request) is
+    // guaranteed to fit and is found with a single mask operation.
+    const uint_fast8_t optimal_bin_index = Log2Ceil(fragment_size / FRAGMENT_SIZE_MIN);
+    const size_t candidate_bin_mask = ~(pow2(optimal_bin_index) - 1U);
+    const size_t suitable_bins = handle->nonempty_bin_mask & candidate_bin_mask;
+
+    Fragment* best_fit = NULL;
+    if (suitable_bins != 0) {
+        best_fit = freeFragmentOf(handle->bins[CtzSize(suitable_bins)].head);
+    } else if (optimal_bin_index > 0) {
+        // Nothing is guaranteed to fit; the head of the bin just below may still
+        // be large enough. Checking one fragment keeps the bound constant.
+        const ListNode* const candidate = handle->bins[optimal_bin_index - 1U].head;
+        if (candidate != NULL && freeFragmentOf(candidate)->header.size >= fragment_size) {
+            best_fit = freeFragmentOf(candidate);
+        }
+    }
+
+    if (best_fit == NULL) {
+        if (amount != 0) {
+            recordOOM(handle);
+        }
+        return NULL;
+    }
+
+    // Remove from free list
+    unbin(handle, best_fit);
+
+    splitTail(handle, best_fit, fragment_size);
+
+    handle->diagnostics.allocated += best_fit->header.size;
+    if (handle->diagnostics.peak_allocated < handle->diagnostics.allocated) {
+        handle->diagnostics.peak_allocated = handle->diagnostics.allocated;
+    }
+
+    best_fit->header.used = FRAGMENT_USED;
+    return best_fit;
+}
+
+/**
+ * @brief Returns a used fragment to the bins, coalescing with free neighbours.
+ */
+static void releaseFragment(O1HeapInstance* const handle, Fragment* frag) {
+    handle->diagnostics.allocated -= frag->header.size;
+    frag->header.used = FRAGMENT_FREE;
+
+    // Try to merge with next block if it's free
+    Fragment* const next = nextFragment(frag);
+    if (next != NULL && next->header.used == FRAGMENT_FREE) {
+        // Remove next from free list
+        unbin(handle, next);
+
+        // Merge blocks
+        frag->header.size += next->header.size;
+        ListUnlink(&next->header.link);
+    }
+
+    // Try to merge with previous block if it's free
+    Fragment* const prev = prevFragment(frag);
+    if (prev != NULL && prev->header.used == FRAGMENT_FREE) {
+        // Remove prev from free list
+        unbin(handle, prev);
+
+        // Merge blocks
+        prev->header.size += frag->header.size;
+        ListUnlink(&frag->header.link);
+
+        // Use prev instead of frag for binning
+        frag = prev;
+    }
+
+    // Add merged block to free list
+    rebin(handle, frag);
+}
+
+/**
+ * @brief Takes a fragment whose user pointer is aligned to `alignment`.
+ *
+ * Over-allocates by `alignment - FRAGMENT_SIZE_MIN`; since every user pointer
+ * is FRAGMENT_SIZE_MIN aligned, any leading gap is itself a valid fragment and
+ * goes straight back to the bins, as does the unused tail.
+ */
+static Fragment* allocateAlignedFragment(O1HeapInstance* const handle, const size_t fragment_size, const size_t alignment,
+                                         const size_t amount) {
+    Fragment* frag = allocateFragment(handle, fragment_size + alignment - FRAGMENT_SIZE_MIN, amount);
+    if (frag == NULL) {
+        return NULL;
+    }
 
+    const uintptr_t user = (uintptr_t)frag + O1HEAP_ALIGNMENT;
+    const size_t gap = (size_t)(-user) & (alignment - 1U);
+    if (gap != 0U) {
+        Fragment* const aligned = (Fragment*)(void*)(((char*)frag) + gap);
+        aligned->header.size = frag->header.size - gap;
+        aligned->header.used = FRAGMENT_USED;
+        ListLinkAfter(&frag->header.link, &aligned->header.link);
+        frag->header.size = gap;
+        releaseFragment(handle, frag);
+        frag = aligned;
+    }
+
+    const size_t before_trim = frag->header.size;
+    splitTail(handle, frag, fragment_size);
+    handle->diagnostics.allocated -= before_trim - frag->header.size;
+    return frag;
+}
+
+#ifdef HEAP_DEBUG
+static inline uint32_t* guardLengthOf(const Fragment* const frag) {
+    return (uint32_t*)(void*)(((char*)frag) + frag->header.size - sizeof(uint32_t));
+}
+
+/**
+ * @brief Fills the guard of a fragment handed out for `amount` bytes.
+ */
+static void armGuard(Fragment* const frag, const size_t amount) {
+    uint8_t* const guard = ((uint8_t*)frag) + O1HEAP_ALIGNMENT + amount;
+    const size_t length = (size_t)((uint8_t*)guardLengthOf(frag) - guard);
+    memset(guard, GUARD_BYTE, length);
+    *guardLengthOf(frag) = (uint32_t)length ^ GUARD_VALUE;
+}
+
+/**
+ * @brief Whether the guard of a used fragment is untouched, starting at the
+ * first byte past the request.
+ */
+static uint8_t guardIntact(const Fragment* const frag) {
+    const uint8_t* const end = (const uint8_t*)guardLengthOf(frag);
+    const size_t length = *guardLengthOf(frag) ^ GUARD_VALUE;
+    if (length < GUARD_SIZE - sizeof(uint32_t) ||
+        length > frag->header.size - O1HEAP_ALIGNMENT - sizeof(uint32_t)) {
+        return 0;
+    }
+    for (const uint8_t* byte = end - length; byte < end; byte++) {
+        if (*byte != GUARD_BYTE) {
+            return 0;
+        }
+    }
     return 1;
 }
 
-void* malloc(size_t amount) {
-    if (heap == NULL || amount == 0 || amount > (heap->diagnostics.capacity - O1HEAP_ALIGNMENT)) {
+/**
+ * @brief Checks a block passed to free or realloc, reporting any fault.
+ *
+ * @return 1 if the block is a live allocation of `handle`, 0 otherwise.
+ */
+static uint8_t validateBlock(O1HeapInstance* const handle, const Fragment* const frag, void* const ptr) {
+    const char* const start = (const char*)firstFragment(handle);
+    uint32_t fault = HEAP_CHECK_OK;
+    if ((const char*)frag < start || (const char*)frag >= start + handle->diagnostics.capacity ||
+        ((uintptr_t)ptr & (FRAGMENT_SIZE_MIN - 1U)) != 0U) {
+        fault = HEAP_CHECK_INVALID_FREE;
+    } else if (frag->header.used == FRAGMENT_FREE || frag->header.used == FRAGMENT_CACHED) {
+        fault = HEAP_CHECK_DOUBLE_FREE;
+    } else if (frag->header.used != FRAGMENT_USED || !guardIntact(frag)) {
+        fault = HEAP_CHECK_CANARY;
+    }
+
+    if (fault != HEAP_CHECK_OK) {
+        HeapFault(handle, ptr, fault);
+        return 0;
+    }
+    return 1;
+}
+
+__attribute__((weak)) void HeapFault(Heap* const handle, void* const ptr, const uint32_t fault) {
+    UNUSED(handle);
+    UNUSED(ptr);
+    UNUSED(fault);
+#ifndef TESTING_MODE
+    PanicHandlerWithInfo(__FILE__, __LINE__, "heap corruption");
+#endif
+}
+#endif
+
+/**
+ * @brief User pointer of a fragment being handed out for `amount` bytes;
+ * arms its guard.
+ */
+static inline void* userPointer(Fragment* const frag, const size_t amount) {
+#ifdef HEAP_DEBUG
+    armGuard(frag, amount);
+#else
+    UNUSED(amount);
+#endif
+    return (void*)(((char*)frag) + O1HEAP_ALIGNMENT);
+}
+
+#ifdef HEAP_THREAD_SAFE
+/*
+ * Concurrent mode (hosted targets only): every heap has its own lock, and each
+ * thread keeps a small stack of recently freed fragments per size class for
+ * the default heap. Hits never touch shared state; only refills and drains
+ * take the heap lock, a batch at a time. Cached fragments stay marked as used,
+ * so they count towards `allocated`.
+ */
+#define THREAD_CACHE_CLASSES 8U // Fragments up to 8 * FRAGMENT_SIZE_MIN bytes
+#define THREAD_CACHE_DEPTH 32U
+#define THREAD_CACHE_BATCH 8U
+
+typedef struct ThreadCache {
+    List         bins[THREAD_CACHE_CLASSES]; // Linked through free_link
+    uint_fast8_t counts[THREAD_CACHE_CLASSES];
+    size_t       generation;
+} ThreadCache;
+
+static __thread ThreadCache thread_cache;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+
+#define HEAP_LOCK(handle) pthread_mutex_lock(&(handle)->lock)
+#define HEAP_UNLOCK(handle) pthread_mutex_unlock(&(handle)->lock)
+
+// Debug builds tag cached fragments so a second free of one is caught
+#ifdef HEAP_DEBUG
+#define setCacheTag(frag, tag) ((frag)->header.used = (tag))
+#else
+#define setCacheTag(frag, tag) ((void)0)
+#endif
+
+static void drainCache(void* const arg) {
+    ThreadCache* const cache = (ThreadCache*)arg;
+    O1HeapInstance* const handle = heap;
+
+    if (handle != NULL && cache->generation == __atomic_load_n(&heap_generation, __ATOMIC_ACQUIRE)) {
+        HEAP_LOCK(handle);
+        for (uint_fast8_t index = 0; index < THREAD_CACHE_CLASSES; index++) {
+            ListNode* cached;
+            while ((cached = ListPopFront(&cache->bins[index])) != NULL) {
+                releaseFragment(handle, freeFragmentOf(cached));
+            }
+        }
+        HEAP_UNLOCK(handle);
+    }
+    memset(cache, 0, sizeof(ThreadCache));
+}
+
+static void createCacheKey(void) {
+    pthread_key_create(&cache_key, drainCache);
+}
+
+static ThreadCache* threadCache(void) {
+    ThreadCache* const cache = &thread_cache;
+    const size_t generation = __atomic_load_n(&heap_generation, __ATOMIC_ACQUIRE);
+    if (cache->generation != generation) {
+        // Anything cached belongs to a heap that has since been reinitialized
+        memset(cache, 0, sizeof(ThreadCache));
+        cache->generation = generation;
+        pthread_once(&cache_key_once, createCacheKey);
+        pthread_setspecific(cache_key, cache); // Drain on thread exit
+    }
+    return cache;
+}
+
+static Fragment* acquireFragment(O1HeapInstance* const handle, const size_t fragment_size, const size_t amount) {
+    const size_t index = (fragment_size / FRAGMENT_SIZE_MIN) - 1U;
+    Fragment* frag;
+    if (handle != heap || index >= THREAD_CACHE_CLASSES) {
+        HEAP_LOCK(handle);
+        frag = allocateFragment(handle, fragment_size, amount);
+        HEAP_UNLOCK(handle);
+        return frag;
+    }
+
+    ThreadCache* const cache = threadCache();
+    if (ListEmpty(&cache->bins[index])) {
+        // Refill a batch under a single lock acquisition
+        HEAP_LOCK(handle);
+        frag = allocateFragment(handle, fragment_size, amount);
+        for (uint_fast8_t i = 1; frag != NULL && i <= THREAD_CACHE_BATCH; i++) {
+            setCacheTag(frag, FRAGMENT_CACHED);
+            ListPushFront(&cache->bins[index], &frag->free_link);
+            cache->counts[index]++;
+            frag = (i < THREAD_CACHE_BATCH) ? allocateFragment(handle, fragment_size, 0) : NULL;
+        }
+        HEAP_UNLOCK(handle);
+    }
+
+    ListNode* const cached = ListPopFront(&cache->bins[index]);
+    if (cached == NULL) {
+        return NULL;
+    }
+    cache->counts[index]--;
+    frag = freeFragmentOf(cached);
+    setCacheTag(frag, FRAGMENT_USED);
+    return frag;
+}
+
+static void returnFragment(O1HeapInstance* const handle, Fragment* const frag) {
+    const size_t index = (frag->header.size / FRAGMENT_SIZE_MIN) - 1U;
+    if (handle == heap && index < THREAD_CACHE_CLASSES) {
+        ThreadCache* const cache = threadCache();
+        if (cache->counts[index] < THREAD_CACHE_DEPTH) {
+            setCacheTag(frag, FRAGMENT_CACHED);
+            ListPushFront(&cache->bins[index], &frag->free_link);
+            cache->counts[index]++;
+            return;
+        }
+
+        // Cache is full: hand half of it back together with this fragment
+        HEAP_LOCK(handle);
+        releaseFragment(handle, frag);
+        for (uint_fast8_t i = 0; i < (THREAD_CACHE_DEPTH / 2U); i++) {
+            ListNode* const cached = ListPopFront(&cache->bins[index]);
+            cache->counts[index]--;
+            releaseFragment(handle, freeFragmentOf(cached));
+        }
+        HEAP_UNLOCK(handle);
+        return;
+    }
+
+    HEAP_LOCK(handle);
+    releaseFragment(handle, frag);
+    HEAP_UNLOCK(handle);
+}
+
+static Fragment* acquireAlignedFragment(O1HeapInstance* const handle, const size_t fragment_size,
+                                        const size_t alignment, const size_t amount) {
+    HEAP_LOCK(handle);
+    Fragment* const frag = allocateAlignedFragment(handle, fragment_size, alignment, amount);
+    HEAP_UNLOCK(handle);
+    return frag;
+}
+#else
+#define HEAP_LOCK(handle) ((void)0)
+#define HEAP_UNLOCK(handle) ((void)0)
+#define acquireFragment(handle, fragment_size, amount) allocateFragment(handle, fragment_size, amount)
+#define acquireAlignedFragment(handle, fragment_size, alignment, amount) \
+    allocateAlignedFragment(handle, fragment_size, alignment, amount)
+#define returnFragment(handle, frag) releaseFragment(handle, frag)
+#endif
+
+Heap* HeapDefault(void) {
+    return heap;
+}
+
+void* HeapAlloc(Heap* const handle, const size_t amount) {
+    if (handle == NULL || amount == 0) {
+        return NULL;
+    }
+
+    recordRequest(handle, amount);
+    if (amount > (handle->diagnostics.capacity - O1HEAP_ALIGNMENT)) {
+        HEAP_LOCK(handle);
+        recordOOM(handle);
+        HEAP_UNLOCK(handle);
         return NULL;
     }
 
     // Calculate required size and ensure alignment
-    const size_t fragment_size = roundUpToAlignment(amount + O1HEAP_ALIGNMENT, FRAGMENT_SIZE_MIN);
+    const size_t fragment_size = roundUpToAlignment(amount + O1HEAP_ALIGNMENT + GUARD_SIZE, FRAGMENT_SIZE_MIN);
     if (fragment_size > FRAGMENT_SIZE_MAX || fragment_size < FRAGMENT_SIZE_MIN) {
         return NULL;
     }
 
-    // Simple first-fit strategy
-    Fragment* best_fit = NULL;
-    Fragment* current = heap->bins[0];  // Start with first bin
-    
-    // Search through all free blocks
-    while (current != NULL) {
-        if (current->header.size >= fragment_size) {
-            best_fit = current;
-            break;
-        }
-        current = current->next_free;
+    Fragment* const frag = acquireFragment(handle, fragment_size, amount);
+    if (frag == NULL) {
+        return NULL;
     }
+    return userPointer(frag, amount);
+}
 
-    if (best_fit == NULL) {
-        if (heap->diagnostics.peak_request_size < amount) {
-            heap->diagnostics.peak_request_size = amount;
-        }
-        heap->diagnostics.oom_count++;
+void* HeapAlignedAlloc(Heap* const handle, const size_t alignment, const size_t amount) {
+    if (alignment == 0 || (alignment & (alignment - 1U)) != 0) {
         return NULL;
     }
 
-    // Remove from free list
-    unbin(heap, best_fit);
-    
-    // Split if possible
-    const size_t leftover = best_fit->header.size - fragment_size;
-    if (leftover >= FRAGMENT_SIZE_MIN) {
-        Fragment* const new_frag = (Fragment*)(void*)(((char*)best_fit) + fragment_size);
-        new_frag->header.size = leftover;
-        new_frag->header.used = 0;
-        new_frag->next_free = NULL;
-        new_frag->prev_free = NULL;
-        interlink(new_frag, best_fit->header.next);
-        interlink(best_fit, new_frag);
-        rebin(heap, new_frag);
-        
-        best_fit->header.size = fragment_size;
+    // Every user pointer is already FRAGMENT_SIZE_MIN aligned
+    if (alignment <= FRAGMENT_SIZE_MIN) {
+        return HeapAlloc(handle, amount);
+    }
+
+    if (handle == NULL || amount == 0) {
+        return NULL;
     }
 
-    heap->diagnostics.allocated += best_fit->header.size;
-    if (heap->diagnostics.peak_allocated < heap->diagnostics.allocated) {
-        heap->diagnostics.peak_allocated = heap->diagnostics.allocated;
+    recordRequest(handle, amount);
+    if (alignment > (handle->diagnostics.capacity / 2U) ||
+        amount > (handle->diagnostics.capacity - O1HEAP_ALIGNMENT - alignment)) {
+        HEAP_LOCK(handle);
+        recordOOM(handle);
+        HEAP_UNLOCK(handle);
+        return NULL;
     }
 
-    best_fit->header.used = 1;
-    return (void*)(((char*)best_fit) + O1HEAP_ALIGNMENT);
+    const size_t fragment_size = roundUpToAlignment(amount + O1HEAP_ALIGNMENT + GUARD_SIZE, FRAGMENT_SIZE_MIN);
+    Fragment* const frag = acquireAlignedFragment(handle, fragment_size, alignment, amount);
+    if (frag == NULL) {
+        return NULL;
+    }
+    return userPointer(frag, amount);
 }
 
-void* realloc(void* ptr, size_t new_size) {
+void* HeapRealloc(Heap* const handle, void* ptr, const size_t new_size) {
     if (ptr == NULL) {
-        return malloc(new_size);
+        return HeapAlloc(handle, new_size);
     }
 
     if (new_size == 0) {
-        free(ptr);
+        HeapFree(handle, ptr);
         return NULL;
     }
 
     Fragment* frag = (Fragment*)(void*)(((char*)ptr) - O1HEAP_ALIGNMENT);
-    if (!frag->header.used) {
+    if (handle == NULL) {
+        return NULL;
+    }
+#ifdef HEAP_DEBUG
+    if (!validateBlock(handle, frag, ptr)) {
+        return NULL;
+    }
+#endif
+    if (frag->header.used != FRAGMENT_USED) {
+        return NULL;
+    }
+
+    recordRequest(handle, new_size);
+    if (new_size > (handle->diagnostics.capacity - O1HEAP_ALIGNMENT)) {
+        HEAP_LOCK(handle);
+        recordOOM(handle);
+        HEAP_UNLOCK(handle);
         return NULL;
     }
 
     // Calculate actual sizes
-    size_t current_fragment_size = frag->header.size;
-    size_t current_usable_size = current_fragment_size - O1HEAP_ALIGNMENT;
-    size_t required_fragment_size = roundUpToAlignment(new_size + O1HEAP_ALIGNMENT, FRAGMENT_SIZE_MIN);
-
-    // If new size fits in current block with some room to spare, split it
-    if (required_fragment_size + FRAGMENT_SIZE_MIN <= current_fragment_size) {
-        size_t remaining_size = current_fragment_size - required_fragment_size;
-        Fragment* split = (Fragment*)(void*)(((char*)frag) + required_fragment_size);
-        
-        // Initialize split block
-        split->header.size = remaining_size;
-        split->header.used = 0;
-        split->next_free = NULL;
-        split->prev_free = NULL;
-        
-        // Link split block
-        split->header.next = frag->header.next;
-        split->header.prev = frag;
-        if (frag->header.next) {
-            frag->header.next->header.prev = split;
+    const size_t current_fragment_size = frag->header.size;
+    const size_t current_usable_size = current_fragment_size - O1HEAP_ALIGNMENT - GUARD_SIZE;
+    const size_t required_fragment_size = roundUpToAlignment(new_size + O1HEAP_ALIGNMENT + GUARD_SIZE, FRAGMENT_SIZE_MIN);
+
+    HEAP_LOCK(handle);
+    if (required_fragment_size > current_fragment_size) {
+        Fragment* const next = nextFragment(frag);
+        Fragment* const prev = prevFragment(frag);
+        const size_t next_free_size = (next != NULL && next->header.used == FRAGMENT_FREE) ? next->header.size : 0U;
+        const size_t prev_free_size = (prev != NULL && prev->header.used == FRAGMENT_FREE) ? prev->header.size : 0U;
+
+        if (current_fragment_size + next_free_size + prev_free_size >= required_fragment_size) {
+            // Grow in place by absorbing the free successor
+            if (next_free_size != 0U) {
+                unbin(handle, next);
+                frag->header.size += next_free_size;
+                ListUnlink(&next->header.link);
+            }
+
+            // Still short: absorb the free predecessor too and slide the data down
+            if (frag->header.size < required_fragment_size) {
+                unbin(handle, prev);
+                prev->header.size += frag->header.size;
+                prev->header.used = FRAGMENT_USED;
+                ListUnlink(&frag->header.link);
+                memmove(((char*)prev) + O1HEAP_ALIGNMENT, ptr, current_usable_size);
+                frag = prev;
+                ptr = ((char*)prev) + O1HEAP_ALIGNMENT;
+            }
         }
-        frag->header.next = split;
-        
-        // Update original block and diagnostics
-        frag->header.size = required_fragment_size;
-        heap->diagnostics.allocated -= remaining_size;
-        
-        // Add split to free list
-        rebin(heap, split);
-        return ptr;
     }
-    // If new size fits exactly or leaves too little space to split, just use the current block
-    else if (required_fragment_size <= current_fragment_size) {
-        return ptr;
+
+    // Fits in the (possibly grown) fragment: give back whatever is left over
+    if (required_fragment_size <= frag->header.size) {
+        splitTail(handle, frag, required_fragment_size);
+        handle->diagnostics.allocated -= current_fragment_size;
+        handle->diagnostics.allocated += frag->header.size;
+        if (handle->diagnostics.peak_allocated < handle->diagnostics.allocated) {
+            handle->diagnostics.peak_allocated = handle->diagnostics.allocated;
+        }
+        HEAP_UNLOCK(handle);
+        return userPointer(frag, new_size);
     }
+    HEAP_UNLOCK(handle);
 
     // Need to allocate new block
-    void* new_ptr = malloc(new_size);
+    void* new_ptr = HeapAlloc(handle, new_size);
     if (!new_ptr) {
         return NULL;
     }
@@ -302,76 +754,204 @@ void* realloc(void* ptr, size_t new_size) {
     if (copy_size < new_size) {
         memset(((char*)new_ptr) + copy_size, 0, new_size - copy_size);
     }
-    free(ptr);
+    HeapFree(handle, ptr);
 
     return new_ptr;
 }
 
-void* calloc(size_t num_elements, size_t element_size) {
-    size_t total_size;
-    if (__builtin_mul_overflow(num_elements, element_size, &total_size)) {
-        return NULL;
+void HeapFree(Heap* const handle, void* const ptr) {
+    if (handle == NULL || ptr == NULL) {
+        return;
     }
-    
-    void* ptr = malloc(total_size);
-    if (ptr != NULL) {
-        memset(ptr, 0, total_size);
+
+    Fragment* frag = (Fragment*)(void*)(((char*)ptr) - O1HEAP_ALIGNMENT);
+#ifdef HEAP_DEBUG
+    if (!validateBlock(handle, frag, ptr)) {
+        return;
     }
-    return ptr;
+    memset(ptr, HEAP_POISON_BYTE, frag->header.size - O1HEAP_ALIGNMENT - GUARD_SIZE);
+#endif
+    if (frag->header.used != FRAGMENT_USED) {
+        return;
+    }
+
+    returnFragment(handle, frag);
 }
 
-void free(void* ptr) {
-    if (ptr == NULL) {
-        return;
+uint8_t HeapGetStats(Heap* const handle, HeapStats* const stats, const uint8_t full_walk) {
+    if (handle == NULL || stats == NULL) {
+        return 0;
     }
 
-    Fragment* frag = (Fragment*)(void*)(((char*)ptr) - O1HEAP_ALIGNMENT);
-    if (!frag->header.used) {
-        return;
+    HEAP_LOCK(handle);
+    stats->capacity = handle->diagnostics.capacity;
+    stats->allocated = handle->diagnostics.allocated;
+    stats->free_bytes = handle->diagnostics.capacity - handle->diagnostics.allocated;
+    stats->peak_allocated = handle->diagnostics.peak_allocated;
+    stats->peak_request_size = __atomic_load_n(&handle->diagnostics.peak_request_size, __ATOMIC_RELAXED);
+    stats->oom_count = handle->diagnostics.oom_count;
+    stats->free_fragments = handle->free_fragments;
+    stats->largest_free_block = 0;
+    if (handle->nonempty_bin_mask != 0U) {
+        // Every fragment in a lower bin is smaller than any in the top one,
+        // so only the top bin can hold the largest
+        const ListNode* free_link = handle->bins[Log2Floor(handle->nonempty_bin_mask)].head;
+        size_t largest = freeFragmentOf(free_link)->header.size;
+        while (full_walk && (free_link = free_link->next) != NULL) {
+            if (freeFragmentOf(free_link)->header.size > largest) {
+                largest = freeFragmentOf(free_link)->header.size;
+            }
+        }
+        stats->largest_free_block = largest - O1HEAP_ALIGNMENT - GUARD_SIZE;
     }
+    HEAP_UNLOCK(handle);
 
-    heap->diagnostics.allocated -= frag->header.size;
-    frag->header.used = 0;
+    stats->fragmentation_permille = (stats->free_bytes == 0U) ? 0U
+        : (uint32_t)(1000U - (((uint64_t)stats->largest_free_block * 1000U) / stats->free_bytes));
+    return 1;
+}
 
-    // Try to merge with next block if it's free
-    Fragment* next = frag->header.next;
-    if (next != NULL && !next->header.used) {
-        // Remove next from free list
-        unbin(heap, next);
-        
-        // Merge blocks
-        frag->header.size += next->header.size;
-        frag->header.next = next->header.next;
-        if (next->header.next) {
-            next->header.next->header.prev = frag;
+/**
+ * @brief Walks the physical chain, then the bins, and cross-checks the two.
+ */
+static uint32_t checkHeap(const O1HeapInstance* const handle) {
+    const char* const start = (const char*)firstFragment(handle);
+    const char* const end = start + handle->diagnostics.capacity;
+    size_t total = 0;
+    size_t allocated = 0;
+    size_t free_count = 0;
+
+    // Every step moves strictly forward inside the region, so this terminates
+    const Fragment* prev = NULL;
+    for (const Fragment* frag = (const Fragment*)(const void*)start; frag != NULL; frag = nextFragment(frag)) {
+        if ((const char*)frag < start || (const char*)frag >= end || prevFragment(frag) != prev) {
+            return HEAP_CHECK_LINKAGE;
+        }
+
+        const size_t size = frag->header.size;
+        if (size < FRAGMENT_SIZE_MIN || (size % FRAGMENT_SIZE_MIN) != 0U || size > (size_t)(end - (const char*)frag)) {
+            return HEAP_CHECK_SIZE;
+        }
+        const Fragment* const next = nextFragment(frag);
+        if (next != NULL && (const char*)next != ((const char*)frag) + size) {
+            return HEAP_CHECK_LINKAGE;
         }
+
+        if (frag->header.used == FRAGMENT_FREE) {
+            if (prev != NULL && prev->header.used == FRAGMENT_FREE) {
+                return HEAP_CHECK_UNCOALESCED;
+            }
+            free_count++;
+        } else {
+#ifdef HEAP_DEBUG
+            // Fragments parked in a thread cache have no armed guard
+            if (frag->header.used != FRAGMENT_CACHED &&
+                (frag->header.used != FRAGMENT_USED || !guardIntact(frag))) {
+                return HEAP_CHECK_CANARY;
+            }
+#endif
+            allocated += size;
+        }
+        total += size;
+        prev = frag;
     }
 
-    // Try to merge with previous block if it's free
-    Fragment* prev = frag->header.prev;
-    if (prev != NULL && !prev->header.used) {
-        // Remove prev from free list
-        unbin(heap, prev);
-        
-        // Merge blocks
-        prev->header.size += frag->header.size;
-        prev->header.next = frag->header.next;
-        if (frag->header.next) {
-            frag->header.next->header.prev = prev;
+    if (total != handle->diagnostics.capacity || allocated != handle->diagnostics.allocated) {
+        return HEAP_CHECK_SIZE;
+    }
+
+    // Each free fragment must sit in exactly the bin of its size class
+    size_t binned = 0;
+    for (uint_fast8_t index = 0; index < NUM_BINS_MAX; index++) {
+        const uint8_t marked = ((handle->nonempty_bin_mask >> index) & 1U) != 0U;
+        const List* const bin = &handle->bins[index];
+        if ((bin->head != NULL) != marked) {
+            return HEAP_CHECK_BINS;
+        }
+
+        const ListNode* prev_free = NULL;
+        for (const ListNode* free_link = bin->head; free_link != NULL; free_link = free_link->next) {
+            const Fragment* const frag = freeFragmentOf(free_link);
+            if ((const char*)frag < start || (const char*)frag >= end || free_link->prev != prev_free ||
+                frag->header.used != FRAGMENT_FREE || Log2Floor(frag->header.size / FRAGMENT_SIZE_MIN) != index) {
+                return HEAP_CHECK_BINS;
+            }
+            // Also stops a cycle in the list
+            if (++binned > free_count) {
+                return HEAP_CHECK_BINS;
+            }
+            prev_free = free_link;
+        }
+        if (bin->tail != prev_free) {
+            return HEAP_CHECK_BINS;
         }
-        
-        // Use prev instead of frag for binning
-        frag = prev;
     }
 
-    // Add merged block to free list
-    rebin(heap, frag);
+    if (binned != free_count || free_count != handle->free_fragments) {
+        return HEAP_CHECK_BINS;
+    }
+    return HEAP_CHECK_OK;
+}
+
+uint32_t HeapCheck(Heap* const handle) {
+    if (handle == NULL) {
+        return HEAP_CHECK_LINKAGE;
+    }
+
+    HEAP_LOCK(handle);
+    const uint32_t result = checkHeap(handle);
+    HEAP_UNLOCK(handle);
+    return result;
+}
+
+uint32_t AllocatorCheck(void) {
+    return HeapCheck(heap);
+}
+
+uint8_t AllocatorInit(void* const region, const size_t region_size) {
+    Heap* const handle = HeapCreate(region, region_size);
+    if (handle == NULL) {
+        return 0;
+    }
+
+    heap = handle;
+#ifdef HEAP_THREAD_SAFE
+    __atomic_add_fetch(&heap_generation, 1U, __ATOMIC_RELEASE);
+#endif
+    return 1;
+}
+
+void* malloc(size_t amount) {
+    void* const ptr = HeapAlloc(heap, amount);
+    HEAP_TRACE_RECORD(HEAP_TRACE_MALLOC, ptr, NULL, amount);
+    return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t amount) {
+    void* const ptr = HeapAlignedAlloc(heap, alignment, amount);
+    HEAP_TRACE_RECORD(HEAP_TRACE_ALIGNED_ALLOC, ptr, NULL, amount);
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t new_size) {
+    void* const new_ptr = HeapRealloc(heap, ptr, new_size);
+    HEAP_TRACE_RECORD(HEAP_TRACE_REALLOC, new_ptr, ptr, new_size);
+    return new_ptr;
+}
+
+void* calloc(size_t num_elements, size_t element_size) {
+    void* const ptr = HeapCalloc(heap, num_elements, element_size);
+    HEAP_TRACE_RECORD(HEAP_TRACE_CALLOC, ptr, NULL, (ptr != NULL) ? num_elements * element_size : 0U);
+    return ptr;
+}
+
+void free(void* ptr) {
+    HEAP_TRACE_RECORD(HEAP_TRACE_FREE, ptr, NULL, 0U);
+    HeapFree(heap, ptr);
 }
 
 void AllocatorDeinit() {
     heap = NULL;
-    heap_start = NULL;
-    heap_size = 0;
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file pool.c
+ * @brief Fixed-size object pool allocator.
+ *
+ * Layout of a pool inside its buffer:
+ *
+ *   [Pool][bitmap words][padding][slot 0][slot 1] ... [slot capacity - 1]
+ *
+ * Slots that have never been used are handed out by bumping `untouched`, so
+ * creating a pool does not have to thread every slot onto the free list.
+ */
+#include "virtualization/memory/pool.h"
+#include "virtualization/memory/heap.h"
+
+#include "types.h"
+#include <string.h>
+#include <stdint.h>
+
+#define BITMAP_WORD_BITS 32U
+
+static inline size_t roundUpToAlignment(const size_t x) {
+    return (x + POOL_ALIGNMENT - 1U) & ~(POOL_ALIGNMENT - 1U);
+}
+
+static inline size_t slotSize(const size_t object_size) {
+    return roundUpToAlignment((object_size < sizeof(void*)) ? sizeof(void*) : object_size);
+}
+
+static inline size_t bitmapWords(const size_t count) {
+    return (count + BITMAP_WORD_BITS - 1U) / BITMAP_WORD_BITS;
+}
+
+static inline size_t controlSize(const size_t count) {
+    return roundUpToAlignment(sizeof(Pool) + (bitmapWords(count) * sizeof(uint32_t)));
+}
+
+Pool* PoolInit(void* const buffer, const size_t buffer_size, const size_t object_size) {
+    if (buffer == NULL || object_size == 0) {
+        return NULL;
+    }
+
+    // Align the start of the buffer up rather than rejecting it
+    const size_t padding = (size_t)(-(uintptr_t)buffer) & (POOL_ALIGNMENT - 1U);
+    if (buffer_size <= padding + controlSize(1U)) {
+        return NULL;
+    }
+    const size_t usable = buffer_size - padding;
+    const size_t slot_size = slotSize(object_size);
+
+    // Each slot costs slot_size bytes plus one bitmap bit; start from that
+    // estimate and step down until the padded control block also fits
+    size_t capacity = ((usable - sizeof(Pool)) * 8U) / ((slot_size * 8U) + 1U);
+    while (capacity > 0 && controlSize(capacity) + (capacity * slot_size) > usable) {
+        capacity--;
+    }
+    if (capacity == 0) {
+        return NULL;
+    }
+
+    Pool* const pool = (Pool*)(void*)(((uint8_t*)buffer) + padding);
+    pool->bitmap = (uint32_t*)(void*)(((uint8_t*)pool) + sizeof(Pool));
+    pool->storage = ((uint8_t*)pool) + controlSize(capacity);
+    pool->free_list = NULL;
+    pool->object_size = slot_size;
+    pool->capacity = capacity;
+    pool->untouched = 0;
+    pool->available = capacity;
+    pool->heap_block = NULL;
+    memset(pool->bitmap, 0, bitmapWords(capacity) * sizeof(uint32_t));
+
+    return pool;
+}
+
+void* PoolAlloc(Pool* const pool) {
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    uint8_t* slot;
+    size_t index;
+    if (pool->free_list != NULL) {
+        slot = (uint8_t*)pool->free_list;
+        pool->free_list = *(void**)pool->free_list;
+        index = (size_t)(slot - pool->storage) / pool->object_size;
+    } else if (pool->untouched < pool->capacity) {
+        index = pool->untouched++;
+        slot = pool->storage + (index * pool->object_size);
+    } else {
+        return NULL;
+    }
+
+    pool->bitmap[index / BITMAP_WORD_BITS] |= ((uint32_t)1U) << (index % BITMAP_WORD_BITS);
+    pool->available--;
+    return slot;
+}
+
+void PoolFree(Pool* const pool, void* const ptr) {
+    if (pool == NULL || ptr == NULL) {
+        return;
+    }
+
+    // Reject pointers outside the pool or not at the start of a slot
+    const uint8_t* const slot = (const uint8_t*)ptr;
+    if (slot < pool->storage) {
+        return;
+    }
+    const size_t offset = (size_t)(slot - pool->storage);
+    const size_t index = offset / pool->object_size;
+    if (index >= pool->capacity || (index * pool->object_size) != offset) {
+        return;
+    }
+
+    // Reject double frees
+    uint32_t* const word = &pool->bitmap[index / BITMAP_WORD_BITS];
+    const uint32_t bit = ((uint32_t)1U) << (index % BITMAP_WORD_BITS);
+    if ((*word & bit) == 0U) {
+        return;
+    }
+
+    *word &= ~bit;
+    *(void**)ptr = pool->free_list;
+    pool->free_list = ptr;
+    pool->available++;
+}
+
+#ifndef NO_ALLOCATOR
+Pool* PoolCreate(const size_t object_size, const size_t object_count) {
+    if (object_size == 0 || object_count == 0) {
+        return NULL;
+    }
+
+    const size_t slot_size = slotSize(object_size);
+    size_t storage_size;
+    if (__builtin_mul_overflow(object_count, slot_size, &storage_size) ||
+        __builtin_add_overflow(storage_size, controlSize(object_count) + POOL_ALIGNMENT, &storage_size)) {
+        return NULL;
+    }
+
+    void* const buffer = malloc(storage_size);
+    if (buffer == NULL) {
+        return NULL;
+    }
+
+    Pool* const pool = PoolInit(buffer, storage_size, object_size);
+    if (pool == NULL) {
+        free(buffer);
+        return NULL;
+    }
+
+    // PoolInit may fit a few extra slots into the alignment slack; expose
+    // exactly what was asked for
+    if (pool->capacity > object_count) {
+        pool->capacity = object_count;
+        pool->available = object_count;
+    }
+    pool->heap_block = buffer;
+    return pool;
+}
+
+void PoolDestroy(Pool* const pool) {
+    if (pool == NULL || pool->heap_block == NULL) {
+        return;
+    }
+
+    free(pool->heap_block);
+}
+#endif
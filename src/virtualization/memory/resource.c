@@ -0,0 +1,201 @@
+/**
+ * @file resource.c
+ * @brief Memory resources over the heap, heap instances, arenas and pools.
+ */
+#include "virtualization/memory/resource.h"
+#include "assert.h"
+
+#include "types.h"
+#include <string.h>
+#include <stdint.h>
+
+/*
+ * Default heap
+ */
+#ifndef NO_ALLOCATOR
+static void* defaultAllocate(void* const context, const size_t size) {
+    UNUSED(context);
+    return malloc(size);
+}
+
+static void* defaultReallocate(void* const context, void* const ptr, const size_t old_size, const size_t new_size) {
+    UNUSED(context);
+    UNUSED(old_size);
+    return realloc(ptr, new_size);
+}
+
+static void defaultRelease(void* const context, void* const ptr, const size_t size) {
+    UNUSED(context);
+    UNUSED(size);
+    free(ptr);
+}
+#else
+static void* defaultAllocate(void* const context, const size_t size) {
+    UNUSED(context);
+    UNUSED(size);
+    return NULL;
+}
+
+#define defaultReallocate NULL
+
+static void defaultRelease(void* const context, void* const ptr, const size_t size) {
+    UNUSED(context);
+    UNUSED(ptr);
+    UNUSED(size);
+}
+#endif
+
+static const MemoryResource default_resource = {defaultAllocate, defaultReallocate, defaultRelease, NULL};
+
+const MemoryResource* MemoryResourceDefault(void) {
+    return &default_resource;
+}
+
+/*
+ * Heap instances
+ */
+#if !defined(USE_CLANG_ALLOCATOR) && !defined(NO_ALLOCATOR)
+static void* heapAllocate(void* const context, const size_t size) {
+    return HeapAlloc((Heap*)context, size);
+}
+
+static void* heapReallocate(void* const context, void* const ptr, const size_t old_size, const size_t new_size) {
+    UNUSED(old_size);
+    return HeapRealloc((Heap*)context, ptr, new_size);
+}
+
+static void heapRelease(void* const context, void* const ptr, const size_t size) {
+    UNUSED(size);
+    HeapFree((Heap*)context, ptr);
+}
+
+void MemoryResourceFromHeap(MemoryResource* const resource, Heap* const heap) {
+    resource->allocate = heapAllocate;
+    resource->reallocate = heapReallocate;
+    resource->release = heapRelease;
+    resource->context = heap;
+}
+#endif
+
+/*
+ * Arenas
+ *
+ * Only the most recent block can change size, by moving the arena's offset;
+ * anything else is copied to a new block and the old one is lost until the
+ * arena is rewound.
+ */
+static inline size_t arenaRound(const size_t size) {
+    return (size + ARENA_ALIGNMENT - 1U) & ~(ARENA_ALIGNMENT - 1U);
+}
+
+static inline uint8_t arenaIsLast(const Arena* const arena, void* const ptr, const size_t size) {
+    return ptr != NULL && (uintptr_t)ptr + arenaRound(size) == (uintptr_t)(arena->storage + arena->offset);
+}
+
+static void* arenaAllocate(void* const context, const size_t size) {
+    return ArenaAlloc((Arena*)context, size);
+}
+
+static void* arenaReallocate(void* const context, void* const ptr, const size_t old_size, const size_t new_size) {
+    Arena* const arena = (Arena*)context;
+    if (arenaIsLast(arena, ptr, old_size)) {
+        const size_t start = (size_t)((uint8_t*)ptr - arena->storage);
+        if (new_size > arena->capacity - start) {
+            return NULL;
+        }
+        ArenaRewind(arena, start);
+        return ArenaAlloc(arena, new_size);
+    }
+
+    void* const moved = ArenaAlloc(arena, new_size);
+    if (moved != NULL && ptr != NULL) {
+        memcpy(moved, ptr, (old_size < new_size) ? old_size : new_size);
+    }
+    return moved;
+}
+
+static void arenaRelease(void* const context, void* const ptr, const size_t size) {
+    Arena* const arena = (Arena*)context;
+    if (arenaIsLast(arena, ptr, size)) {
+        ArenaRewind(arena, (size_t)((uint8_t*)ptr - arena->storage));
+    }
+}
+
+void MemoryResourceFromArena(MemoryResource* const resource, Arena* const arena) {
+    resource->allocate = arenaAllocate;
+    resource->reallocate = arenaReallocate;
+    resource->release = arenaRelease;
+    resource->context = arena;
+}
+
+/*
+ * Pools
+ */
+static void* poolAllocate(void* const context, const size_t size) {
+    Pool* const pool = (Pool*)context;
+    return (size <= pool->object_size) ? PoolAlloc(pool) : NULL;
+}
+
+static void* poolReallocate(void* const context, void* const ptr, const size_t old_size, const size_t new_size) {
+    const Pool* const pool = (const Pool*)context;
+    UNUSED(old_size);
+    return (new_size <= pool->object_size) ? ptr : NULL;
+}
+
+static void poolRelease(void* const context, void* const ptr, const size_t size) {
+    UNUSED(size);
+    PoolFree((Pool*)context, ptr);
+}
+
+void MemoryResourceFromPool(MemoryResource* const resource, Pool* const pool) {
+    resource->allocate = poolAllocate;
+    resource->reallocate = poolReallocate;
+    resource->release = poolRelease;
+    resource->context = pool;
+}
+
+/*
+ * Dispatch
+ */
+void* MemoryResourceAllocate(const MemoryResource* resource, const size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+    if (resource == NULL) {
+        resource = &default_resource;
+    }
+    return resource->allocate(resource->context, size);
+}
+
+void* MemoryResourceReallocate(const MemoryResource* resource, void* const ptr, const size_t old_size,
+                               const size_t new_size) {
+    if (resource == NULL) {
+        resource = &default_resource;
+    }
+    if (ptr == NULL) {
+        return MemoryResourceAllocate(resource, new_size);
+    }
+    if (new_size == 0) {
+        return NULL;
+    }
+    if (resource->reallocate != NULL) {
+        return resource->reallocate(resource->context, ptr, old_size, new_size);
+    }
+
+    void* const moved = resource->allocate(resource->context, new_size);
+    if (moved != NULL) {
+        memcpy(moved, ptr, (old_size < new_size) ? old_size : new_size);
+        resource->release(resource->context, ptr, old_size);
+    }
+    return moved;
+}
+
+void MemoryResourceRelease(const MemoryResource* resource, void* const ptr, const size_t size) {
+    if (ptr == NULL) {
+        return;
+    }
+    if (resource == NULL) {
+        resource = &default_resource;
+    }
+    resource->release(resource->context, ptr, size);
+}
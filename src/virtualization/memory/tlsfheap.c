@@ -0,0 +1,491 @@
+/**
+ * @file tlsfheap.c
+ * @brief Two-Level Segregated Fit (TLSF) Memory Allocator
+ *
+ * Free blocks are indexed by a first level of power-of-two size classes, each
+ * split linearly into TLSF_SL_COUNT second-level classes. Two bitmaps locate a
+ * suitable free list with a pair of bit scans, giving:
+ *
+ * - O(1) allocation and deallocation
+ * - Immediate coalescing of physical neighbours
+ * - At most 1/TLSF_SL_COUNT internal fragmentation from size rounding, instead
+ *   of the up to 50% lost to power-of-two bins
+ *
+ * @note Configuration:
+ * - TLSF_ALIGNMENT: Payload alignment (2 pointers: 8 bytes on 32-bit, 16 on 64-bit)
+ * - TLSF_SL_LOG2: Log2 of the number of second-level classes (16)
+ * - TLSF_FL_MAX: Log2 of the largest block size (2^30 on 32-bit, 2^32 on 64-bit)
+ *
+ * The control structure sits at the start of each heap's region, so any
+ * number of heaps can coexist; `malloc` and friends use the default one.
+ */
+#include "virtualization/memory/heap.h"
+
+#ifdef USE_TLSF_ALLOCATOR
+
+#include "bits.h"
+#include "types.h"
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+
+#define TLSF_ALIGNMENT (sizeof(void*) * 2U)
+#define TLSF_ALIGNMENT_LOG2 ((sizeof(void*) == 8U) ? 4U : 3U)
+#define TLSF_SL_LOG2 4U
+#define TLSF_SL_COUNT (1U << TLSF_SL_LOG2)
+#define TLSF_FL_SHIFT (TLSF_SL_LOG2 + TLSF_ALIGNMENT_LOG2)
+#define TLSF_FL_MAX ((sizeof(void*) == 8U) ? 32U : 30U)
+#define TLSF_FL_COUNT (TLSF_FL_MAX - TLSF_FL_SHIFT + 1U)
+#define TLSF_SMALL_BLOCK_SIZE (((size_t)1U) << TLSF_FL_SHIFT)
+
+// Blocks sizes count payload bytes only; the low bit marks a free block
+#define BLOCK_FREE_BIT ((size_t)1U)
+#define BLOCK_OVERHEAD (offsetof(BlockHeader, next_free))
+#define BLOCK_SIZE_MIN (sizeof(BlockHeader) - BLOCK_OVERHEAD)
+#define BLOCK_SIZE_MAX (((size_t)1U) << TLSF_FL_MAX)
+#define CONTROL_SIZE_PADDED ((sizeof(TLSFControl) + TLSF_ALIGNMENT - 1U) & ~(TLSF_ALIGNMENT - 1U))
+
+#ifndef offsetof
+#define offsetof(type, member) __builtin_offsetof(type, member)
+#endif
+
+typedef struct BlockHeader BlockHeader;
+
+struct BlockHeader {
+    BlockHeader* prev_phys; // Physically preceding block
+    size_t       size;      // Payload size | BLOCK_FREE_BIT
+    BlockHeader* next_free; // Only valid while the block is free
+    BlockHeader* prev_free;
+};
+
+_Static_assert(sizeof(BlockHeader) == 2U * TLSF_ALIGNMENT, "Block header must be two alignment units");
+_Static_assert(TLSF_FL_COUNT <= 32U, "First-level bitmap must fit in 32 bits");
+
+typedef struct Heap TLSFControl;
+
+struct Heap {
+    uint32_t     fl_bitmap;
+    uint32_t     sl_bitmap[TLSF_FL_COUNT];
+    BlockHeader* blocks[TLSF_FL_COUNT][TLSF_SL_COUNT];
+    size_t       free_blocks;
+    struct {
+        size_t capacity;
+        size_t allocated;
+        size_t peak_allocated;
+        size_t peak_request_size;
+        size_t oom_count;
+    } diagnostics;
+};
+
+// Global variables
+static TLSFControl* heap = NULL; // Default heap, set up by AllocatorInit
+
+static inline size_t blockSize(const BlockHeader* const block) {
+    return block->size & ~BLOCK_FREE_BIT;
+}
+
+static inline int blockIsFree(const BlockHeader* const block) {
+    return (block->size & BLOCK_FREE_BIT) != 0U;
+}
+
+static inline void* blockToPtr(BlockHeader* const block) {
+    return (void*)(((char*)block) + BLOCK_OVERHEAD);
+}
+
+static inline BlockHeader* ptrToBlock(void* const ptr) {
+    return (BlockHeader*)(void*)(((char*)ptr) - BLOCK_OVERHEAD);
+}
+
+static inline BlockHeader* blockNext(BlockHeader* const block) {
+    return (BlockHeader*)(void*)(((char*)block) + BLOCK_OVERHEAD + blockSize(block));
+}
+
+static inline size_t roundUpToAlignment(const size_t x) {
+    return (x + TLSF_ALIGNMENT - 1U) & ~(TLSF_ALIGNMENT - 1U);
+}
+
+/**
+ * @brief Maps a block size to its first/second level class.
+ */
+static inline void mappingInsert(const size_t size, uint_fast8_t* const fl, uint_fast8_t* const sl) {
+    if (size < TLSF_SMALL_BLOCK_SIZE) {
+        *fl = 0;
+        *sl = (uint_fast8_t)(size >> TLSF_ALIGNMENT_LOG2);
+    } else {
+        const uint_fast8_t msb = Log2Floor(size);
+        *sl = (uint_fast8_t)((size >> (msb - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT);
+        *fl = (uint_fast8_t)(msb - (TLSF_FL_SHIFT - 1U));
+    }
+}
+
+/**
+ * @brief Maps a request to the first class whose blocks are all large enough.
+ */
+static inline void mappingSearch(const size_t size, uint_fast8_t* const fl, uint_fast8_t* const sl) {
+    size_t rounded = size;
+    if (size >= TLSF_SMALL_BLOCK_SIZE) {
+        rounded += (((size_t)1U) << (Log2Floor(size) - TLSF_SL_LOG2)) - 1U;
+    }
+    mappingInsert(rounded, fl, sl);
+}
+
+static BlockHeader* findSuitable(const TLSFControl* const control, uint_fast8_t* const fl, uint_fast8_t* const sl) {
+    uint32_t sl_map = control->sl_bitmap[*fl] & (~0U << *sl);
+    if (sl_map == 0U) {
+        // Nothing in this first level, move to the next non-empty one
+        const uint32_t fl_map = (*fl + 1U < 32U) ? (control->fl_bitmap & (~0U << (*fl + 1U))) : 0U;
+        if (fl_map == 0U) {
+            return NULL;
+        }
+        *fl = Ctz32(fl_map);
+        sl_map = control->sl_bitmap[*fl];
+    }
+    *sl = Ctz32(sl_map);
+    return control->blocks[*fl][*sl];
+}
+
+static void insertFree(TLSFControl* const control, BlockHeader* const block) {
+    uint_fast8_t fl, sl;
+    mappingInsert(blockSize(block), &fl, &sl);
+
+    BlockHeader* const head = control->blocks[fl][sl];
+    block->next_free = head;
+    block->prev_free = NULL;
+    if (head != NULL) {
+        head->prev_free = block;
+    }
+    control->blocks[fl][sl] = block;
+    control->fl_bitmap |= 1U << fl;
+    control->sl_bitmap[fl] |= 1U << sl;
+    control->free_blocks++;
+}
+
+static void removeFree(TLSFControl* const control, BlockHeader* const block) {
+    uint_fast8_t fl, sl;
+    mappingInsert(blockSize(block), &fl, &sl);
+
+    if (block->next_free != NULL) {
+        block->next_free->prev_free = block->prev_free;
+    }
+    if (block->prev_free != NULL) {
+        block->prev_free->next_free = block->next_free;
+    }
+    if (control->blocks[fl][sl] == block) {
+        control->blocks[fl][sl] = block->next_free;
+        if (block->next_free == NULL) {
+            control->sl_bitmap[fl] &= ~(1U << sl);
+            if (control->sl_bitmap[fl] == 0U) {
+                control->fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+    control->free_blocks--;
+}
+
+/**
+ * @brief Splits the tail of a block off into a new free block if it is big
+ * enough to stand on its own, merging it with a free successor.
+ */
+static void trimTail(TLSFControl* const control, BlockHeader* const block, const size_t size) {
+    const size_t current = blockSize(block);
+    if (current < size + BLOCK_OVERHEAD + BLOCK_SIZE_MIN) {
+        return;
+    }
+
+    BlockHeader* const remainder = (BlockHeader*)(void*)(((char*)blockToPtr(block)) + size);
+    remainder->prev_phys = block;
+    remainder->size = (current - size - BLOCK_OVERHEAD) | BLOCK_FREE_BIT;
+    block->size = size | (block->size & BLOCK_FREE_BIT);
+
+    BlockHeader* next = blockNext(remainder);
+    if (blockIsFree(next)) {
+        removeFree(control, next);
+        remainder->size += BLOCK_OVERHEAD + blockSize(next);
+        next = blockNext(remainder);
+    }
+    next->prev_phys = remainder;
+    insertFree(control, remainder);
+}
+
+static inline size_t adjustRequest(const size_t amount) {
+    const size_t adjusted = roundUpToAlignment(amount);
+    return (adjusted < BLOCK_SIZE_MIN) ? BLOCK_SIZE_MIN : adjusted;
+}
+
+Heap* HeapCreate(void* const region, const size_t region_size) {
+    if (region == NULL) {
+        return NULL;
+    }
+
+    // Align the start of the region up rather than rejecting it
+    const size_t padding = (size_t)(-(uintptr_t)region) & (TLSF_ALIGNMENT - 1U);
+    if (region_size < padding + CONTROL_SIZE_PADDED + (2U * BLOCK_OVERHEAD) + BLOCK_SIZE_MIN) {
+        return NULL;
+    }
+
+    TLSFControl* const control = (TLSFControl*)(void*)(((char*)region) + padding);
+    memset(control, 0, sizeof(TLSFControl));
+
+    // One free block spanning the pool, followed by a used zero-size sentinel
+    size_t capacity = region_size - padding - CONTROL_SIZE_PADDED - (2U * BLOCK_OVERHEAD);
+    capacity &= ~(TLSF_ALIGNMENT - 1U);
+    if (capacity >= BLOCK_SIZE_MAX) {
+        capacity = BLOCK_SIZE_MAX - TLSF_ALIGNMENT;
+    }
+
+    BlockHeader* const block = (BlockHeader*)(void*)(((char*)control) + CONTROL_SIZE_PADDED);
+    block->prev_phys = NULL;
+    block->size = capacity | BLOCK_FREE_BIT;
+    insertFree(control, block);
+
+    BlockHeader* const sentinel = blockNext(block);
+    sentinel->prev_phys = block;
+    sentinel->size = 0;
+
+    control->diagnostics.capacity = capacity;
+    return control;
+}
+
+Heap* HeapDefault(void) {
+    return heap;
+}
+
+void* HeapAlloc(Heap* const control, const size_t amount) {
+    if (control == NULL || amount == 0) {
+        return NULL;
+    }
+
+    if (control->diagnostics.peak_request_size < amount) {
+        control->diagnostics.peak_request_size = amount;
+    }
+    if (amount >= BLOCK_SIZE_MAX) {
+        control->diagnostics.oom_count++;
+        return NULL;
+    }
+
+    const size_t size = adjustRequest(amount);
+
+    uint_fast8_t fl, sl;
+    mappingSearch(size, &fl, &sl);
+    BlockHeader* const block = (fl < TLSF_FL_COUNT) ? findSuitable(control, &fl, &sl) : NULL;
+    if (block == NULL) {
+        control->diagnostics.oom_count++;
+        return NULL;
+    }
+
+    removeFree(control, block);
+    trimTail(control, block, size);
+    block->size &= ~BLOCK_FREE_BIT;
+
+    control->diagnostics.allocated += blockSize(block);
+    if (control->diagnostics.peak_allocated < control->diagnostics.allocated) {
+        control->diagnostics.peak_allocated = control->diagnostics.allocated;
+    }
+
+    return blockToPtr(block);
+}
+
+void HeapFree(Heap* const control, void* const ptr) {
+    if (control == NULL || ptr == NULL) {
+        return;
+    }
+
+    BlockHeader* block = ptrToBlock(ptr);
+    if (blockIsFree(block)) {
+        return;
+    }
+
+    control->diagnostics.allocated -= blockSize(block);
+    block->size |= BLOCK_FREE_BIT;
+
+    // Merge with the previous block if it's free
+    BlockHeader* const prev = block->prev_phys;
+    if (prev != NULL && blockIsFree(prev)) {
+        removeFree(control, prev);
+        prev->size += BLOCK_OVERHEAD + blockSize(block);
+        block = prev;
+    }
+
+    // Merge with the next block if it's free (the sentinel never is)
+    BlockHeader* next = blockNext(block);
+    if (blockIsFree(next)) {
+        removeFree(control, next);
+        block->size += BLOCK_OVERHEAD + blockSize(next);
+        next = blockNext(block);
+    }
+    next->prev_phys = block;
+
+    insertFree(control, block);
+}
+
+void* HeapAlignedAlloc(Heap* const control, const size_t alignment, const size_t amount) {
+    if (alignment == 0 || (alignment & (alignment - 1U)) != 0) {
+        return NULL;
+    }
+
+    if (alignment <= TLSF_ALIGNMENT) {
+        return HeapAlloc(control, amount);
+    }
+
+    if (control == NULL || amount == 0 || amount >= BLOCK_SIZE_MAX || alignment >= (BLOCK_SIZE_MAX / 2U)) {
+        return NULL;
+    }
+
+    // Leave room to slide the payload forward by a gap that can stand on its
+    // own as a free block
+    const size_t size = adjustRequest(amount);
+    const size_t gap_min = BLOCK_OVERHEAD + BLOCK_SIZE_MIN;
+    void* const raw = HeapAlloc(control, size + alignment + gap_min);
+    if (raw == NULL) {
+        return NULL;
+    }
+
+    BlockHeader* block = ptrToBlock(raw);
+    uintptr_t aligned = ((uintptr_t)raw + alignment - 1U) & ~(uintptr_t)(alignment - 1U);
+    if (aligned != (uintptr_t)raw) {
+        if (aligned - (uintptr_t)raw < gap_min) {
+            aligned += alignment;
+        }
+
+        // Split the leading gap off and hand it back
+        const size_t gap = (size_t)(aligned - (uintptr_t)raw);
+        BlockHeader* const shifted = ptrToBlock((void*)aligned);
+        shifted->prev_phys = block;
+        shifted->size = blockSize(block) - gap;
+        blockNext(shifted)->prev_phys = shifted;
+        block->size = gap - BLOCK_OVERHEAD;
+        control->diagnostics.allocated -= BLOCK_OVERHEAD;
+        HeapFree(control, raw);
+        block = shifted;
+    }
+
+    const size_t before_trim = blockSize(block);
+    trimTail(control, block, size);
+    control->diagnostics.allocated -= before_trim - blockSize(block);
+    return blockToPtr(block);
+}
+
+void* HeapRealloc(Heap* const control, void* const ptr, const size_t new_size) {
+    if (ptr == NULL) {
+        return HeapAlloc(control, new_size);
+    }
+
+    if (new_size == 0) {
+        HeapFree(control, ptr);
+        return NULL;
+    }
+
+    BlockHeader* const block = ptrToBlock(ptr);
+    if (control == NULL || blockIsFree(block) || new_size >= BLOCK_SIZE_MAX) {
+        return NULL;
+    }
+
+    const size_t size = adjustRequest(new_size);
+    const size_t current = blockSize(block);
+
+    // Grow into the next block if it's free and large enough
+    BlockHeader* const next = blockNext(block);
+    if (size > current && blockIsFree(next) && current + BLOCK_OVERHEAD + blockSize(next) >= size) {
+        removeFree(control, next);
+        block->size += BLOCK_OVERHEAD + blockSize(next);
+        blockNext(block)->prev_phys = block;
+    }
+
+    if (size <= blockSize(block)) {
+        trimTail(control, block, size);
+        control->diagnostics.allocated += blockSize(block);
+        control->diagnostics.allocated -= current;
+        if (control->diagnostics.peak_allocated < control->diagnostics.allocated) {
+            control->diagnostics.peak_allocated = control->diagnostics.allocated;
+        }
+        return ptr;
+    }
+
+    // Need to allocate new block
+    void* new_ptr = HeapAlloc(control, new_size);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+
+    memcpy(new_ptr, ptr, current);
+    HeapFree(control, ptr);
+    return new_ptr;
+}
+
+uint8_t HeapGetStats(Heap* const control, HeapStats* const stats, const uint8_t full_walk) {
+    if (control == NULL || stats == NULL) {
+        return 0;
+    }
+
+    stats->capacity = control->diagnostics.capacity;
+    stats->allocated = control->diagnostics.allocated;
+    stats->free_bytes = control->diagnostics.capacity - control->diagnostics.allocated;
+    stats->peak_allocated = control->diagnostics.peak_allocated;
+    stats->peak_request_size = control->diagnostics.peak_request_size;
+    stats->oom_count = control->diagnostics.oom_count;
+    stats->free_fragments = control->free_blocks;
+    stats->largest_free_block = 0;
+    if (control->fl_bitmap != 0U) {
+        // Size classes are ordered, so only the top non-empty one can hold
+        // the largest block
+        const uint_fast8_t fl = (uint_fast8_t)Log2Floor(control->fl_bitmap);
+        const uint_fast8_t sl = (uint_fast8_t)Log2Floor(control->sl_bitmap[fl]);
+        const BlockHeader* block = control->blocks[fl][sl];
+        size_t largest = blockSize(block);
+        while (full_walk && (block = block->next_free) != NULL) {
+            if (blockSize(block) > largest) {
+                largest = blockSize(block);
+            }
+        }
+        stats->largest_free_block = largest;
+    }
+
+    stats->fragmentation_permille = (stats->free_bytes == 0U) ? 0U
+        : (uint32_t)(1000U - (((uint64_t)stats->largest_free_block * 1000U) / stats->free_bytes));
+    return 1;
+}
+
+uint8_t AllocatorInit(void* const region, const size_t region_size) {
+    Heap* const control = HeapCreate(region, region_size);
+    if (control == NULL) {
+        return 0;
+    }
+
+    heap = control;
+    return 1;
+}
+
+void* malloc(size_t amount) {
+    void* const ptr = HeapAlloc(heap, amount);
+    HEAP_TRACE_RECORD(HEAP_TRACE_MALLOC, ptr, NULL, amount);
+    return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t amount) {
+    void* const ptr = HeapAlignedAlloc(heap, alignment, amount);
+    HEAP_TRACE_RECORD(HEAP_TRACE_ALIGNED_ALLOC, ptr, NULL, amount);
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t new_size) {
+    void* const new_ptr = HeapRealloc(heap, ptr, new_size);
+    HEAP_TRACE_RECORD(HEAP_TRACE_REALLOC, new_ptr, ptr, new_size);
+    return new_ptr;
+}
+
+void* calloc(size_t num_elements, size_t element_size) {
+    void* const ptr = HeapCalloc(heap, num_elements, element_size);
+    HEAP_TRACE_RECORD(HEAP_TRACE_CALLOC, ptr, NULL, (ptr != NULL) ? num_elements * element_size : 0U);
+    return ptr;
+}
+
+void free(void* ptr) {
+    HEAP_TRACE_RECORD(HEAP_TRACE_FREE, ptr, NULL, 0U);
+    HeapFree(heap, ptr);
+}
+
+void AllocatorDeinit() {
+    heap = NULL;
+}
+
+#endif
@@ -0,0 +1,81 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+    @cInclude("virtualization/memory/arena.h");
+});
+
+// Initialize heap memory for tests
+var heap_memory: [std.mem.page_size * 16]u8 align(16) = undefined;
+
+const arena_alignment = 2 * @sizeOf(usize);
+
+test "Arena - bump, mark and rewind" {
+    var buffer: [1024]u8 align(16) = undefined;
+    const arena = c.ArenaInit(&buffer, buffer.len);
+    if (arena == null) return error.ArenaInitFailed;
+
+    const first = c.ArenaAlloc(arena, 3) orelse return error.AllocationFailed;
+    const mark = c.ArenaGetMark(arena);
+    const second = c.ArenaAlloc(arena, 5) orelse return error.AllocationFailed;
+
+    // Consecutive allocations are adjacent, rounded up to the alignment
+    try std.testing.expect(@intFromPtr(second) % arena_alignment == 0);
+    try std.testing.expectEqual(@intFromPtr(first) + arena_alignment, @intFromPtr(second));
+
+    const aligned = c.ArenaAlignedAlloc(arena, 256, 10) orelse return error.AllocationFailed;
+    try std.testing.expect(@intFromPtr(aligned) % 256 == 0);
+
+    // Rewinding drops everything after the mark in one step
+    c.ArenaRewind(arena, mark);
+    try std.testing.expectEqual(@as(?*anyopaque, second), c.ArenaAlloc(arena, 1));
+
+    c.ArenaReset(arena);
+    try std.testing.expectEqual(@as(usize, 0), arena.*.offset);
+    try std.testing.expectEqual(@as(?*anyopaque, first), c.ArenaAlloc(arena, 1));
+}
+
+test "Arena - exhaustion and overflow" {
+    var buffer: [512]u8 align(16) = undefined;
+    const arena = c.ArenaInit(&buffer, buffer.len);
+    if (arena == null) return error.ArenaInitFailed;
+
+    var count: usize = 0;
+    while (c.ArenaAlloc(arena, 24) != null) : (count += 1) {}
+    try std.testing.expect(count > 0);
+    try std.testing.expect(c.ArenaRemaining(arena) < 24);
+    try std.testing.expectEqual(arena.*.offset, arena.*.peak);
+
+    try std.testing.expect(c.ArenaAllocArray(arena, std.math.maxInt(usize), 4) == null);
+    try std.testing.expect(c.ArenaAlloc(arena, 0) == null);
+
+    // The peak survives a reset
+    const peak = arena.*.peak;
+    c.ArenaReset(arena);
+    try std.testing.expectEqual(peak, arena.*.peak);
+}
+
+test "Arena - heap backed create and destroy" {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    // Too large for two arenas to share the heap at once
+    const capacity: usize = heap_memory.len / 2 + 1024;
+    const arena = c.ArenaCreate(capacity);
+    if (arena == null) return error.ArenaCreateFailed;
+    try std.testing.expect(arena.*.capacity >= capacity);
+    try std.testing.expect(arena.*.heap_block != null);
+    try std.testing.expectEqual(arena.*.capacity, c.ArenaRemaining(arena));
+
+    _ = c.ArenaAlloc(arena, 100) orelse return error.AllocationFailed;
+    try std.testing.expect(c.ArenaRemaining(arena) < arena.*.capacity);
+
+    // Destroying hands the block back, so an arena of the same size fits again
+    c.ArenaDestroy(arena);
+    const again = c.ArenaCreate(capacity);
+    if (again == null) return error.ArenaCreateFailed;
+    c.ArenaDestroy(again);
+
+    try std.testing.expect(c.ArenaCreate(0) == null);
+}
@@ -0,0 +1,42 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("bits.h");
+});
+
+test "Bits - scans match the reference" {
+    var rng = std.rand.DefaultPrng.init(0xb175);
+    const random = rng.random();
+
+    var i: usize = 0;
+    while (i < 100_000) : (i += 1) {
+        // Random widths so every leading-zero count gets exercised
+        const x32 = random.int(u32) >> random.uintLessThan(u5, 31) | @as(u32, 1) << random.uintLessThan(u5, 31);
+        const x64 = random.int(u64) >> random.uintLessThan(u6, 63) | @as(u64, 1) << random.uintLessThan(u6, 63);
+
+        try std.testing.expectEqual(@as(u32, @clz(x32)), c.Clz32(x32));
+        try std.testing.expectEqual(@as(u32, @ctz(x32)), c.Ctz32(x32));
+        try std.testing.expectEqual(@as(u32, @clz(x32)), c.SoftwareClz32(x32));
+        try std.testing.expectEqual(@as(u32, @ctz(x32)), c.SoftwareCtz32(x32));
+        try std.testing.expectEqual(@as(u32, @clz(x64)), c.Clz64(x64));
+        try std.testing.expectEqual(@as(u32, @ctz(x64)), c.Ctz64(x64));
+        try std.testing.expectEqual(@as(u32, @popCount(x32)), c.PopCount32(x32));
+    }
+
+    try std.testing.expectEqual(@as(u32, 32), c.SoftwareClz32(0));
+    try std.testing.expectEqual(@as(u32, 32), c.SoftwareCtz32(0));
+}
+
+test "Bits - log2 rounding" {
+    try std.testing.expectEqual(@as(u32, 0), c.Log2Floor(1));
+    try std.testing.expectEqual(@as(u32, 0), c.Log2Ceil(1));
+    try std.testing.expectEqual(@as(u32, 0), c.Log2Ceil(0));
+
+    var x: usize = 2;
+    while (x < 1 << 20) : (x += 1) {
+        const floor = c.Log2Floor(x);
+        const ceil = c.Log2Ceil(x);
+        try std.testing.expect(@as(usize, 1) << @intCast(floor) <= x);
+        try std.testing.expect(@as(usize, 1) << @intCast(ceil) >= x);
+        try std.testing.expectEqual(@as(u32, if (std.math.isPowerOfTwo(x)) floor else floor + 1), ceil);
+    }
+}
@@ -0,0 +1,264 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/cpu/concurrency.h");
+    @cInclude("virtualization/cpu/scheduling.h");
+});
+
+// Most task bodies are hand-written state machines; resume points mirror what
+// TASK_LOCK/TASK_TAKE/TASK_YIELD would generate. The macros themselves are
+// exercised by the C bodies in task_macros.c.
+
+var mutex: c.Mutex = undefined;
+var spin_flag = false;
+var occupant: [*c]c.Task = null;
+var violations: usize = 0;
+var log = std.BoundedArray(u8, 4096){};
+
+const Worker = struct {
+    id: u8,
+    rounds: u32,
+    hold: u32, // Yields while holding the lock
+    held: u32 = 0,
+};
+
+fn enterSection(task: [*c]c.Task, worker: *Worker) void {
+    if (occupant != null) violations += 1;
+    occupant = task;
+    log.append(worker.id) catch {};
+}
+
+// Leaves the section; true once the worker is done
+fn leaveSection(worker: *Worker) bool {
+    occupant = null;
+    worker.held = 0;
+    worker.rounds -= 1;
+    return worker.rounds == 0;
+}
+
+fn mutexWorker(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const worker: *Worker = @ptrCast(@alignCast(task.*.context));
+    if (task.*.resume_point == 0) {
+        task.*.resume_point = 1;
+        if (c.MutexLock(&mutex, task) == 0) return c.TASK_BLOCKED;
+    }
+    if (task.*.resume_point == 1) {
+        enterSection(task, worker);
+        task.*.resume_point = 2;
+    }
+    if (worker.held < worker.hold) {
+        worker.held += 1;
+        return c.TASK_YIELDED;
+    }
+    c.MutexUnlock(&mutex);
+    task.*.resume_point = 0;
+    if (leaveSection(worker)) return c.TASK_EXITED;
+    return c.TASK_YIELDED;
+}
+
+fn spinWorker(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const worker: *Worker = @ptrCast(@alignCast(task.*.context));
+    if (task.*.resume_point == 0) {
+        // What every component does today: poll a flag until it clears
+        if (spin_flag) return c.TASK_WAITING;
+        spin_flag = true;
+        enterSection(task, worker);
+        task.*.resume_point = 1;
+    }
+    if (worker.held < worker.hold) {
+        worker.held += 1;
+        return c.TASK_YIELDED;
+    }
+    spin_flag = false;
+    task.*.resume_point = 0;
+    if (leaveSection(worker)) return c.TASK_EXITED;
+    return c.TASK_YIELDED;
+}
+
+fn resetState() void {
+    c.TaskReset();
+    c.MutexInit(&mutex, 0);
+    spin_flag = false;
+    occupant = null;
+    violations = 0;
+    log.len = 0;
+}
+
+test "Mutex - uncontended lock is a single compare-and-swap" {
+    resetState();
+    try std.testing.expectEqual(@as(u8, 1), c.MutexTryLock(&mutex));
+    try std.testing.expectEqual(@as(u8, 0), c.MutexTryLock(&mutex));
+    c.MutexUnlock(&mutex);
+    try std.testing.expectEqual(@as(u8, 1), c.MutexTryLock(&mutex));
+    c.MutexUnlock(&mutex);
+    try std.testing.expectEqual(@as(u32, 0), mutex.state);
+    try std.testing.expect(mutex.waiters.head == null);
+}
+
+var interrupt_locked: u8 = 0;
+
+fn interruptedTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    _ = task;
+    // Stands in for an interrupt that try-locks on top of this task
+    interrupt_locked = c.MutexTryLock(&mutex);
+    return c.TASK_EXITED;
+}
+
+test "Mutex - a try-lock on top of a task does not make it the owner" {
+    resetState();
+    _ = c.TaskSpawn(&interruptedTask, null) orelse return error.SpawnFailed;
+    _ = c.TaskRun();
+    try std.testing.expectEqual(@as(u8, 1), interrupt_locked);
+    try std.testing.expect(mutex.owner == null);
+    c.MutexUnlockFromIsr(&mutex);
+    try std.testing.expectEqual(@as(u32, 0), mutex.state);
+}
+
+test "Mutex - an unlock from an interrupt hands over in task context" {
+    resetState();
+    // An interrupt holds the mutex while a task parks on it
+    try std.testing.expectEqual(@as(u8, 1), c.MutexTryLock(&mutex));
+    var worker = Worker{ .id = 'a', .rounds = 1, .hold = 0 };
+    _ = c.TaskSpawn(&mutexWorker, &worker) orelse return error.SpawnFailed;
+    try std.testing.expectEqual(@as(u8, 1), c.TaskRunOnce());
+    try std.testing.expect(mutex.waiters.head != null);
+
+    // The waiter stays parked and the mutex locked until the next dispatch
+    c.MutexUnlockFromIsr(&mutex);
+    try std.testing.expect(mutex.waiters.head != null);
+    try std.testing.expect(mutex.state != 0);
+
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("a", log.slice());
+    try std.testing.expectEqual(@as(u32, 0), mutex.state);
+    try std.testing.expect(mutex.waiters.head == null);
+}
+
+test "Mutex - contended tasks block and are handed the lock in order" {
+    resetState();
+    var workers = [_]Worker{
+        .{ .id = 'a', .rounds = 3, .hold = 2 },
+        .{ .id = 'b', .rounds = 3, .hold = 2 },
+        .{ .id = 'c', .rounds = 3, .hold = 2 },
+    };
+    for (&workers) |*worker| _ = c.TaskSpawn(&mutexWorker, worker) orelse return error.SpawnFailed;
+
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("abcabcabc", log.slice());
+    try std.testing.expectEqual(@as(usize, 0), violations);
+    try std.testing.expectEqual(@as(u32, 0), mutex.state);
+}
+
+var semaphore: c.Semaphore = undefined;
+
+fn takerTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const id: *const u8 = @ptrCast(task.*.context);
+    if (task.*.resume_point == 0) {
+        task.*.resume_point = 1;
+        if (c.SemaphoreTake(&semaphore, task) == 0) return c.TASK_BLOCKED;
+    }
+    log.append(id.*) catch {};
+    return c.TASK_EXITED;
+}
+
+test "Semaphore - gives go to waiters first, in order" {
+    resetState();
+    c.SemaphoreInit(&semaphore, 1);
+    const ids = [_]u8{ 'x', 'y', 'z' };
+    for (&ids) |*id| _ = c.TaskSpawn(&takerTask, @constCast(id)) orelse return error.SpawnFailed;
+
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("x", log.slice());
+    try std.testing.expectEqual(@as(usize, 2), c.TaskCount());
+
+    // Two units wake the waiters; the third is kept
+    c.SemaphoreGive(&semaphore);
+    c.SemaphoreGive(&semaphore);
+    c.SemaphoreGive(&semaphore);
+    try std.testing.expectEqual(@as(i32, 1), semaphore.count);
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("xyz", log.slice());
+
+    try std.testing.expectEqual(@as(u8, 1), c.SemaphoreTryTake(&semaphore));
+    try std.testing.expectEqual(@as(u8, 0), c.SemaphoreTryTake(&semaphore));
+}
+
+fn busyTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const worker: *Worker = @ptrCast(@alignCast(task.*.context));
+    log.append(worker.id) catch {};
+    worker.rounds -= 1;
+    if (worker.rounds == 0) return c.TASK_EXITED;
+    return c.TASK_YIELDED;
+}
+
+fn inversionOrder(options: u8) ![]const u8 {
+    resetState();
+    c.MutexInit(&mutex, options);
+
+    // Low takes the lock first, then high wants it while medium is busy
+    var low = Worker{ .id = 'L', .rounds = 1, .hold = 2 };
+    var medium = Worker{ .id = 'M', .rounds = 3, .hold = 0 };
+    var high = Worker{ .id = 'H', .rounds = 1, .hold = 2 };
+    _ = c.TaskSpawnPriority(&mutexWorker, &low, 20) orelse return error.SpawnFailed;
+    _ = c.TaskRunOnce();
+    _ = c.TaskSpawnPriority(&busyTask, &medium, 10) orelse return error.SpawnFailed;
+    _ = c.TaskSpawnPriority(&mutexWorker, &high, 1) orelse return error.SpawnFailed;
+    _ = c.TaskRun();
+    return log.slice();
+}
+
+test "Mutex - priority inheritance bounds inversion" {
+    if (!@hasDecl(c, "PRIORITY_BASED_SCHEDULING")) return error.SkipZigTest;
+
+    // Without inheritance medium runs ahead of the owner, delaying high
+    try std.testing.expectEqualStrings("LMMMH", try inversionOrder(0));
+    try std.testing.expectEqualStrings("LHMMM", try inversionOrder(c.MUTEX_PRIORITY_INHERITANCE));
+}
+
+test "Mutex - blocked waiters are dispatched less than a polled flag" {
+    const task_count = 8;
+    const rounds: u32 = 200;
+    const hold: u32 = 4;
+
+    var dispatches: [2]usize = undefined;
+    for ([_]c.TaskFunction{ &mutexWorker, &spinWorker }, 0..) |function, i| {
+        resetState();
+        var workers: [task_count]Worker = undefined;
+        for (&workers) |*worker| {
+            worker.* = .{ .id = '.', .rounds = rounds, .hold = hold };
+            _ = c.TaskSpawn(function, worker) orelse return error.SpawnFailed;
+        }
+        dispatches[i] = c.TaskRun();
+        try std.testing.expectEqual(@as(usize, 0), violations);
+    }
+
+    // Blocked waiters are never dispatched, polling ones are every round
+    try std.testing.expect(dispatches[0] < dispatches[1]);
+}
+
+extern var macro_log: [32]u8;
+extern var macro_log_length: usize;
+extern var macro_mutex: c.Mutex;
+extern var macro_semaphore: c.Semaphore;
+extern fn MacroLockerTask(task: [*c]c.Task) callconv(.C) c.TaskStatus;
+
+test "Mutex - bodies written with TASK_LOCK and TASK_TAKE" {
+    c.TaskReset();
+    macro_log_length = 0;
+    c.MutexInit(&macro_mutex, c.MUTEX_PRIORITY_INHERITANCE);
+    c.SemaphoreInit(&macro_semaphore, 0);
+
+    // The second locker parks until the first hands the mutex over, then
+    // both park on the empty semaphore
+    const ids = [_]u8{ 'l', 'm' };
+    for (&ids) |*id| _ = c.TaskSpawn(&MacroLockerTask, @constCast(id)) orelse return error.SpawnFailed;
+    try std.testing.expectEqual(@as(usize, 5), c.TaskRun());
+    try std.testing.expectEqualStrings("llmm", macro_log[0..macro_log_length]);
+    try std.testing.expectEqual(@as(u32, 0), macro_mutex.state);
+    try std.testing.expectEqual(@as(usize, 2), c.TaskCount());
+
+    c.SemaphoreGive(&macro_semaphore);
+    c.SemaphoreGive(&macro_semaphore);
+    try std.testing.expectEqual(@as(usize, 2), c.TaskRun());
+    try std.testing.expectEqualStrings("llmmlm", macro_log[0..macro_log_length]);
+    try std.testing.expectEqual(@as(usize, 0), c.TaskCount());
+}
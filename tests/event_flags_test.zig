@@ -0,0 +1,174 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/cpu/concurrency.h");
+});
+
+// Most task bodies are hand-written state machines; resume points mirror
+// what TASK_WAIT_EVENTS would generate. The macro itself is exercised by the
+// C body in task_macros.c.
+
+var events: c.EventFlags = undefined;
+var semaphore: c.Semaphore = undefined;
+var log = std.BoundedArray(u8, 64){};
+var matched = std.BoundedArray(u32, 64){};
+
+const Waiter = struct {
+    id: u8,
+    mask: u32,
+    mode: u8,
+};
+
+fn waiterTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const waiter: *const Waiter = @ptrCast(@alignCast(task.*.context));
+    if (task.*.resume_point == 0) {
+        task.*.resume_point = 1;
+        if (c.EventFlagsWait(&events, task, waiter.mask, waiter.mode) == 0) return c.TASK_BLOCKED;
+    }
+    log.append(waiter.id) catch {};
+    matched.append(task.*.events) catch {};
+    return c.TASK_EXITED;
+}
+
+fn resetState() void {
+    c.TaskReset();
+    c.EventFlagsInit(&events);
+    c.SemaphoreInit(&semaphore, 0);
+    log.len = 0;
+    matched.len = 0;
+}
+
+test "Event flags - set wakes exactly the waiters it satisfies" {
+    resetState();
+    const waiters = [_]Waiter{
+        .{ .id = 'a', .mask = 0b0011, .mode = c.EVENT_WAIT_ANY },
+        .{ .id = 'b', .mask = 0b0011, .mode = c.EVENT_WAIT_ALL },
+        .{ .id = 'c', .mask = 0b0100, .mode = c.EVENT_WAIT_ANY | c.EVENT_CLEAR_ON_EXIT },
+        .{ .id = 'd', .mask = 0b0100, .mode = c.EVENT_WAIT_ANY },
+    };
+    for (&waiters) |*waiter| _ = c.TaskSpawn(&waiterTask, @constCast(waiter)) orelse return error.SpawnFailed;
+    _ = c.TaskRun();
+    try std.testing.expectEqual(@as(usize, 4), c.TaskCount());
+
+    try std.testing.expectEqual(@as(u32, 0b0001), c.EventFlagsSet(&events, 0b0001));
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("a", log.slice());
+
+    try std.testing.expectEqual(@as(u32, 0b0011), c.EventFlagsSet(&events, 0b0010));
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("ab", log.slice());
+
+    // c consumes the flag before d, parked behind it, is checked
+    try std.testing.expectEqual(@as(u32, 0b0011), c.EventFlagsSet(&events, 0b0100));
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("abc", log.slice());
+    try std.testing.expectEqualSlices(u32, &.{ 0b0001, 0b0011, 0b0100 }, matched.slice());
+    try std.testing.expectEqual(@as(usize, 1), c.TaskCount());
+}
+
+test "Event flags - satisfied waits return at once and clear on exit" {
+    resetState();
+    _ = c.EventFlagsSet(&events, 0b0101);
+    const waiter = Waiter{ .id = 'e', .mask = 0b0111, .mode = c.EVENT_WAIT_ANY | c.EVENT_CLEAR_ON_EXIT };
+    _ = c.TaskSpawn(&waiterTask, @constCast(&waiter)) orelse return error.SpawnFailed;
+
+    try std.testing.expectEqual(@as(usize, 1), c.TaskRun());
+    try std.testing.expectEqualSlices(u32, &.{0b0101}, matched.slice());
+    try std.testing.expectEqual(@as(u32, 0), c.EventFlagsGet(&events));
+
+    _ = c.EventFlagsSet(&events, 0b1001);
+    try std.testing.expectEqual(@as(u32, 0b1001), c.EventFlagsClear(&events, 0b0001));
+    try std.testing.expectEqual(@as(u32, 0b1000), c.EventFlagsGet(&events));
+}
+
+test "Event flags - interrupt sets are dispatched by the runtime" {
+    resetState();
+    const waiter = Waiter{ .id = 'i', .mask = 0b0110, .mode = c.EVENT_WAIT_ALL };
+    _ = c.TaskSpawn(&waiterTask, @constCast(&waiter)) orelse return error.SpawnFailed;
+    _ = c.TaskRun();
+
+    // Queued once however often it is set, and nobody is woken yet
+    c.EventFlagsSetFromIsr(&events, 0b0010);
+    c.EventFlagsSetFromIsr(&events, 0b0100);
+    try std.testing.expectEqual(@as(u32, 1), events.pending);
+    try std.testing.expect(events.waiters.head != null);
+
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("i", log.slice());
+    try std.testing.expectEqual(@as(u32, 0), events.pending);
+    try std.testing.expectEqual(@as(usize, 0), c.TaskCount());
+}
+
+var rounds_left: u32 = 0;
+
+fn eventLoopTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    if (task.*.resume_point == 1) rounds_left -= 1;
+    if (rounds_left == 0) return c.TASK_EXITED;
+    task.*.resume_point = 1;
+    if (c.EventFlagsWait(&events, task, 1, c.EVENT_WAIT_ANY | c.EVENT_CLEAR_ON_EXIT) == 0) return c.TASK_BLOCKED;
+    return c.TASK_YIELDED;
+}
+
+fn semaphoreLoopTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    if (task.*.resume_point == 1) rounds_left -= 1;
+    if (rounds_left == 0) return c.TASK_EXITED;
+    task.*.resume_point = 1;
+    if (c.SemaphoreTake(&semaphore, task) == 0) return c.TASK_BLOCKED;
+    return c.TASK_YIELDED;
+}
+
+const Notify = enum { event, event_from_isr, semaphore };
+
+// Each round notifies the parked task once and expects exactly one dispatch
+fn notifyEveryRound(how: Notify, rounds: u32) !void {
+    resetState();
+    rounds_left = rounds;
+    const function: c.TaskFunction = if (how == .semaphore) &semaphoreLoopTask else &eventLoopTask;
+    _ = c.TaskSpawn(function, null) orelse return error.SpawnFailed;
+    _ = c.TaskRunOnce();
+
+    var i: u32 = 0;
+    while (i < rounds) : (i += 1) {
+        try std.testing.expectEqual(@as(u8, 0), c.TaskRunOnce());
+        switch (how) {
+            .event => _ = c.EventFlagsSet(&events, 1),
+            .event_from_isr => c.EventFlagsSetFromIsr(&events, 1),
+            .semaphore => c.SemaphoreGive(&semaphore),
+        }
+        try std.testing.expectEqual(@as(u8, 1), c.TaskRunOnce());
+    }
+    try std.testing.expectEqual(@as(u32, 0), rounds_left);
+    try std.testing.expectEqual(@as(usize, 0), c.TaskCount());
+}
+
+test "Event flags - every notification wakes the parked task once" {
+    try notifyEveryRound(.event, 1000);
+    try notifyEveryRound(.event_from_isr, 1000);
+    try notifyEveryRound(.semaphore, 1000);
+}
+
+extern var macro_log: [32]u8;
+extern var macro_log_length: usize;
+extern var macro_events: c.EventFlags;
+extern fn MacroEventTask(task: [*c]c.Task) callconv(.C) c.TaskStatus;
+
+test "Event flags - a body written with TASK_WAIT_EVENTS" {
+    c.TaskReset();
+    macro_log_length = 0;
+    c.EventFlagsInit(&macro_events);
+    _ = c.TaskSpawn(&MacroEventTask, null) orelse return error.SpawnFailed;
+    try std.testing.expectEqual(@as(usize, 1), c.TaskRun());
+
+    // Waits for both flags, then consumes them
+    _ = c.EventFlagsSet(&macro_events, 0x1);
+    try std.testing.expectEqual(@as(u8, 0), c.TaskRunOnce());
+    c.EventFlagsSetFromIsr(&macro_events, 0x2);
+    try std.testing.expectEqual(@as(usize, 1), c.TaskRun());
+    try std.testing.expectEqualStrings("a", macro_log[0..macro_log_length]);
+    try std.testing.expectEqual(@as(u32, 0), c.EventFlagsGet(&macro_events));
+
+    _ = c.EventFlagsSet(&macro_events, 0x4);
+    try std.testing.expectEqual(@as(usize, 1), c.TaskRun());
+    try std.testing.expectEqualStrings("a4", macro_log[0..macro_log_length]);
+    try std.testing.expectEqual(@as(u32, 0x4), c.EventFlagsGet(&macro_events));
+    try std.testing.expectEqual(@as(usize, 0), c.TaskCount());
+}
@@ -0,0 +1,66 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+});
+
+// Initialize heap memory for tests
+var heap_memory: [std.mem.page_size * 1024]u8 align(16) = undefined;
+
+const max_threads: usize = 8;
+
+fn churn(seed: u64, operations: usize, failed: *std.atomic.Value(bool)) void {
+    var slots = [_]?*anyopaque{null} ** 128;
+    var sizes = [_]usize{0} ** 128;
+    defer {
+        for (slots) |ptr| c.free(ptr);
+    }
+
+    var rng = std.rand.DefaultPrng.init(seed);
+    const random = rng.random();
+
+    var i: usize = 0;
+    while (i < operations) : (i += 1) {
+        const slot = random.uintLessThan(usize, slots.len);
+        const tag: u8 = @truncate(slot);
+        if (slots[slot]) |ptr| {
+            // Another thread scribbling over this block would show up here
+            const data: [*]u8 = @ptrCast(ptr);
+            if (data[0] != tag or data[sizes[slot] - 1] != tag) failed.store(true, .monotonic);
+            c.free(ptr);
+            slots[slot] = null;
+        } else {
+            const size: usize = 16 + random.uintAtMost(usize, 240);
+            const ptr = c.malloc(size) orelse {
+                failed.store(true, .monotonic);
+                return;
+            };
+            const data: [*]u8 = @ptrCast(ptr);
+            data[0] = tag;
+            data[size - 1] = tag;
+            slots[slot] = ptr;
+            sizes[slot] = size;
+        }
+    }
+}
+
+test "Concurrent heap - threads churn without touching each other's blocks" {
+    if (!@hasDecl(c, "HEAP_THREAD_SAFE")) return error.SkipZigTest;
+
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    var failed = std.atomic.Value(bool).init(false);
+    var threads: [max_threads]std.Thread = undefined;
+    for (&threads, 0..) |*thread, index| {
+        thread.* = try std.Thread.spawn(.{}, churn, .{ @as(u64, index), 50_000, &failed });
+    }
+    for (threads) |thread| thread.join();
+    try std.testing.expect(!failed.load(.monotonic));
+
+    // Blocks parked in the exited threads' caches went back to the heap
+    var stats: c.HeapStats = undefined;
+    try std.testing.expectEqual(@as(u8, 1), c.AllocatorGetStats(&stats, 0));
+    try std.testing.expectEqual(@as(usize, 0), stats.allocated);
+}
@@ -0,0 +1,103 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+});
+
+// Initialize heap memory for tests
+var heap_memory: [std.mem.page_size * 16]u8 align(16) = undefined;
+
+const debug_build = @hasDecl(c, "USE_LIST_ALLOCATOR") and @hasDecl(c, "HEAP_DEBUG");
+
+// Replaces the weak default so faults are counted instead of ignored
+var fault_counts = [_]usize{0} ** 8;
+
+fn recordFault(heap: ?*c.Heap, ptr: ?*anyopaque, fault: u32) callconv(.C) void {
+    _ = heap;
+    _ = ptr;
+    fault_counts[fault] += 1;
+}
+
+comptime {
+    if (debug_build) @export(recordFault, .{ .name = "HeapFault" });
+}
+
+test "Heap debug - double and invalid free" {
+    if (!debug_build) return error.SkipZigTest;
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+    fault_counts = [_]usize{0} ** 8;
+
+    const keep = c.malloc(3000) orelse return error.AllocationFailed;
+    defer c.free(keep);
+    const ptr = c.malloc(3000) orelse return error.AllocationFailed;
+    c.free(ptr);
+    c.free(ptr);
+    try std.testing.expectEqual(@as(usize, 1), fault_counts[c.HEAP_CHECK_DOUBLE_FREE]);
+
+    var outside: [64]u8 align(64) = undefined;
+    c.free(&outside);
+    try std.testing.expectEqual(@as(usize, 1), fault_counts[c.HEAP_CHECK_INVALID_FREE]);
+    try std.testing.expectEqual(@as(u32, c.HEAP_CHECK_OK), c.AllocatorCheck());
+}
+
+test "Heap debug - overrun hits the canary" {
+    if (!debug_build) return error.SkipZigTest;
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+    fault_counts = [_]usize{0} ** 8;
+
+    // An odd size leaves rounding slack after the request
+    const size: usize = 3001;
+    const block: [*]u8 = @ptrCast(c.malloc(size) orelse return error.AllocationFailed);
+    @memset(block[0..size], 0xAB);
+    try std.testing.expectEqual(@as(u32, c.HEAP_CHECK_OK), c.AllocatorCheck());
+
+    // The guard starts right after the request, so one byte into the slack is caught
+    block[size] = 0;
+    try std.testing.expectEqual(@as(u32, c.HEAP_CHECK_CANARY), c.AllocatorCheck());
+
+    // The damaged block is reported and left alone
+    c.free(block);
+    try std.testing.expectEqual(@as(usize, 1), fault_counts[c.HEAP_CHECK_CANARY]);
+}
+
+test "Heap debug - freed memory is poisoned" {
+    if (!debug_build) return error.SkipZigTest;
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    // Neighbours in use keep the freed block from merging
+    const before = c.malloc(3000) orelse return error.AllocationFailed;
+    const block: [*]u8 = @ptrCast(c.malloc(3000) orelse return error.AllocationFailed);
+    const after = c.malloc(3000) orelse return error.AllocationFailed;
+    @memset(block[0..3000], 0x42);
+    c.free(block);
+
+    // The first words now hold free-list links
+    for (block[64..3000]) |byte| {
+        try std.testing.expectEqual(@as(u8, c.HEAP_POISON_BYTE), byte);
+    }
+    c.free(before);
+    c.free(after);
+    try std.testing.expectEqual(@as(u32, c.HEAP_CHECK_OK), c.AllocatorCheck());
+}
+
+test "Heap debug - largest free block leaves room for the guard" {
+    if (!debug_build) return error.SkipZigTest;
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    var stats: c.HeapStats = undefined;
+    try std.testing.expectEqual(@as(u8, 1), c.AllocatorGetStats(&stats, 1));
+    try std.testing.expect(c.malloc(stats.largest_free_block + 1) == null);
+    const block = c.malloc(stats.largest_free_block) orelse return error.AllocationFailed;
+    c.free(block);
+}
@@ -0,0 +1,105 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+});
+
+// Initialize heap memory for tests
+var heap_memory: [std.mem.page_size * 16]u8 align(16) = undefined;
+
+test "Heap trace - events in call order" {
+    if (!@hasDecl(c, "HEAP_TRACE")) return error.SkipZigTest;
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    c.HeapTraceClear();
+    const first = c.malloc(100) orelse return error.AllocationFailed;
+    const second = c.calloc(4, 32) orelse return error.AllocationFailed;
+    const grown = c.realloc(first, 400) orelse return error.AllocationFailed;
+    c.free(second);
+    c.free(grown);
+    c.free(null);
+
+    var events: [8]c.HeapTraceEvent = undefined;
+    try std.testing.expectEqual(@as(u32, 5), c.HeapTraceCount());
+    try std.testing.expectEqual(@as(usize, 5), c.HeapTraceSnapshot(&events, events.len));
+
+    try std.testing.expectEqual(@as(u8, c.HEAP_TRACE_MALLOC), events[0].op);
+    try std.testing.expectEqual(@as(?*anyopaque, first), events[0].address);
+    try std.testing.expectEqual(@as(u32, 100), events[0].size);
+
+    try std.testing.expectEqual(@as(u8, c.HEAP_TRACE_CALLOC), events[1].op);
+    try std.testing.expectEqual(@as(u32, 128), events[1].size);
+
+    try std.testing.expectEqual(@as(u8, c.HEAP_TRACE_REALLOC), events[2].op);
+    try std.testing.expectEqual(@as(?*anyopaque, grown), events[2].address);
+    try std.testing.expectEqual(@as(?*anyopaque, first), events[2].previous);
+
+    try std.testing.expectEqual(@as(u8, c.HEAP_TRACE_FREE), events[3].op);
+    try std.testing.expectEqual(@as(?*anyopaque, second), events[3].address);
+    try std.testing.expectEqual(@as(?*anyopaque, grown), events[4].address);
+
+    for (events[0..5]) |event| {
+        try std.testing.expect(event.call_site != null);
+    }
+}
+
+test "Heap trace - ring keeps the newest events" {
+    if (!@hasDecl(c, "HEAP_TRACE")) return error.SkipZigTest;
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    c.HeapTraceClear();
+    const rounds: usize = c.HEAP_TRACE_CAPACITY + 10;
+    var last: ?*anyopaque = null;
+    var i: usize = 0;
+    while (i < rounds) : (i += 1) {
+        last = c.malloc(16 + i % 64) orelse return error.AllocationFailed;
+        c.free(last);
+    }
+
+    const events = try std.testing.allocator.alloc(c.HeapTraceEvent, c.HEAP_TRACE_CAPACITY);
+    defer std.testing.allocator.free(events);
+    try std.testing.expectEqual(@as(u32, @intCast(2 * rounds)), c.HeapTraceCount());
+    try std.testing.expectEqual(@as(usize, c.HEAP_TRACE_CAPACITY), c.HeapTraceSnapshot(events.ptr, events.len));
+
+    // Oldest first: the ring ends with the final free
+    const newest = events[events.len - 1];
+    try std.testing.expectEqual(@as(u8, c.HEAP_TRACE_FREE), newest.op);
+    try std.testing.expectEqual(last, newest.address);
+    try std.testing.expectEqual(@as(u8, c.HEAP_TRACE_MALLOC), events[events.len - 2].op);
+}
+
+test "Heap trace - binary dump" {
+    if (!@hasDecl(c, "HEAP_TRACE")) return error.SkipZigTest;
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    c.HeapTraceClear();
+    const ptr = c.aligned_alloc(64, 200) orelse return error.AllocationFailed;
+    c.free(ptr);
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    var path_buffer: [std.fs.max_path_bytes]u8 = undefined;
+    const path = try std.fmt.bufPrintZ(&path_buffer, ".zig-cache/tmp/{s}/capture.htrc", .{tmp.sub_path});
+    try std.testing.expectEqual(@as(u8, 1), c.HeapTraceDump(path.ptr));
+
+    var capture: [16 + 2 * 40]u8 = undefined;
+    const bytes = try tmp.dir.readFile("capture.htrc", &capture);
+    try std.testing.expectEqual(capture.len, bytes.len);
+    try std.testing.expectEqualSlices(u8, "HTRC", bytes[0..4]);
+
+    const endian = @import("builtin").cpu.arch.endian();
+    try std.testing.expectEqual(@as(u32, 40), std.mem.readInt(u32, bytes[8..12], endian));
+    try std.testing.expectEqual(@as(u32, 2), std.mem.readInt(u32, bytes[12..16], endian));
+    try std.testing.expectEqual(@as(u32, c.HEAP_TRACE_ALIGNED_ALLOC), std.mem.readInt(u32, bytes[16..20], endian));
+    try std.testing.expectEqual(@as(u64, 200), std.mem.readInt(u64, bytes[24..32], endian));
+    try std.testing.expectEqual(@as(u64, @intFromPtr(ptr)), std.mem.readInt(u64, bytes[32..40], endian));
+    try std.testing.expectEqual(@as(u32, c.HEAP_TRACE_FREE), std.mem.readInt(u32, bytes[56..60], endian));
+}
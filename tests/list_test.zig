@@ -0,0 +1,95 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("std/list.h");
+});
+
+const Timer = extern struct {
+    expiry: u32,
+    link: c.ListNode,
+};
+
+fn timerOf(node: [*c]const c.ListNode) *const Timer {
+    const link: *const c.ListNode = node;
+    return @fieldParentPtr("link", link);
+}
+
+fn byExpiry(a: [*c]const c.ListNode, b: [*c]const c.ListNode) callconv(.C) c_int {
+    const x = timerOf(a).expiry;
+    const y = timerOf(b).expiry;
+    return if (x < y) -1 else @intFromBool(x > y);
+}
+
+// Walks the list both ways and returns the expiries front to back
+fn expiries(list: *const c.List, buffer: []u32) ![]u32 {
+    var count: usize = 0;
+    var previous: [*c]c.ListNode = null;
+    var node = list.head;
+    while (node != null) : (node = node.*.next) {
+        try std.testing.expect(node.*.prev == previous);
+        buffer[count] = timerOf(node).expiry;
+        count += 1;
+        previous = node;
+    }
+    try std.testing.expect(list.tail == previous);
+    return buffer[0..count];
+}
+
+test "List - insert, remove and splice" {
+    var timers: [6]Timer = undefined;
+    for (&timers, 0..) |*timer, i| timer.expiry = @intCast(i);
+
+    var list: c.List = .{ .head = null, .tail = null };
+    var other: c.List = .{ .head = null, .tail = null };
+    try std.testing.expectEqual(@as(u8, 1), c.ListEmpty(&list));
+
+    c.ListPushBack(&list, &timers[1].link);
+    c.ListPushFront(&list, &timers[0].link);
+    c.ListInsertAfter(&list, &timers[1].link, &timers[3].link);
+    c.ListInsertBefore(&list, &timers[3].link, &timers[2].link);
+    var buffer: [6]u32 = undefined;
+    try std.testing.expectEqualSlices(u32, &.{ 0, 1, 2, 3 }, try expiries(&list, &buffer));
+
+    // Removing the ends moves head and tail
+    c.ListRemove(&list, &timers[0].link);
+    c.ListRemove(&list, &timers[3].link);
+    try std.testing.expectEqualSlices(u32, &.{ 1, 2 }, try expiries(&list, &buffer));
+
+    c.ListPushBack(&other, &timers[4].link);
+    c.ListPushBack(&other, &timers[5].link);
+    c.ListSplice(&list, &other);
+    try std.testing.expectEqual(@as(u8, 1), c.ListEmpty(&other));
+    try std.testing.expectEqualSlices(u32, &.{ 1, 2, 4, 5 }, try expiries(&list, &buffer));
+    try std.testing.expectEqual(@as(usize, 4), c.ListCount(&list));
+
+    c.ListSplice(&other, &list);
+    try std.testing.expectEqual(&timers[1].link, @as(*c.ListNode, c.ListPopFront(&other)));
+    try std.testing.expectEqualSlices(u32, &.{ 2, 4, 5 }, try expiries(&other, &buffer));
+    while (c.ListPopFront(&other) != null) {}
+    try std.testing.expect(other.tail == null);
+}
+
+test "List - sorted insert keeps equal keys in insertion order" {
+    var timers: [64]Timer = undefined;
+    var list: c.List = undefined;
+    c.ListInit(&list);
+
+    var prng = std.rand.DefaultPrng.init(3);
+    for (&timers) |*timer| {
+        timer.expiry = prng.random().uintLessThan(u32, 16);
+        c.ListInsertSorted(&list, &timer.link, &byExpiry);
+    }
+
+    var buffer: [64]u32 = undefined;
+    const sorted = try expiries(&list, &buffer);
+    try std.testing.expectEqual(timers.len, sorted.len);
+    var node = list.head;
+    while (node.*.next != null) : (node = node.*.next) {
+        const current = timerOf(node);
+        const next = timerOf(node.*.next);
+        try std.testing.expect(current.expiry <= next.expiry);
+        // Timers with equal expiries keep the order they were added in
+        if (current.expiry == next.expiry) {
+            try std.testing.expect(@intFromPtr(current) < @intFromPtr(next));
+        }
+    }
+}
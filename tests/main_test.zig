@@ -2,4 +2,20 @@ const std = @import("std");
 
 test {
     _ = @import("heap_test.zig"); // runs tests inside file
+    _ = @import("pool_test.zig");
+    _ = @import("arena_test.zig");
+    _ = @import("heap_concurrency_test.zig");
+    _ = @import("heap_trace_test.zig");
+    _ = @import("heap_debug_test.zig");
+    _ = @import("bits_test.zig");
+    _ = @import("tasks_test.zig");
+    _ = @import("scheduling_test.zig");
+    _ = @import("task_graph_test.zig");
+    _ = @import("message_queue_test.zig");
+    _ = @import("concurrency_test.zig");
+    _ = @import("event_flags_test.zig");
+    _ = @import("vector_test.zig");
+    _ = @import("unordered_map_test.zig");
+    _ = @import("ordered_map_test.zig");
+    _ = @import("list_test.zig");
 }
@@ -0,0 +1,128 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/cpu/concurrency.h");
+});
+
+const Message = extern struct {
+    producer: u32,
+    sequence: u32,
+};
+
+var storage: [4096]u64 = undefined;
+
+fn initQueue(queue: *c.MessageQueue, capacity: u32, message_size: usize, mode: u8) !void {
+    if (c.MessageQueueInit(queue, &storage, @sizeOf(@TypeOf(storage)), capacity, message_size, mode) == 0) {
+        return error.QueueInitFailed;
+    }
+}
+
+test "Message queue - fill, drain and argument checks" {
+    var queue: c.MessageQueue = undefined;
+    try std.testing.expectEqual(@as(u8, 0), c.MessageQueueInit(&queue, &storage, @sizeOf(@TypeOf(storage)), 3, 8, c.MESSAGE_QUEUE_SPSC));
+    try std.testing.expectEqual(@as(u8, 0), c.MessageQueueInit(&queue, &storage, 16, 4, 8, c.MESSAGE_QUEUE_SPSC));
+
+    for ([_]u8{ c.MESSAGE_QUEUE_SPSC, c.MESSAGE_QUEUE_MPSC }) |mode| {
+        try initQueue(&queue, 4, @sizeOf(Message), mode);
+
+        // Wrap around the ring a few times
+        var sent: u32 = 0;
+        var received: u32 = 0;
+        var round: usize = 0;
+        while (round < 5) : (round += 1) {
+            while (c.MessageQueueSend(&queue, &Message{ .producer = 0, .sequence = sent }) != 0) sent += 1;
+            try std.testing.expectEqual(@as(usize, 4), c.MessageQueueCount(&queue));
+
+            var message: Message = undefined;
+            while (c.MessageQueueReceive(&queue, &message) != 0) : (received += 1) {
+                try std.testing.expectEqual(received, message.sequence);
+            }
+            try std.testing.expect(c.MessageQueuePeek(&queue) == null);
+        }
+        try std.testing.expectEqual(@as(u32, 20), received);
+    }
+}
+
+test "Message queue - zero-copy reserve and commit" {
+    var queue: c.MessageQueue = undefined;
+    const payload_size = 1000;
+    try initQueue(&queue, 8, payload_size, c.MESSAGE_QUEUE_MPSC);
+
+    // Reserved slots stay invisible until committed, even out of order
+    const first: [*]u8 = @ptrCast(c.MessageQueueReserve(&queue) orelse return error.QueueFull);
+    const second: [*]u8 = @ptrCast(c.MessageQueueReserve(&queue) orelse return error.QueueFull);
+    @memset(second[0..payload_size], 2);
+    c.MessageQueueCommit(&queue, second);
+    try std.testing.expect(c.MessageQueuePeek(&queue) == null);
+
+    @memset(first[0..payload_size], 1);
+    c.MessageQueueCommit(&queue, first);
+
+    for ([_]u8{ 1, 2 }) |expected| {
+        const message: [*]const u8 = @ptrCast(c.MessageQueuePeek(&queue) orelse return error.QueueEmpty);
+        try std.testing.expect(message == first or message == second);
+        for (message[0..payload_size]) |byte| try std.testing.expectEqual(expected, byte);
+        c.MessageQueueRelease(&queue);
+    }
+    try std.testing.expectEqual(@as(usize, 0), c.MessageQueueCount(&queue));
+}
+
+fn produce(queue: *c.MessageQueue, producer: u32, count: u32) void {
+    var sequence: u32 = 0;
+    while (sequence < count) {
+        if (c.MessageQueueSend(queue, &Message{ .producer = producer, .sequence = sequence }) != 0) {
+            sequence += 1;
+        } else {
+            std.Thread.yield() catch {};
+        }
+    }
+}
+
+test "Message queue - many producers, one consumer" {
+    var queue: c.MessageQueue = undefined;
+    try initQueue(&queue, 64, @sizeOf(Message), c.MESSAGE_QUEUE_MPSC);
+
+    const producers = 4;
+    const per_producer: u32 = 50_000;
+    var threads: [producers]std.Thread = undefined;
+    for (&threads, 0..) |*thread, i| {
+        thread.* = try std.Thread.spawn(.{}, produce, .{ &queue, @as(u32, @intCast(i)), per_producer });
+    }
+
+    // Each producer's messages arrive in the order it sent them
+    var next = [_]u32{0} ** producers;
+    var received: usize = 0;
+    while (received < producers * per_producer) {
+        var message: Message = undefined;
+        if (c.MessageQueueReceive(&queue, &message) == 0) {
+            std.Thread.yield() catch {};
+            continue;
+        }
+        try std.testing.expect(message.producer < producers);
+        try std.testing.expectEqual(next[message.producer], message.sequence);
+        next[message.producer] += 1;
+        received += 1;
+    }
+    for (threads) |thread| thread.join();
+    try std.testing.expectEqual(@as(usize, 0), c.MessageQueueCount(&queue));
+}
+
+test "Message queue - SPSC across threads keeps order" {
+    var queue: c.MessageQueue = undefined;
+    try initQueue(&queue, 256, @sizeOf(Message), c.MESSAGE_QUEUE_SPSC);
+
+    const count: u32 = 100_000;
+    const producer = try std.Thread.spawn(.{}, produce, .{ &queue, @as(u32, 0), count });
+
+    var expected: u32 = 0;
+    while (expected < count) {
+        var message: Message = undefined;
+        if (c.MessageQueueReceive(&queue, &message) == 0) {
+            std.Thread.yield() catch {};
+            continue;
+        }
+        try std.testing.expectEqual(expected, message.sequence);
+        expected += 1;
+    }
+    producer.join();
+    try std.testing.expectEqual(@as(usize, 0), c.MessageQueueCount(&queue));
+}
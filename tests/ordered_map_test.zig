@@ -0,0 +1,143 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+    @cInclude("virtualization/memory/pool.h");
+    @cInclude("std/ordered_map.h");
+    @cInclude("std/ordered_set.h");
+});
+
+// Initialize heap memory for tests
+var heap_memory: [std.mem.page_size * 256]u8 align(16) = undefined;
+
+fn keyOf(key: ?*anyopaque) u32 {
+    return @as(*const u32, @ptrCast(@alignCast(key))).*;
+}
+
+test "OrderedMap - random inserts and removes keep key order" {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    var map: c.OrderedMap = undefined;
+    c.OrderedMapInit(&map, @sizeOf(u32), @sizeOf(u32), null, null);
+    defer c.OrderedMapDestroy(&map);
+
+    var reference = [_]?u32{null} ** 2048;
+    var prng = std.rand.DefaultPrng.init(5);
+    const random = prng.random();
+    var i: usize = 0;
+    while (i < 50_000) : (i += 1) {
+        const key = random.uintLessThan(u32, reference.len);
+        // Inserts outnumber removes, so the tree grows several levels deep
+        if (random.uintLessThan(u8, 3) != 0) {
+            const value = random.int(u32);
+            try std.testing.expectEqual(@as(u8, 1), c.OrderedMapPut(&map, &key, &value));
+            reference[key] = value;
+        } else {
+            const removed = c.OrderedMapRemove(&map, &key);
+            try std.testing.expectEqual(@as(u8, @intFromBool(reference[key] != null)), removed);
+            reference[key] = null;
+        }
+    }
+    try std.testing.expect(map.depth > 1);
+
+    // A full walk visits exactly the reference entries, in order
+    var iterator: c.OrderedMapIterator = undefined;
+    c.OrderedMapFirst(&map, &iterator);
+    var key: ?*anyopaque = null;
+    var value: ?*anyopaque = null;
+    for (reference, 0..) |expected, k| {
+        const v = expected orelse continue;
+        try std.testing.expectEqual(@as(u8, 1), c.OrderedMapNext(&map, &iterator, &key, &value));
+        try std.testing.expectEqual(@as(u32, @intCast(k)), keyOf(key));
+        try std.testing.expectEqual(v, keyOf(value));
+    }
+    try std.testing.expectEqual(@as(u8, 0), c.OrderedMapNext(&map, &iterator, &key, &value));
+
+    // Removing everything frees the whole tree
+    for (reference, 0..) |expected, k| {
+        if (expected != null) {
+            try std.testing.expectEqual(@as(u8, 1), c.OrderedMapRemove(&map, &@as(u32, @intCast(k))));
+        }
+    }
+    try std.testing.expectEqual(@as(usize, 0), map.size);
+    try std.testing.expect(map.root == null);
+}
+
+test "OrderedMap - bulk load and range iteration" {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    var keys: [1000]u32 = undefined;
+    var values: [1000]u32 = undefined;
+    for (&keys, &values, 0..) |*k, *v, i| {
+        k.* = @intCast(i * 10);
+        v.* = @intCast(i);
+    }
+
+    var map: c.OrderedMap = undefined;
+    c.OrderedMapInit(&map, @sizeOf(u32), @sizeOf(u32), null, null);
+    defer c.OrderedMapDestroy(&map);
+
+    const unsorted = [_]u32{ 1, 3, 2 };
+    try std.testing.expectEqual(@as(u8, 0), c.OrderedMapBulkLoad(&map, &unsorted, null, unsorted.len));
+    try std.testing.expect(map.root == null);
+    try std.testing.expectEqual(@as(u8, 1), c.OrderedMapBulkLoad(&map, &keys, &values, keys.len));
+    try std.testing.expectEqual(@as(usize, keys.len), map.size);
+    try std.testing.expectEqual(@as(u8, 0), c.OrderedMapBulkLoad(&map, &keys, &values, keys.len));
+
+    // Keys in [195, 255): 200, 210, ..., 250
+    var iterator: c.OrderedMapIterator = undefined;
+    var key: ?*anyopaque = null;
+    var value: ?*anyopaque = null;
+    c.OrderedMapLowerBound(&map, &@as(u32, 195), &iterator);
+    var expected: u32 = 200;
+    while (c.OrderedMapNext(&map, &iterator, &key, &value) != 0 and keyOf(key) < 255) : (expected += 10) {
+        try std.testing.expectEqual(expected, keyOf(key));
+        try std.testing.expectEqual(expected / 10, keyOf(value));
+    }
+    try std.testing.expectEqual(@as(u32, 260), expected);
+
+    c.OrderedMapUpperBound(&map, &@as(u32, 9990), &iterator);
+    try std.testing.expectEqual(@as(u8, 0), c.OrderedMapNext(&map, &iterator, &key, &value));
+    c.OrderedMapLowerBound(&map, &@as(u32, 9990), &iterator);
+    try std.testing.expectEqual(@as(u8, 1), c.OrderedMapNext(&map, &iterator, &key, &value));
+
+    // The bulk-loaded tree takes further updates
+    try std.testing.expectEqual(@as(u8, 1), c.OrderedMapPut(&map, &@as(u32, 5), &@as(u32, 55)));
+    try std.testing.expectEqual(@as(u8, 1), c.OrderedMapRemove(&map, &@as(u32, 0)));
+    c.OrderedMapFirst(&map, &iterator);
+    try std.testing.expectEqual(@as(u8, 1), c.OrderedMapNext(&map, &iterator, &key, &value));
+    try std.testing.expectEqual(@as(u32, 5), keyOf(key));
+}
+
+test "OrderedSet - nodes from a pool, unchanged when it runs out" {
+    var set: c.OrderedSet = undefined;
+    c.OrderedSetInit(&set, @sizeOf(u32), null, null);
+    const node_size = set.node_size;
+    try std.testing.expectEqual(@as(usize, c.ORDERED_MAP_NODE_SIZE), node_size);
+
+    var pool_buffer: [c.ORDERED_MAP_NODE_SIZE * 10]u8 align(16) = undefined;
+    const pool = c.PoolInit(&pool_buffer, pool_buffer.len, node_size) orelse return error.PoolInitFailed;
+    var resource: c.MemoryResource = undefined;
+    c.MemoryResourceFromPool(&resource, pool);
+    c.OrderedSetInit(&set, @sizeOf(u32), null, &resource);
+
+    var key: u32 = 0;
+    while (c.OrderedSetAdd(&set, &key) != 0) : (key += 1) {}
+    try std.testing.expect(set.size > 100);
+    try std.testing.expectEqual(key, @as(u32, @intCast(set.size)));
+
+    // The failed add left every key in place
+    var k: u32 = 0;
+    while (k < key) : (k += 1) {
+        try std.testing.expectEqual(@as(u8, 1), c.OrderedSetContains(&set, &k));
+    }
+    try std.testing.expectEqual(@as(u8, 0), c.OrderedSetContains(&set, &key));
+
+    c.OrderedSetDestroy(&set);
+    try std.testing.expectEqual(pool.*.capacity, pool.*.available);
+}
@@ -0,0 +1,81 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+    @cInclude("virtualization/memory/pool.h");
+});
+
+// Initialize heap memory for tests
+var heap_memory: [std.mem.page_size * 16]u8 align(16) = undefined;
+
+const Node = extern struct {
+    next: ?*Node,
+    value: u32,
+};
+
+test "Pool - static buffer allocation" {
+    var buffer: [1024]u8 align(16) = undefined;
+    const pool = c.PoolInit(&buffer, buffer.len, @sizeOf(Node));
+    if (pool == null) return error.PoolInitFailed;
+    const capacity = pool.*.capacity;
+    try std.testing.expect(capacity > 0);
+
+    // Drain the pool, every object must be distinct and aligned
+    var nodes: [64]*Node = undefined;
+    var count: usize = 0;
+    while (c.PoolAlloc(pool)) |ptr| : (count += 1) {
+        try std.testing.expect(count < nodes.len);
+        try std.testing.expect(@intFromPtr(ptr) % (2 * @sizeOf(usize)) == 0);
+        nodes[count] = @ptrCast(@alignCast(ptr));
+        nodes[count].value = @intCast(count);
+    }
+    try std.testing.expectEqual(capacity, count);
+    try std.testing.expectEqual(@as(usize, 0), pool.*.available);
+
+    // Contents survive the other allocations
+    for (nodes[0..count], 0..) |node, i| {
+        try std.testing.expectEqual(@as(u32, @intCast(i)), node.value);
+    }
+
+    // Freed objects are handed out again
+    c.PoolFree(pool, nodes[3]);
+    try std.testing.expectEqual(@as(?*anyopaque, nodes[3]), c.PoolAlloc(pool));
+}
+
+test "Pool - rejects double and foreign frees" {
+    var buffer: [512]u8 align(16) = undefined;
+    const pool = c.PoolInit(&buffer, buffer.len, 24);
+    if (pool == null) return error.PoolInitFailed;
+
+    const first = c.PoolAlloc(pool) orelse return error.AllocationFailed;
+    const available = pool.*.available;
+
+    c.PoolFree(pool, first);
+    c.PoolFree(pool, first);
+    try std.testing.expectEqual(available + 1, pool.*.available);
+
+    // Interior and out-of-range pointers are ignored
+    const second = c.PoolAlloc(pool) orelse return error.AllocationFailed;
+    c.PoolFree(pool, @as([*]u8, @ptrCast(second)) + 1);
+    var outside: u64 = 0;
+    c.PoolFree(pool, &outside);
+    try std.testing.expectEqual(available, pool.*.available);
+}
+
+test "Pool - heap backed create and destroy" {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    const object_count: usize = 100;
+    const pool = c.PoolCreate(@sizeOf(Node), object_count);
+    if (pool == null) return error.PoolCreateFailed;
+    defer c.PoolDestroy(pool);
+    try std.testing.expectEqual(object_count, pool.*.capacity);
+
+    var i: usize = 0;
+    while (i < object_count) : (i += 1) {
+        try std.testing.expect(c.PoolAlloc(pool) != null);
+    }
+    try std.testing.expect(c.PoolAlloc(pool) == null);
+}
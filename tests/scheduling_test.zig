@@ -0,0 +1,305 @@
+const std = @import("std");
+const fixture = @import("task_fixture.zig");
+const c = fixture.c;
+const Stepper = fixture.Stepper;
+const stepTask = fixture.stepTask;
+
+const priority_build = @hasDecl(c, "PRIORITY_BASED_SCHEDULING");
+
+test "Priority scheduling - most urgent first, equal priorities take turns" {
+    if (!priority_build) return error.SkipZigTest;
+    c.TaskReset();
+    var log = std.ArrayList(u8).init(std.testing.allocator);
+    defer log.deinit();
+
+    var low = Stepper{ .id = 'l', .steps = 1, .log = &log };
+    var first = Stepper{ .id = 'a', .steps = 2, .log = &log };
+    var second = Stepper{ .id = 'b', .steps = 2, .log = &log };
+    var high = Stepper{ .id = 'H', .steps = 2, .log = &log };
+    const low_task = c.TaskSpawn(&stepTask, &low) orelse return error.SpawnFailed;
+    _ = c.TaskSpawnPriority(&stepTask, &first, 5) orelse return error.SpawnFailed;
+    _ = c.TaskSpawnPriority(&stepTask, &second, 5) orelse return error.SpawnFailed;
+    _ = c.TaskSpawnPriority(&stepTask, &high, 1) orelse return error.SpawnFailed;
+    try std.testing.expectEqual(@as(u8, c.SCHEDULER_LOWEST_PRIORITY), low_task.*.priority);
+
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("HHababl", log.items);
+}
+
+test "Priority scheduling - inheritance boosts and restores" {
+    if (!priority_build) return error.SkipZigTest;
+    c.TaskReset();
+    var log = std.ArrayList(u8).init(std.testing.allocator);
+    defer log.deinit();
+
+    var owner = Stepper{ .id = 'o', .steps = 1, .log = &log };
+    var middle = Stepper{ .id = 'm', .steps = 1, .log = &log };
+    const owner_task = c.TaskSpawnPriority(&stepTask, &owner, 20) orelse return error.SpawnFailed;
+    _ = c.TaskSpawnPriority(&stepTask, &middle, 10) orelse return error.SpawnFailed;
+
+    // A priority 2 waiter lifts the queued owner past the middle task
+    c.SchedulerInherit(owner_task, 2);
+    try std.testing.expectEqual(@as(u8, 2), owner_task.*.priority);
+    c.SchedulerInherit(owner_task, 15);
+    try std.testing.expectEqual(@as(u8, 2), owner_task.*.priority);
+
+    // A base change while boosted only takes effect once the boost ends
+    c.SchedulerSetPriority(owner_task, 25);
+    try std.testing.expectEqual(@as(u8, 2), owner_task.*.priority);
+    try std.testing.expectEqual(@as(u8, 25), owner_task.*.base_priority);
+
+    try std.testing.expectEqual(@as(u8, 1), c.TaskRunOnce());
+    try std.testing.expectEqualStrings("o", log.items);
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("om", log.items);
+
+    c.TaskReset();
+    owner.steps = 1;
+    const restored = c.TaskSpawnPriority(&stepTask, &owner, 20) orelse return error.SpawnFailed;
+    c.SchedulerInherit(restored, 0);
+    c.SchedulerRestore(restored);
+    try std.testing.expectEqual(@as(u8, 20), restored.*.priority);
+    _ = c.TaskRun();
+}
+
+// The scheduler driven directly, so the ready set can be far larger than
+// TASK_MAX. Every decision only looks at the head of the most urgent level,
+// so the order below holds however many tasks are queued behind it.
+test "Priority scheduling - a large ready set runs by level, then in turn" {
+    if (!priority_build) return error.SkipZigTest;
+    const levels: usize = c.SCHEDULER_PRIORITIES;
+    var tasks: [1024]c.Task = undefined;
+    const per_level = tasks.len / levels;
+
+    c.SchedulerInit();
+    defer c.SchedulerInit();
+    for (&tasks, 0..) |*task, i| {
+        task.* = std.mem.zeroes(c.Task);
+        task.state = c.TASK_STATE_READY;
+        task.priority = @intCast(i % levels);
+        c.SchedulerReady(task);
+    }
+
+    // Requeued tasks go to the back of their level, so level 0 takes turns
+    // and nothing below it runs
+    var round: usize = 0;
+    while (round < 2 * per_level) : (round += 1) {
+        const task = c.SchedulerNext();
+        try std.testing.expect(task == &tasks[(round % per_level) * levels]);
+        c.SchedulerReady(task);
+    }
+
+    // Drained, each level comes out whole and in queue order
+    for (0..levels) |level| {
+        for (0..per_level) |k| try std.testing.expect(c.SchedulerNext() == &tasks[k * levels + level]);
+    }
+    try std.testing.expect(c.SchedulerNext() == null);
+}
+
+// An urgent task awaits `produced`, which a less urgent one sets when it
+// exits after two dispatches
+var produced = false;
+
+fn consumerTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    // TASK_AWAIT(task, produced)
+    if (!produced) return c.TASK_WAITING;
+    return stepTask(task);
+}
+
+fn producerTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const status = stepTask(task);
+    if (status == c.TASK_EXITED) produced = true;
+    return status;
+}
+
+// Runs the pair, giving up after 16 dispatches if the consumer starves
+// the producer
+fn runAwaitPair(consumer: [*c]c.Task) !void {
+    try std.testing.expectEqual(@as(u8, 1), c.TaskRunOnce());
+    try std.testing.expectEqual(@as(u8, c.TASK_STATE_WAITING), consumer.*.state);
+    var dispatches: usize = 1;
+    while (dispatches < 16 and c.TaskRunOnce() != 0) dispatches += 1;
+    try std.testing.expectEqual(@as(usize, 0), c.TaskCount());
+}
+
+test "Priority scheduling - an urgent task awaiting a condition lets the producer run" {
+    if (!priority_build) return error.SkipZigTest;
+    c.TaskReset();
+    produced = false;
+    var log = std.ArrayList(u8).init(std.testing.allocator);
+    defer log.deinit();
+
+    var consumer = Stepper{ .id = 'c', .steps = 1, .log = &log };
+    var producer = Stepper{ .id = 'p', .steps = 2, .log = &log };
+    const consumer_task = c.TaskSpawnPriority(&consumerTask, &consumer, 1) orelse return error.SpawnFailed;
+    _ = c.TaskSpawnPriority(&producerTask, &producer, 10) orelse return error.SpawnFailed;
+    try runAwaitPair(consumer_task);
+    try std.testing.expectEqualStrings("ppc", log.items);
+    try std.testing.expectEqual(@as(u8, 1), consumer_task.*.priority);
+}
+
+const edf_build = @hasDecl(c, "EARLIEST_DEADLINE_FIRST_SCHEDULING");
+
+// Simulated time: every unit of work a task does advances the clock a tick
+var sim_now: u32 = 0;
+
+fn simClock() callconv(.C) u32 {
+    return sim_now;
+}
+
+comptime {
+    if (edf_build) @export(simClock, .{ .name = "SchedulerClock" });
+}
+
+test "EDF scheduling - nearest deadline first, ties in queue order" {
+    if (!edf_build) return error.SkipZigTest;
+    c.TaskReset();
+    sim_now = 0;
+    var log = std.ArrayList(u8).init(std.testing.allocator);
+    defer log.deinit();
+
+    var first = Stepper{ .id = 'a', .steps = 2, .log = &log };
+    var second = Stepper{ .id = 'b', .steps = 2, .log = &log };
+    var urgent = Stepper{ .id = 'U', .steps = 2, .log = &log };
+    _ = c.TaskSpawn(&stepTask, &first) orelse return error.SpawnFailed;
+    _ = c.TaskSpawn(&stepTask, &second) orelse return error.SpawnFailed;
+    const urgent_task = c.TaskSpawnDeadline(&stepTask, &urgent, 100) orelse return error.SpawnFailed;
+    try std.testing.expect(c.SchedulerPeek() == urgent_task);
+
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("UUabab", log.items);
+
+    // Moving deadlines reorders queued tasks
+    log.clearRetainingCapacity();
+    first.steps = 1;
+    second.steps = 1;
+    urgent.steps = 1;
+    const x = c.TaskSpawnDeadline(&stepTask, &first, 30) orelse return error.SpawnFailed;
+    _ = c.TaskSpawnDeadline(&stepTask, &second, 20) orelse return error.SpawnFailed;
+    const z = c.TaskSpawnDeadline(&stepTask, &urgent, 10) orelse return error.SpawnFailed;
+    c.SchedulerSetDeadline(x, 5);
+    c.SchedulerSetDeadline(z, 40);
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("abU", log.items);
+}
+
+test "EDF scheduling - tasks without a deadline stay behind, however long they wait" {
+    if (!edf_build) return error.SkipZigTest;
+    c.TaskReset();
+    sim_now = 0;
+    var log = std.ArrayList(u8).init(std.testing.allocator);
+    defer log.deinit();
+
+    var background = Stepper{ .id = 'b', .steps = 2, .log = &log };
+    var periodic = Stepper{ .id = 'P', .steps = 2, .log = &log };
+    _ = c.TaskSpawn(&stepTask, &background) orelse return error.SpawnFailed;
+
+    // Past the horizon a far deadline given at spawn would now look overdue
+    sim_now = c.SCHEDULER_DEADLINE_HORIZON + 16;
+    const periodic_task = c.TaskSpawnDeadline(&stepTask, &periodic, sim_now + 10) orelse return error.SpawnFailed;
+    try std.testing.expect(c.SchedulerPeek() == periodic_task);
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("PPbb", log.items);
+
+    // Given a deadline, a background task joins the others
+    log.clearRetainingCapacity();
+    background.steps = 1;
+    periodic.steps = 1;
+    const promoted = c.TaskSpawn(&stepTask, &background) orelse return error.SpawnFailed;
+    _ = c.TaskSpawnDeadline(&stepTask, &periodic, sim_now + 10) orelse return error.SpawnFailed;
+    c.SchedulerSetDeadline(promoted, sim_now + 5);
+    try std.testing.expect(c.SchedulerPeek() == promoted);
+    _ = c.TaskRun();
+    try std.testing.expectEqualStrings("bP", log.items);
+}
+
+test "EDF scheduling - an urgent task awaiting a condition lets the producer run" {
+    if (!edf_build) return error.SkipZigTest;
+    c.TaskReset();
+    sim_now = 0;
+    produced = false;
+    var log = std.ArrayList(u8).init(std.testing.allocator);
+    defer log.deinit();
+
+    var consumer = Stepper{ .id = 'c', .steps = 1, .log = &log };
+    var producer = Stepper{ .id = 'p', .steps = 2, .log = &log };
+    const consumer_task = c.TaskSpawnDeadline(&consumerTask, &consumer, 10) orelse return error.SpawnFailed;
+    _ = c.TaskSpawnDeadline(&producerTask, &producer, 100) orelse return error.SpawnFailed;
+    try runAwaitPair(consumer_task);
+    try std.testing.expectEqualStrings("ppc", log.items);
+}
+
+const Periodic = struct {
+    cost: u32,
+    period: u32,
+    release: u32 = 0,
+    remaining: u32 = 0,
+    wait_list: c.TaskWaitList = .{ .head = null, .tail = null },
+};
+
+fn periodicTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const job: *Periodic = @ptrCast(@alignCast(task.*.context));
+    sim_now += 1;
+    job.remaining -= 1;
+    if (job.remaining > 0) return c.TASK_YIELDED;
+
+    // Implicit deadlines: each job is due when the next one is released
+    c.SchedulerJobDone(task, task.*.deadline +% job.period);
+    c.TaskBlock(task, &job.wait_list);
+    return c.TASK_BLOCKED;
+}
+
+// Runs the set until `horizon` and returns the number of deadline misses
+fn simulate(set: []Periodic, horizon: u32) !u32 {
+    c.TaskReset();
+    sim_now = 0;
+
+    var tasks: [8][*c]c.Task = undefined;
+    for (set, 0..) |*job, i| {
+        job.remaining = job.cost;
+        job.release = job.period;
+        job.wait_list = .{ .head = null, .tail = null };
+        tasks[i] = c.TaskSpawnDeadline(&periodicTask, job, job.period) orelse return error.SpawnFailed;
+    }
+
+    while (sim_now < horizon) {
+        for (set) |*job| {
+            while (job.release <= sim_now) : (job.release += job.period) {
+                // An unfinished job carries over into the next period
+                if (job.remaining == 0) {
+                    job.remaining = job.cost;
+                    _ = c.TaskWakeOne(&job.wait_list);
+                } else {
+                    job.remaining += job.cost;
+                }
+            }
+        }
+
+        if (c.TaskRunOnce() == 0) sim_now += 1;
+    }
+
+    var misses: u32 = 0;
+    for (tasks[0..set.len]) |task| misses += task.*.deadline_misses;
+    c.TaskReset();
+    return misses;
+}
+
+test "EDF scheduling - periodic task sets up to full utilization" {
+    if (!edf_build) return error.SkipZigTest;
+
+    // U = 0.92, above the rate-monotonic bound for four tasks (0.76)
+    var feasible = [_]Periodic{
+        .{ .cost = 1, .period = 4 },
+        .{ .cost = 2, .period = 6 },
+        .{ .cost = 3, .period = 10 },
+        .{ .cost = 1, .period = 25 },
+    };
+    try std.testing.expectEqual(@as(u32, 0), try simulate(&feasible, 60_000));
+
+    var overloaded = [_]Periodic{
+        .{ .cost = 2, .period = 4 },
+        .{ .cost = 2, .period = 6 },
+        .{ .cost = 3, .period = 10 },
+    };
+    try std.testing.expect(try simulate(&overloaded, 60_000) > 0);
+}
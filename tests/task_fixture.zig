@@ -0,0 +1,21 @@
+//! Task bodies shared by the task runtime and scheduler tests. Their files
+//! take `c` from here so that the task types match.
+const std = @import("std");
+pub const c = @cImport({
+    @cInclude("virtualization/cpu/scheduling.h");
+});
+
+/// Context of `stepTask`: logs `id` on every dispatch, exits after `steps`.
+pub const Stepper = struct {
+    id: u8,
+    steps: u32,
+    log: *std.ArrayList(u8),
+};
+
+pub fn stepTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    const stepper: *Stepper = @ptrCast(@alignCast(task.*.context));
+    stepper.log.append(stepper.id) catch return c.TASK_EXITED;
+    stepper.steps -= 1;
+    if (stepper.steps == 0) return c.TASK_EXITED;
+    return c.TASK_YIELDED;
+}
@@ -0,0 +1,100 @@
+const std = @import("std");
+const TaskGraph = @import("TaskGraph");
+const c = TaskGraph.c;
+
+// Sensor pipeline: sample produces readings, fuse consumes them in pairs
+var sampled: u16 = 0;
+var fused_sum: u32 = 0;
+var fuse_jobs: u32 = 0;
+var log_jobs: u32 = 0;
+
+fn sampleTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    _ = task;
+    sampled += 1;
+    _ = Pipeline.queues.samples.push(sampled);
+    return c.TASK_EXITED;
+}
+
+fn fuseTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    // Three units of work per job, resumed from the stored point
+    task.*.resume_point += 1;
+    if (task.*.resume_point < 3) return c.TASK_YIELDED;
+    while (Pipeline.queues.samples.pop()) |sample| fused_sum += sample;
+    fuse_jobs += 1;
+    return c.TASK_EXITED;
+}
+
+fn logTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    _ = task;
+    log_jobs += 1;
+    return c.TASK_EXITED;
+}
+
+const pipeline = .{
+    .tasks = .{
+        .{ .name = "sample", .function = &sampleTask, .period = 5, .cost = 1 },
+        .{ .name = "fuse", .function = &fuseTask, .period = 10, .cost = 3, .deadline = 8 },
+        .{ .name = "log", .function = &logTask, .period = 20, .cost = 2 },
+    },
+    .queues = .{
+        .{ .name = "samples", .type = u16, .capacity = 4 },
+    },
+};
+const Pipeline = TaskGraph.TaskGraph(pipeline);
+
+test "Task graph - table built at compile time" {
+    try std.testing.expectEqual(@as(u32, 20), Pipeline.hyperperiod);
+    try std.testing.expectApproxEqAbs(@as(f64, 0.6), Pipeline.utilization, 1e-9);
+
+    // Every task gets exactly its cost in slots per period
+    var slots = [_]u32{0} ** Pipeline.task_count;
+    for (Pipeline.dispatch_table) |slot| {
+        if (slot != TaskGraph.idle) slots[slot] += 1;
+    }
+    try std.testing.expectEqualSlices(u32, &.{ 4, 6, 2 }, &slots);
+    try std.testing.expectEqual(@as(u32, 0b111), Pipeline.release_table[0]);
+    try std.testing.expectEqual(@as(u32, 0b001), Pipeline.release_table[5]);
+    try std.testing.expectEqual(@as(u32, 0b011), Pipeline.release_table[10]);
+    try std.testing.expect(Pipeline.task("fuse") == &Pipeline.control_blocks[1]);
+}
+
+test "Task graph - runs jobs from the table" {
+    Pipeline.reset();
+    sampled = 0;
+    fused_sum = 0;
+    fuse_jobs = 0;
+    log_jobs = 0;
+
+    var i: u32 = 0;
+    while (i < 3 * Pipeline.hyperperiod) : (i += 1) Pipeline.step();
+
+    try std.testing.expectEqual(@as(u64, 60), Pipeline.ticks());
+    try std.testing.expectEqual(@as(u16, 12), sampled);
+    try std.testing.expectEqual(@as(u32, 6), fuse_jobs);
+    try std.testing.expectEqual(@as(u32, 3), log_jobs);
+    try std.testing.expectEqualSlices(u32, &.{ 0, 0, 0 }, &Pipeline.overruns);
+
+    // Whatever fuse has not consumed yet is still queued
+    var queued: u32 = 0;
+    while (Pipeline.queues.samples.pop()) |sample| queued += sample;
+    try std.testing.expectEqual(@as(u32, 12 * 13 / 2), fused_sum + queued);
+}
+
+test "Task graph - infeasible sets are rejected" {
+    // TaskGraph() turns these into compile errors; isFeasible() reports them
+    try std.testing.expect(TaskGraph.isFeasible(pipeline));
+    try std.testing.expect(!TaskGraph.isFeasible(.{
+        .tasks = .{
+            .{ .name = "a", .function = &logTask, .period = 4, .cost = 3 },
+            .{ .name = "b", .function = &logTask, .period = 6, .cost = 2 },
+        },
+    }));
+
+    // U = 0.9 meets every deadline by EDF but not by the priorities given
+    const tight = .{
+        .{ .name = "slow", .function = &logTask, .period = 10, .cost = 5, .priority = 0 },
+        .{ .name = "fast", .function = &logTask, .period = 5, .cost = 2, .priority = 1 },
+    };
+    try std.testing.expect(TaskGraph.isFeasible(.{ .tasks = tight }));
+    try std.testing.expect(!TaskGraph.isFeasible(.{ .tasks = tight, .policy = .priority }));
+}
@@ -0,0 +1,67 @@
+/**
+ * @file task_macros.c
+ * @brief Task bodies written with the TASK_* macros, which Zig cannot
+ * translate; tasks_test.zig spawns them and checks what they logged.
+ */
+#include "virtualization/cpu/tasks.h"
+#include "virtualization/cpu/concurrency.h"
+
+char macro_log[32];
+size_t macro_log_length = 0;
+uint8_t macro_condition = 0;
+TaskWaitList macro_wait_list;
+Mutex macro_mutex;
+Semaphore macro_semaphore;
+EventFlags macro_events;
+
+static void note(const char mark) {
+    if (macro_log_length < sizeof(macro_log)) {
+        macro_log[macro_log_length++] = mark;
+    }
+}
+
+// Counts to three in its context, yielding after each step
+TaskStatus MacroCounterTask(Task* const task) {
+    uint32_t* const count = (uint32_t*)task->context;
+    TASK_BEGIN(task);
+    for (*count = 0; *count < 3U; (*count)++) {
+        note('c');
+        TASK_YIELD(task);
+    }
+    TASK_END(task);
+}
+
+// Polls for macro_condition, parks on macro_wait_list, then exits early
+TaskStatus MacroWaiterTask(Task* const task) {
+    TASK_BEGIN(task);
+    TASK_AWAIT(task, macro_condition != 0U);
+    note('a');
+    TASK_WAIT(task, &macro_wait_list);
+    note('w');
+    TASK_EXIT(task);
+    TASK_END(task);
+}
+
+// Logs its id twice while holding macro_mutex, then once per semaphore unit
+TaskStatus MacroLockerTask(Task* const task) {
+    const char id = *(const char*)task->context;
+    TASK_BEGIN(task);
+    TASK_LOCK(task, &macro_mutex);
+    note(id);
+    TASK_YIELD(task);
+    note(id);
+    MutexUnlock(&macro_mutex);
+    TASK_TAKE(task, &macro_semaphore);
+    note(id);
+    TASK_END(task);
+}
+
+// Consumes flags 0x3 once both are set, then logs which of 0xC woke it
+TaskStatus MacroEventTask(Task* const task) {
+    TASK_BEGIN(task);
+    TASK_WAIT_EVENTS(task, &macro_events, 0x3U, EVENT_WAIT_ALL | EVENT_CLEAR_ON_EXIT);
+    note('a');
+    TASK_WAIT_EVENTS(task, &macro_events, 0xCU, EVENT_WAIT_ANY);
+    note((task->events == 0x4U) ? '4' : '?');
+    TASK_END(task);
+}
@@ -0,0 +1,138 @@
+const std = @import("std");
+const fixture = @import("task_fixture.zig");
+const c = fixture.c;
+const Stepper = fixture.Stepper;
+const stepTask = fixture.stepTask;
+
+// Most task bodies are hand-written state machines here: the TASK_* macros
+// are C-only, but the runtime only sees a function and its resume point. The
+// macros themselves are exercised by the C bodies in task_macros.c.
+
+test "Tasks - round-robin dispatch" {
+    c.TaskReset();
+    var log = std.ArrayList(u8).init(std.testing.allocator);
+    defer log.deinit();
+
+    var first = Stepper{ .id = 'A', .steps = 3, .log = &log };
+    var second = Stepper{ .id = 'B', .steps = 2, .log = &log };
+    try std.testing.expect(c.TaskSpawn(&stepTask, &first) != null);
+    try std.testing.expect(c.TaskSpawn(&stepTask, &second) != null);
+    try std.testing.expectEqual(@as(usize, 2), c.TaskCount());
+
+    try std.testing.expectEqual(@as(usize, 5), c.TaskRun());
+    try std.testing.expectEqualStrings("ABABA", log.items);
+    try std.testing.expectEqual(@as(usize, 0), c.TaskCount());
+    try std.testing.expect(c.TaskCurrent() == null);
+}
+
+var wait_list: c.TaskWaitList = .{ .head = null, .tail = null };
+var event_ready = false;
+var waiter_woken = false;
+var signaller_current: [*c]c.Task = null;
+
+fn waiterTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    switch (task.*.resume_point) {
+        0 => {
+            // TASK_WAIT(task, &wait_list)
+            c.TaskBlock(task, &wait_list);
+            task.*.resume_point = 1;
+            return c.TASK_BLOCKED;
+        },
+        else => {
+            waiter_woken = true;
+            return c.TASK_EXITED;
+        },
+    }
+}
+
+fn signalTask(task: [*c]c.Task) callconv(.C) c.TaskStatus {
+    // TASK_AWAIT(task, event_ready)
+    if (!event_ready) return c.TASK_WAITING;
+    signaller_current = c.TaskCurrent();
+    _ = task;
+    _ = c.TaskWakeAll(&wait_list);
+    return c.TASK_EXITED;
+}
+
+test "Tasks - wait lists and awaiting a condition" {
+    c.TaskReset();
+    wait_list = .{ .head = null, .tail = null };
+    event_ready = false;
+    waiter_woken = false;
+
+    const waiter = c.TaskSpawn(&waiterTask, null) orelse return error.SpawnFailed;
+    const signaller = c.TaskSpawn(&signalTask, null) orelse return error.SpawnFailed;
+
+    // The waiter parks itself; the signaller keeps polling
+    var i: usize = 0;
+    while (i < 10) : (i += 1) try std.testing.expectEqual(@as(u8, 1), c.TaskRunOnce());
+    try std.testing.expectEqual(@as(u8, c.TASK_STATE_BLOCKED), waiter.*.state);
+    try std.testing.expect(wait_list.head == &waiter.*.link);
+    try std.testing.expect(!waiter_woken);
+
+    event_ready = true;
+    _ = c.TaskRun();
+    try std.testing.expect(waiter_woken);
+    try std.testing.expect(signaller_current == signaller);
+    try std.testing.expect(wait_list.head == null);
+    try std.testing.expectEqual(@as(usize, 0), c.TaskCount());
+}
+
+test "Tasks - static control blocks are reused" {
+    c.TaskReset();
+    var log = std.ArrayList(u8).init(std.testing.allocator);
+    defer log.deinit();
+
+    var steppers: [c.TASK_MAX]Stepper = undefined;
+    for (&steppers) |*stepper| {
+        stepper.* = .{ .id = 'x', .steps = 1, .log = &log };
+        try std.testing.expect(c.TaskSpawn(&stepTask, stepper) != null);
+    }
+    var extra = Stepper{ .id = 'y', .steps = 1, .log = &log };
+    try std.testing.expect(c.TaskSpawn(&stepTask, &extra) == null);
+
+    try std.testing.expectEqual(@as(usize, c.TASK_MAX), c.TaskRun());
+    try std.testing.expect(c.TaskSpawn(&stepTask, &extra) != null);
+    _ = c.TaskRun();
+}
+
+extern var macro_log: [32]u8;
+extern var macro_log_length: usize;
+extern var macro_condition: u8;
+extern var macro_wait_list: c.TaskWaitList;
+extern fn MacroCounterTask(task: [*c]c.Task) callconv(.C) c.TaskStatus;
+extern fn MacroWaiterTask(task: [*c]c.Task) callconv(.C) c.TaskStatus;
+
+test "Tasks - bodies written with the task macros" {
+    c.TaskReset();
+    macro_log_length = 0;
+    macro_condition = 0;
+    macro_wait_list = .{ .head = null, .tail = null };
+
+    var count: u32 = 0;
+    const waiter = c.TaskSpawn(&MacroWaiterTask, null) orelse return error.SpawnFailed;
+    _ = c.TaskSpawn(&MacroCounterTask, &count) orelse return error.SpawnFailed;
+
+    // The counter yields its way through the loop while the waiter polls
+    var i: usize = 0;
+    while (i < 10) : (i += 1) try std.testing.expectEqual(@as(u8, 1), c.TaskRunOnce());
+    try std.testing.expectEqualStrings("ccc", macro_log[0..macro_log_length]);
+    try std.testing.expectEqual(@as(u32, 3), count);
+    try std.testing.expectEqual(@as(usize, 1), c.TaskCount());
+    try std.testing.expectEqual(@as(u8, c.TASK_STATE_WAITING), waiter.*.state);
+
+    // Once the condition holds the waiter parks on the wait list
+    macro_condition = 1;
+    try std.testing.expectEqual(@as(u8, 1), c.TaskRunOnce());
+    try std.testing.expectEqualStrings("ccca", macro_log[0..macro_log_length]);
+    try std.testing.expectEqual(@as(u8, c.TASK_STATE_BLOCKED), waiter.*.state);
+    try std.testing.expect(macro_wait_list.head == &waiter.*.link);
+    try std.testing.expectEqual(@as(u8, 0), c.TaskRunOnce());
+
+    // Woken, it picks up after the wait and leaves through TASK_EXIT
+    try std.testing.expectEqual(@as(usize, 1), c.TaskWakeAll(&macro_wait_list));
+    try std.testing.expectEqual(@as(usize, 1), c.TaskRun());
+    try std.testing.expectEqualStrings("cccaw", macro_log[0..macro_log_length]);
+    try std.testing.expectEqual(@as(usize, 0), c.TaskCount());
+    try std.testing.expectEqual(@as(u32, 0), waiter.*.resume_point);
+}
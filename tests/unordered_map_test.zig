@@ -0,0 +1,118 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+    @cInclude("std/unordered_map.h");
+    @cInclude("std/unordered_set.h");
+});
+
+// Initialize heap memory for tests
+var heap_memory: [std.mem.page_size * 256]u8 align(16) = undefined;
+
+fn fullSlots(map: *const c.HashMap) usize {
+    var count: usize = 0;
+    for (map.control[0..map.capacity]) |control| {
+        if (control != 0x80) count += 1;
+    }
+    return count;
+}
+
+test "HashMap - random inserts and removes match a reference" {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    var map: c.HashMap = undefined;
+    c.HashMapInit(&map, @sizeOf(u32), @sizeOf(u32), null, null, null);
+    defer c.HashMapDestroy(&map);
+
+    var reference = [_]?u32{null} ** 512;
+    var prng = std.rand.DefaultPrng.init(7);
+    const random = prng.random();
+    var i: usize = 0;
+    while (i < 50_000) : (i += 1) {
+        const key = random.uintLessThan(u32, reference.len);
+        if (random.boolean()) {
+            const value = random.int(u32);
+            try std.testing.expectEqual(@as(u8, 1), c.HashMapPut(&map, &key, &value));
+            reference[key] = value;
+        } else {
+            const removed = c.HashMapRemove(&map, &key);
+            try std.testing.expectEqual(@as(u8, @intFromBool(reference[key] != null)), removed);
+            reference[key] = null;
+        }
+    }
+
+    // Removal shifts entries back, so every remaining key is still reachable
+    var expected: usize = 0;
+    for (reference, 0..) |value, key| {
+        const found: ?*u32 = @ptrCast(@alignCast(c.HashMapFind(&map, &@as(u32, @intCast(key)))));
+        if (value) |v| {
+            expected += 1;
+            try std.testing.expectEqual(v, (found orelse return error.KeyLost).*);
+        } else {
+            try std.testing.expect(found == null);
+        }
+    }
+    try std.testing.expectEqual(expected, map.size);
+    try std.testing.expectEqual(expected, fullSlots(&map));
+
+    var position: usize = 0;
+    var visited: usize = 0;
+    var key: ?*anyopaque = null;
+    while (c.HashMapNext(&map, &position, &key, null) != 0) visited += 1;
+    try std.testing.expectEqual(expected, visited);
+}
+
+test "HashMap - fixed storage stops at the maximum load" {
+    const capacity = 64;
+    var storage: [capacity + 16 + capacity * 16]u8 align(8) = undefined;
+    var map: c.HashMap = undefined;
+    try std.testing.expectEqual(@as(u8, 0), c.HashMapInitFixed(&map, 8, 4, null, null, &storage, storage.len - 1, capacity));
+    try std.testing.expectEqual(@as(u8, 0), c.HashMapInitFixed(&map, 8, 4, null, null, &storage, storage.len, 48));
+    try std.testing.expectEqual(@as(u8, 1), c.HashMapInitFixed(&map, 8, 4, null, null, &storage, storage.len, capacity));
+
+    var key: u64 = 0;
+    var stored: u32 = 0;
+    while (key < capacity) : (key += 1) {
+        const value: u32 = @intCast(key);
+        if (c.HashMapPut(&map, &key, &value) != 0) stored += 1;
+    }
+    try std.testing.expectEqual(@as(u32, capacity * 3 / 4), stored);
+    try std.testing.expectEqual(@as(u8, 0), c.HashMapReserve(&map, capacity));
+
+    // Freeing one entry makes room for exactly one more
+    key = 0;
+    try std.testing.expectEqual(@as(u8, 1), c.HashMapRemove(&map, &key));
+    key = 1000;
+    try std.testing.expect(c.HashMapInsert(&map, &key, null) != null);
+    key = 1001;
+    try std.testing.expect(c.HashMapInsert(&map, &key, null) == null);
+    c.HashMapDestroy(&map);
+}
+
+test "HashSet - add, contains and remove" {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    var set: c.HashSet = undefined;
+    c.HashSetInit(&set, @sizeOf(u16), null, null, null);
+    defer c.HashSetDestroy(&set);
+
+    var key: u16 = 0;
+    while (key < 1000) : (key += 3) {
+        try std.testing.expectEqual(@as(u8, 1), c.HashSetAdd(&set, &key));
+        try std.testing.expectEqual(@as(u8, 1), c.HashSetAdd(&set, &key));
+    }
+    try std.testing.expectEqual(@as(usize, 334), set.size);
+
+    key = 0;
+    while (key < 1000) : (key += 1) {
+        try std.testing.expectEqual(@as(u8, @intFromBool(key % 3 == 0)), c.HashSetContains(&set, &key));
+    }
+    key = 999;
+    try std.testing.expectEqual(@as(u8, 1), c.HashSetRemove(&set, &key));
+    try std.testing.expectEqual(@as(u8, 0), c.HashSetContains(&set, &key));
+}
@@ -0,0 +1,142 @@
+const std = @import("std");
+const c = @cImport({
+    @cInclude("virtualization/memory/heap.h");
+    @cInclude("std/vector.h");
+});
+
+// Initialize heap memory for tests
+var heap_memory: [std.mem.page_size * 16]u8 align(16) = undefined;
+
+fn elements(vector: *const c.Vector) []u32 {
+    if (vector.size == 0) return &.{};
+    const data: [*]u32 = @ptrCast(@alignCast(vector.data));
+    return data[0..vector.size];
+}
+
+test "Vector - push, erase, resize and shrink on the heap" {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    var vector: c.Vector = undefined;
+    c.VectorInit(&vector, @sizeOf(u32), null);
+    defer c.VectorDestroy(&vector);
+    try std.testing.expect(vector.data == null);
+
+    var i: u32 = 0;
+    while (i < 1000) : (i += 1) {
+        _ = c.VectorPush(&vector, &i) orelse return error.OutOfMemory;
+    }
+    try std.testing.expectEqual(@as(u32, 999), elements(&vector)[999]);
+    try std.testing.expect(c.VectorAt(&vector, 1000) == null);
+
+    try std.testing.expectEqual(@as(u8, 1), c.VectorErase(&vector, 0));
+    try std.testing.expectEqual(@as(u32, 1), elements(&vector)[0]);
+    var last: u32 = 0;
+    try std.testing.expectEqual(@as(u8, 1), c.VectorPop(&vector, &last));
+    try std.testing.expectEqual(@as(u32, 999), last);
+
+    try std.testing.expectEqual(@as(u8, 1), c.VectorShrinkToFit(&vector));
+    try std.testing.expectEqual(vector.size, vector.capacity);
+
+    // New elements from a resize are zeroed
+    try std.testing.expectEqual(@as(u8, 1), c.VectorResize(&vector, 1200));
+    try std.testing.expectEqual(@as(u32, 0), elements(&vector)[1199]);
+    try std.testing.expectEqual(@as(u32, 998), elements(&vector)[997]);
+}
+
+test "Vector - growth factor sets the number of reallocations" {
+    if (c.AllocatorInit(&heap_memory, heap_memory.len) == 0) {
+        return error.HeapInitFailed;
+    }
+    defer c.AllocatorDeinit();
+
+    for ([_]struct { percent: u16, growths: usize }{
+        .{ .percent = 200, .growths = 9 },
+        .{ .percent = 150, .growths = 15 },
+    }) |case| {
+        var vector: c.Vector = undefined;
+        c.VectorInit(&vector, @sizeOf(u32), null);
+        defer c.VectorDestroy(&vector);
+        c.VectorSetGrowth(&vector, case.percent);
+
+        var growths: usize = 0;
+        var i: u32 = 0;
+        while (i < 1024) : (i += 1) {
+            const capacity = vector.capacity;
+            _ = c.VectorPush(&vector, &i) orelse return error.OutOfMemory;
+            if (vector.capacity != capacity) growths += 1;
+        }
+        try std.testing.expectEqual(case.growths, growths);
+    }
+}
+
+test "Vector - inline storage avoids the allocator until outgrown" {
+    // The arena shows whether anything was allocated
+    var arena_buffer: [128]u8 align(16) = undefined;
+    const arena = c.ArenaInit(&arena_buffer, arena_buffer.len) orelse return error.ArenaInitFailed;
+    var resource: c.MemoryResource = undefined;
+    c.MemoryResourceFromArena(&resource, arena);
+
+    var buffer: [8]u32 = undefined;
+    var vector: c.Vector = undefined;
+    c.VectorInitInline(&vector, @sizeOf(u32), &buffer, buffer.len, &resource);
+    defer c.VectorDestroy(&vector);
+
+    const values = [_]u32{ 0, 1, 2, 3, 4, 5, 6, 7 };
+    try std.testing.expectEqual(@as(u8, 1), c.VectorAppend(&vector, &values, values.len));
+    try std.testing.expect(vector.data == @as([*c]u8, @ptrCast(&buffer)));
+    try std.testing.expectEqual(@as(usize, 0), arena.*.offset);
+
+    // The ninth element moves it out, shrinking moves it back
+    _ = c.VectorPush(&vector, &values[0]) orelse return error.OutOfMemory;
+    try std.testing.expect(vector.data != @as([*c]u8, @ptrCast(&buffer)));
+    try std.testing.expectEqual(@as(u8, 1), c.VectorPop(&vector, null));
+    try std.testing.expectEqual(@as(u8, 1), c.VectorShrinkToFit(&vector));
+    try std.testing.expect(vector.data == @as([*c]u8, @ptrCast(&buffer)));
+    try std.testing.expectEqualSlices(u32, &values, elements(&vector));
+}
+
+test "Vector - an append whose count wraps the size is refused" {
+    var buffer: [16]u8 = undefined;
+    var vector: c.Vector = undefined;
+    c.VectorInitInline(&vector, 1, &buffer, buffer.len, null);
+    defer c.VectorDestroy(&vector);
+
+    const values = [_]u8{ 1, 2, 3, 4 };
+    try std.testing.expectEqual(@as(u8, 1), c.VectorAppend(&vector, &values, values.len));
+    try std.testing.expectEqual(@as(u8, 0), c.VectorAppend(&vector, &values, std.math.maxInt(usize) - 1));
+    try std.testing.expectEqual(@as(usize, 4), vector.size);
+    try std.testing.expectEqualSlices(u8, &values, buffer[0..4]);
+}
+
+test "Vector - arena grows the last block in place, pool bounds the size" {
+    var arena_buffer: [4096]u8 align(16) = undefined;
+    const arena = c.ArenaInit(&arena_buffer, arena_buffer.len) orelse return error.ArenaInitFailed;
+    var resource: c.MemoryResource = undefined;
+    c.MemoryResourceFromArena(&resource, arena);
+
+    var vector: c.Vector = undefined;
+    c.VectorInit(&vector, @sizeOf(u32), &resource);
+    var i: u32 = 0;
+    _ = c.VectorPush(&vector, &i) orelse return error.OutOfMemory;
+    const first = vector.data;
+    while (i < 500) : (i += 1) {
+        _ = c.VectorPush(&vector, &i) orelse return error.OutOfMemory;
+    }
+    try std.testing.expect(vector.data == first);
+    c.VectorDestroy(&vector);
+    try std.testing.expectEqual(@as(usize, 0), arena.*.offset);
+
+    var pool_buffer: [512]u8 align(16) = undefined;
+    const pool = c.PoolInit(&pool_buffer, pool_buffer.len, 64) orelse return error.PoolInitFailed;
+    c.MemoryResourceFromPool(&resource, pool);
+    c.VectorInit(&vector, @sizeOf(u32), &resource);
+    defer c.VectorDestroy(&vector);
+
+    // One pool object holds 16 elements and no more
+    try std.testing.expectEqual(@as(u8, 1), c.VectorReserve(&vector, 16));
+    try std.testing.expectEqual(@as(u8, 0), c.VectorReserve(&vector, 17));
+    try std.testing.expectEqual(pool.*.capacity - 1, pool.*.available);
+}